@@ -1,4 +1,4 @@
-QT += widgets core
+QT += widgets core concurrent
 QMAKE_CXXFLAGS = -std=c++11
 QMAKE_LFLAGS = -std=c++11
 
@@ -13,7 +13,22 @@ SOURCES += \
     automatehandler.cpp \
     rule.cpp \
     neighbourrule.cpp \
-    ruleeditor.cpp
+    ruleeditor.cpp \
+    neighbourhood.cpp \
+    compiledrules.cpp \
+    stepengine.cpp \
+    sweepdriver.cpp \
+    checkpoint.cpp \
+    mappedgrid.cpp \
+    slabworker.cpp \
+    slabcluster.cpp \
+    framering.cpp \
+    palette.cpp \
+    frameexporter.cpp \
+    probabilisticrule.cpp \
+    blockrule.cpp \
+    blockengine.cpp \
+    generationsrule.cpp
 
 HEADERS += \
     cell.h \
@@ -25,7 +40,23 @@ HEADERS += \
     automatehandler.h \
     rule.h \
     neighbourrule.h \
-    ruleeditor.h
+    ruleeditor.h \
+    neighbourhood.h \
+    compiledrules.h \
+    stepengine.h \
+    sweepdriver.h \
+    counterrandom.h \
+    checkpoint.h \
+    mappedgrid.h \
+    slabworker.h \
+    slabcluster.h \
+    framering.h \
+    palette.h \
+    frameexporter.h \
+    probabilisticrule.h \
+    blockrule.h \
+    blockengine.h \
+    generationsrule.h
 
 DISTFILES += \
     ../../../../../../Downloads/autoCell icons/fast-backward-full.svg \
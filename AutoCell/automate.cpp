@@ -1,10 +1,69 @@
+#include <climits>
+#include <QtConcurrent>
+#include <QTextStream>
+
 #include "automate.h"
+#include "checkpoint.h"
+#include "frameexporter.h"
+
+/** \brief Names of the update schedules in the rule documents, in the order of StepEngine::updateSchedules
+ */
+static const char *const scheduleNames[] = {"synchronous", "randomSequential", "checkerboard", "blockSequential"};
+
+/** \brief Tell if a number of a rule document is a state which can be given to a cell
+ *
+ * The compiled rules size their bitmasks, buckets and tables by the greatest state of the rules,
+ * so they must not go beyond CellHandler::getMaxState().
+ */
+static bool isState(const QJsonValue &value)
+{
+    return value.isDouble() && value.toDouble() >= 0 && value.toDouble() <= CellHandler::getMaxState();
+}
+
+/** \brief Tell if a number of states of a rule document only gives states which can be given to a cell
+ */
+static bool isNbStates(const QJsonValue &value)
+{
+    return value.isDouble() && value.toDouble() >= 0 && value.toDouble() <= CellHandler::getMaxState() + 1.0;
+}
 
 /** \brief Load the rules of the json given
+ *
+ * The rules are added only if every one of them is valid, otherwise the automate is not changed.
+ *
  * \return Return false if something went wrong
  * \param json JsonObject wich contains the rules
  */
 bool Automate::loadRules(const QJsonArray &json)
+{
+    QList<const Rule*> rules;
+    bool valid = false;
+    try
+    {
+        valid = parseRules(json, rules);
+    }
+    catch (QString &)
+    {
+        qDeleteAll(rules);
+        throw;
+    }
+    if (!valid)
+    {
+        qDeleteAll(rules);
+        return false;
+    }
+    m_rules.append(rules);
+    invalidateRules();
+    return true;
+}
+
+/** \brief Build the rules of the json given, without adding them to the automate
+ *
+ * \param json JsonObject wich contains the rules
+ * \param rules Output, the rules built so far, to be deleted by the caller even if something went wrong
+ * \return Return false if something went wrong
+ */
+bool Automate::parseRules(const QJsonArray &json, QList<const Rule*> &rules) const
 {
 
     for (QJsonArray::const_iterator it = json.begin(); it != json.end(); ++it)
@@ -15,7 +74,31 @@ bool Automate::loadRules(const QJsonArray &json)
 
         if (!ruleJson.contains("type") || !ruleJson["type"].isString())
             return false;
-        if (!ruleJson.contains("finalState") || !ruleJson["finalState"].isDouble())
+        if (!ruleJson["type"].toString().compare("block", Qt::CaseInsensitive))
+        {
+            QVector<unsigned int> blockSize, table, oddTable;
+            if (!readStates(ruleJson["blockSize"], blockSize) || !readStates(ruleJson["table"], table))
+                return false;
+            if (ruleJson.contains("oddTable") && !readStates(ruleJson["oddTable"], oddTable))
+                return false;
+            if (!ruleJson.contains("nbStates") || !isNbStates(ruleJson["nbStates"]))
+                return false;
+            if (blockSize.size() != m_cellHandler->getDimensions().size())
+                return false;
+            rules.push_back(new BlockRule(blockSize, ruleJson["nbStates"].toInt(), table, oddTable));
+            continue;
+        }
+        if (!ruleJson["type"].toString().compare("generations", Qt::CaseInsensitive))
+        {
+            QVector<unsigned int> birth, survival;
+            if (!readStates(ruleJson["birth"], birth) || !readStates(ruleJson["survival"], survival))
+                return false;
+            if (!ruleJson.contains("nbStates") || !isNbStates(ruleJson["nbStates"]))
+                return false;
+            rules.push_back(new GenerationsRule(birth, survival, ruleJson["nbStates"].toInt()));
+            continue;
+        }
+        if (!ruleJson.contains("finalState") || !isState(ruleJson["finalState"]))
             return false;
         if (!ruleJson.contains("currentStates") || !ruleJson["currentStates"].isArray())
             return false;
@@ -24,44 +107,52 @@ bool Automate::loadRules(const QJsonArray &json)
         QJsonArray statesJson = ruleJson["currentStates"].toArray();
         for (int i = 0; i < statesJson.size(); i++)
         {
-            if (!statesJson.at(i).isDouble())
+            if (!isState(statesJson.at(i)))
                 return false;
             currentStates.push_back(statesJson.at(i).toInt());
         }
 
-        if (!ruleJson["type"].toString().compare("neighbour", Qt::CaseInsensitive))
+        bool probabilistic = !ruleJson["type"].toString().compare("probabilistic", Qt::CaseInsensitive);
+        if (probabilistic || !ruleJson["type"].toString().compare("neighbour", Qt::CaseInsensitive))
         {
             if (!ruleJson.contains("neighbourNumberMin") || !ruleJson["neighbourNumberMin"].isDouble())
                 return false;
             if (!ruleJson.contains("neighbourNumberMax") || !ruleJson["neighbourNumberMax"].isDouble())
                 return false;
+            if (probabilistic && (!ruleJson.contains("probability") || !ruleJson["probability"].isDouble()))
+                return false;
+            if (probabilistic && ruleJson.contains("perNeighbour") && !ruleJson["perNeighbour"].isBool())
+                return false;
 
 
 
             QPair<unsigned int, unsigned int> nbrNeighbourInterval(ruleJson["neighbourNumberMin"].toInt(), ruleJson["neighbourNumberMax"].toInt());
-            NeighbourRule *newRule;
+            QSet<unsigned int> neighbourStates;
             if (ruleJson.contains("neighbourStates"))
             {
                 if (!ruleJson["neighbourStates"].isArray())
                     return false;
-                QSet<unsigned int> neighbourStates;
 
                 QJsonArray statesJson = ruleJson["neighbourStates"].toArray();
                 for (int i = 0; i < statesJson.size(); i++)
                 {
-                    if (!statesJson.at(i).isDouble())
+                    if (!isState(statesJson.at(i)))
                         return false;
                     neighbourStates.insert(statesJson.at(i).toInt());
                 }
-                newRule = new NeighbourRule((unsigned int)ruleJson["finalState"].toInt(), currentStates, nbrNeighbourInterval, neighbourStates);
             }
+            NeighbourRule *newRule;
+            if (probabilistic)
+                newRule = new ProbabilisticRule((unsigned int)ruleJson["finalState"].toInt(), currentStates, nbrNeighbourInterval,
+                                                ruleJson["probability"].toDouble(), ruleJson["perNeighbour"].toBool(false), neighbourStates);
             else
-                newRule = new NeighbourRule((unsigned int)ruleJson["finalState"].toInt(), currentStates, nbrNeighbourInterval);
-            m_rules.push_back(newRule);
+                newRule = new NeighbourRule((unsigned int)ruleJson["finalState"].toInt(), currentStates, nbrNeighbourInterval, neighbourStates);
+            rules.push_back(newRule);
         }
         else if (!ruleJson["type"].toString().compare("matrix", Qt::CaseInsensitive))
         {
             MatrixRule *newRule = new MatrixRule((unsigned int)ruleJson["finalState"].toInt(), currentStates);
+            rules.push_back(newRule);
             if (ruleJson.contains("neighbours"))
             {
                 if (!ruleJson["neighbours"].isArray())
@@ -83,7 +174,7 @@ bool Automate::loadRules(const QJsonArray &json)
                     QJsonArray statesJson = neighboursJson.at(i).toObject()["neighbourStates"].toArray();
                     for (int j = 0; j < statesJson.size(); j++)
                     {
-                        if (!statesJson.at(j).isDouble())
+                        if (!isState(statesJson.at(j)))
                             return false;
                         neighbourStates.push_back(statesJson.at(j).toInt());
                     }
@@ -102,7 +193,6 @@ bool Automate::loadRules(const QJsonArray &json)
                 }
 
             }
-            m_rules.push_back(newRule);
 
 
         }
@@ -113,39 +203,89 @@ bool Automate::loadRules(const QJsonArray &json)
     return true;
 }
 
-/** \brief Create an automate with only a cellHandler from file
+/** \brief Read an array of numbers of a rule
  *
- * \param cellHandlerFilename File to load
+ * \param json Array to read
+ * \param states Output, numbers of the array
+ * \return False if it is not an array of numbers between 0 and INT_MAX
  */
-Automate::Automate(QString cellHandlerFilename)
+bool Automate::readStates(const QJsonValue &json, QVector<unsigned int> &states)
 {
-    m_cellHandler = new CellHandler(cellHandlerFilename);
-
+    if (!json.isArray())
+        return false;
+    QJsonArray array = json.toArray();
+    for (int i = 0; i < array.size(); i++)
+    {
+        if (!array.at(i).isDouble() || array.at(i).toDouble() < 0 || array.at(i).toDouble() > INT_MAX)
+            return false;
+        states.push_back(array.at(i).toInt());
+    }
+    return true;
 }
 
-/** \brief Create an automate with only a cellHandler with parameters
+/** \brief Load a rule document: an array of rules, or an object with a neighbourhood and the rules
  *
- * \param dimensions Dimensions of the CellHandler
- * \param type Generation type, empty by default
- * \param stateMax Generate states between 0 and stateMax
- * \param density Average (%) of non-zeros
+ * Typical rule document with a neighbourhood (see Neighbourhood for the possible shapes), and the optional
+ * seed of the probabilistic rules and update schedule (see setUpdateSchedule()):
+ * \code
+ * {
+ * "seed": 42,
+ * "schedule": "blockSequential", "blockSize": 2,
+ * "neighbourhood": {"type": "vonNeumann", "radius": 1},
+ * "rules": [ ... ]
+ * }
+ * \endcode
+ * \return Return false if something went wrong, the automate is then not changed
+ * \throw QString Not valid neighbourhood
  */
-Automate::Automate(const QVector<unsigned int> dimensions, CellHandler::generationTypes type, unsigned int stateMax, unsigned int density)
+bool Automate::loadRuleDocument(const QJsonDocument &document)
 {
-    m_cellHandler = new CellHandler(dimensions, type, stateMax, density);
+    if (document.isArray())
+        return loadRules(document.array());
+
+    // The settings are only applied once the whole document is valid
+    QJsonObject json = document.object();
+    if (json.contains("seed") && !json["seed"].isDouble())
+        return false;
+    int schedule = m_schedule;
+    if (json.contains("schedule"))
+    {
+        QString name = json["schedule"].toString();
+        schedule = 0;
+        while (schedule <= StepEngine::blockSequential && name.compare(scheduleNames[schedule], Qt::CaseInsensitive))
+            schedule++;
+        if (schedule > StepEngine::blockSequential || (json.contains("blockSize") && !json["blockSize"].isDouble()))
+            return false;
+    }
+    Neighbourhood neighbourhood = m_cellHandler->getNeighbourhood();
+    if (json.contains("neighbourhood"))
+    {
+        if (!json["neighbourhood"].isObject())
+            return false;
+        neighbourhood = Neighbourhood::fromJson(json["neighbourhood"].toObject(), m_cellHandler->getDimensions().size());
+    }
+    if (!json.contains("rules") || !json["rules"].isArray())
+        return false;
+    if (!loadRules(json["rules"].toArray()))
+        return false;
 
+    if (json.contains("seed"))
+        m_randomSeed = (quint32)json["seed"].toDouble();
+    if (json.contains("schedule"))
+        setUpdateSchedule((StepEngine::updateSchedules)schedule, json["blockSize"].toInt());
+    if (json.contains("neighbourhood"))
+        setNeighbourhood(neighbourhood);
+    return true;
 }
 
-/** \brief Create an automate from files
+/** \brief Read and parse a rule file
  *
- * \param cellHandlerFilename File of the cellHandler
- * \param ruleFilename File of the rules
+ * \throw QString Unreadable file
+ * \throw QString Not valid file
  */
-Automate::Automate(QString cellHandlerFilename, QString ruleFilename)
+QJsonDocument Automate::readRuleFile(QString filename)
 {
-    m_cellHandler = new CellHandler(cellHandlerFilename);
-
-    QFile ruleFile(ruleFilename);
+    QFile ruleFile(filename);
     if (!ruleFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
         qWarning("Couldn't open given file.");
         throw QString(QObject::tr("Couldn't open given file"));
@@ -164,20 +304,145 @@ Automate::Automate(QString cellHandlerFilename, QString ruleFilename)
         throw QString(parseErr.errorString());
     }
 
-    if (!loadDoc.isArray())
+    if (!loadDoc.isArray() && !loadDoc.isObject())
     {
         qWarning() << "We need an array of rules !";
         throw QString(QObject::tr("We need an array of rules!"));
     }
 
-    loadRules(loadDoc.array());
+    return loadDoc;
+}
+
+/** \brief Forget the compiled rules, they will be rebuilt before the next step
+ */
+void Automate::invalidateRules()
+{
+    m_compiledRules.clear();
+    delete m_engine;
+    m_engine = nullptr;
+    delete m_blockEngine;
+    m_blockEngine = nullptr;
+}
+
+/** \brief Compile the rules on the neighbourhood of the cells if needed, without preparing an engine
+ */
+void Automate::buildCompiledRules()
+{
+    if (m_compiledRules.isNull())
+    {
+        m_compiledRules = QSharedPointer<const CompiledRules>(new CompiledRules(m_rules, m_cellHandler->getNeighbourhood(), m_lookupTableBudget));
+        delete m_engine;
+        m_engine = nullptr;
+    }
+}
+
+/** \brief Compile the rules on the neighbourhood of the cells and prepare the engine
+ *
+ * If the rules contain a BlockRule, the automate is a block automaton: the first BlockRule is applied
+ * by a BlockEngine and the other rules are ignored.
+ */
+void Automate::compileRules()
+{
+    buildCompiledRules();
+    const BlockRule* blockRule = getBlockRule();
+    if (blockRule != nullptr)
+    {
+        if (m_blockEngine == nullptr)
+            m_blockEngine = new BlockEngine(*blockRule, m_cellHandler->getDimensions(), m_cellHandler->getBoundary());
+        return;
+    }
+    if (m_engine == nullptr)
+    {
+        m_engine = new StepEngine(m_compiledRules, m_cellHandler->getDimensions(), m_cellHandler->getBoundary());
+        m_engine->setSchedule(m_schedule, m_blockSize);
+    }
+}
+
+/** \brief Create an automate with only a cellHandler from file
+ *
+ * \param cellHandlerFilename File to load
+ */
+Automate::Automate(QString cellHandlerFilename)
+{
+    m_cellHandler = new CellHandler(cellHandlerFilename);
+
+}
+
+/** \brief Create an automate with only a cellHandler with parameters
+ *
+ * \param dimensions Dimensions of the CellHandler
+ * \param type Generation type, empty by default
+ * \param stateMax Generate states between 0 and stateMax
+ * \param density Average (%) of non-zeros
+ */
+Automate::Automate(const QVector<unsigned int> dimensions, CellHandler::generationTypes type, unsigned int stateMax, unsigned int density)
+{
+    m_cellHandler = new CellHandler(dimensions, type, stateMax, density);
+
+}
+
+/** \brief Create an automate from files
+ *
+ * \param cellHandlerFilename File of the cellHandler
+ * \param ruleFilename File of the rules
+ * \throw QString Not valid cell or rule file
+ */
+Automate::Automate(QString cellHandlerFilename, QString ruleFilename)
+{
+    m_cellHandler = new CellHandler(cellHandlerFilename);
+
+    try
+    {
+        addRuleFile(ruleFilename);
+    }
+    catch (QString &)
+    {
+        delete m_cellHandler;
+        throw;
+    }
+}
+
+/** \brief Create a copy of the automate with new random cells
+ *
+ * The replica has the same dimensions, neighbourhood, boundary and rules (cloned, as the rules belong
+ * to their Automate), and shares the compiled rules of this automate: call it after buildCompiledRules(), as
+ * AutomateHandler::runEnsemble() does, to compile them only once. Several replicas can be created at the same
+ * time from different threads, as long as this automate is not modified.
+ *
+ * \param type Generation type of the cells
+ * \param stateMax Generate states between 0 and stateMax
+ * \param density Average (%) of non-zeros
+ * \param seed Seed of the generation, the same seed gives the same cells. It is also the seed of the probabilistic rules of the replica
+ * \return New automate, to be deleted by the caller
+ */
+Automate *Automate::createReplica(CellHandler::generationTypes type, unsigned int stateMax, unsigned int density, quint32 seed) const
+{
+    Automate* replica = new Automate(m_cellHandler->getDimensions());
+    replica->m_cellHandler->setNeighbourhood(m_cellHandler->getNeighbourhood());
+    replica->m_cellHandler->setBoundary(m_cellHandler->getBoundary());
+    replica->m_cellHandler->generate(type, stateMax, density, seed);
+    replica->m_randomSeed = seed;
+    replica->m_schedule = m_schedule;
+    replica->m_blockSize = m_blockSize;
+    replica->m_lookupTableBudget = m_lookupTableBudget;
+    replica->m_cycleDetectionDepth = m_cycleDetectionDepth;
 
+    for (QList<const Rule*>::const_iterator it = m_rules.cbegin(); it != m_rules.cend(); ++it)
+        replica->m_rules.append((*it)->clone());
+    replica->m_compiledRules = m_compiledRules;
+
+    return replica;
 }
 
 /** \brief Destructor : free the CellHandler and the rules !
  */
 Automate::~Automate()
 {
+    m_checkpointWriting.waitForFinished();
+    delete m_frameRing;
+    delete m_statisticsFile;
+    delete m_engine;
+    delete m_blockEngine;
     delete m_cellHandler;
     for (QList<const Rule*>::iterator it = m_rules.begin(); it != m_rules.end(); ++it)
     {
@@ -197,16 +462,36 @@ bool Automate::saveRules(QString filename) const
         throw QString(QObject::tr("Couldn't open given file"));
     }
 
+    ruleFile.write(ruleDocument().toJson());
+
+    return true;
+}
+
+/** \brief Rule document of the automate, see loadRuleDocument()
+ */
+QJsonDocument Automate::ruleDocument() const
+{
     QJsonArray array;
 
     for (QList<const Rule*>::const_iterator it = m_rules.cbegin(); it != m_rules.cend(); ++it)
         array.append((*it)->toJson());
 
+    // The default neighbourhood, seed and schedule keep the historical format: an array of rules
     QJsonDocument doc(array);
-
-    ruleFile.write(doc.toJson());
-
-    return true;
+    if (!m_cellHandler->getNeighbourhood().isDefault() || m_randomSeed != 0 || m_schedule != StepEngine::synchronous)
+    {
+        QJsonObject json;
+        if (m_randomSeed != 0)
+            json.insert("seed", QJsonValue((double)m_randomSeed));
+        if (m_schedule != StepEngine::synchronous)
+            json.insert("schedule", QJsonValue(scheduleNames[m_schedule]));
+        if (m_schedule == StepEngine::blockSequential && m_blockSize != 0)
+            json.insert("blockSize", QJsonValue((int)m_blockSize));
+        json.insert("neighbourhood", m_cellHandler->getNeighbourhood().toJson());
+        json.insert("rules", array);
+        doc = QJsonDocument(json);
+    }
+    return doc;
 }
 
 /** \brief Save cellHandler
@@ -230,6 +515,24 @@ bool Automate::saveAll(QString cellHandlerFilename, QString rulesFilename) const
 void Automate::addRule(const Rule *newRule)
 {
     m_rules.push_back(newRule);
+    invalidateRules();
+}
+
+/** \brief First BlockRule of the rules, nullptr if there is none
+ */
+const BlockRule *Automate::getBlockRule() const
+{
+    for (QList<const Rule*>::const_iterator it = m_rules.cbegin(); it != m_rules.cend(); ++it)
+        if (dynamic_cast<const BlockRule*>(*it) != nullptr)
+            return dynamic_cast<const BlockRule*>(*it);
+    return nullptr;
+}
+
+/** \brief True if the automate is a block automaton, see compileRules()
+ */
+bool Automate::hasBlockRule() const
+{
+    return getBlockRule() != nullptr;
 }
 
 /** \brief Modify the place of the rule in the priority list.
@@ -241,6 +544,7 @@ void Automate::addRule(const Rule *newRule)
 void Automate::setRulePriority(const Rule *rule, unsigned int newPlace)
 {
     m_rules.move(m_rules.indexOf(rule), newPlace);
+    invalidateRules();
 }
 
 /** \brief Return all the rules
@@ -250,67 +554,486 @@ const QList<const Rule *> &Automate::getRules() const
    return m_rules;
 }
 
+/** \brief Neighbourhood of the cells, used by the NeighbourRules
+ */
+const Neighbourhood &Automate::getNeighbourhood() const
+{
+    return m_cellHandler->getNeighbourhood();
+}
+
+/** \brief Change the neighbourhood of the cells
+ *
+ * \throw QString The neighbourhood doesn't have the dimension of the grid
+ */
+void Automate::setNeighbourhood(const Neighbourhood &neighbourhood)
+{
+    m_cellHandler->setNeighbourhood(neighbourhood);
+    invalidateRules();
+}
+
+/** \brief Behaviour of the neighbours out of the grid
+ */
+CellHandler::boundaryTypes Automate::getBoundary() const
+{
+    return m_cellHandler->getBoundary();
+}
+
+/** \brief Change the behaviour of the neighbours out of the grid
+ *
+ * The compiled rules don't depend on it, only the engine is rebuilt.
+ */
+void Automate::setBoundary(CellHandler::boundaryTypes boundary)
+{
+    m_cellHandler->setBoundary(boundary);
+    delete m_engine;
+    m_engine = nullptr;
+    delete m_blockEngine;
+    m_blockEngine = nullptr;
+}
+
+/** \brief Accessor of m_lookupTableBudget
+ */
+unsigned int Automate::getLookupTableBudget() const
+{
+    return m_lookupTableBudget;
+}
+
+/** \brief Change the maximum size of the lookup table of the rules
+ *
+ * The rules are compiled into a table indexed by the configuration of the neighbourhood if it has
+ * at most this number of entries (4 bytes each).
+ *
+ * \param entries Maximum number of entries, 0 to never use a table
+ */
+void Automate::setLookupTableBudget(unsigned int entries)
+{
+    m_lookupTableBudget = entries;
+    invalidateRules();
+}
+
+/** \brief Accessor of m_randomSeed
+ */
+quint32 Automate::getRandomSeed() const
+{
+    return m_randomSeed;
+}
+
+/** \brief Set the seed of the probabilistic rules
+ *
+ * The draws of a step only depend on the seed, the generation and the cell (see StepEngine::setRandomStream()),
+ * so the same seed and cells give the same run. The seed is saved with the rules.
+ */
+void Automate::setRandomSeed(quint32 seed)
+{
+    m_randomSeed = seed;
+}
+
+/** \brief Accessor of m_schedule
+ */
+StepEngine::updateSchedules Automate::getUpdateSchedule() const
+{
+    return m_schedule;
+}
+
+/** \brief Accessor of m_blockSize
+ */
+unsigned int Automate::getBlockSize() const
+{
+    return m_blockSize;
+}
+
+/** \brief Choose the order in which the cells are updated during a step, see StepEngine::setSchedule()
+ *
+ * The schedules other than synchronous update the cells in place, each cell sees the cells updated before it
+ * during the step. The schedule is saved with the rules. MappedGrid and SlabCluster only accept the
+ * synchronous schedule.
+ *
+ * \param schedule Order of the updates
+ * \param blockSize Period of the phases of blockSequential, 0 for the smallest one whose phases are independent
+ */
+void Automate::setUpdateSchedule(StepEngine::updateSchedules schedule, unsigned int blockSize)
+{
+    m_schedule = schedule;
+    m_blockSize = blockSize;
+    if (m_engine != nullptr)
+        m_engine->setSchedule(m_schedule, m_blockSize);
+}
+
 /** \brief Apply the rule on the cells grid nbSteps times
+ *
+ * If stopWhenSettled is true, the hash of the grid is updated at each step and compared to the hashes of the
+ * m_cycleDetectionDepth previous generations. When a hash is found again, the checksums of the two generations
+ * (see CellHandler::checksum()) are compared to confirm the cycle, then the run stops and the cycle is given by
+ * getAttractor(). Only the hashes are kept, not the grids.
+ *
+ * With probabilistic rules or the randomSequential schedule, the draws depend on the generation, so a grid
+ * found again is not a cycle: all the steps are done and getAttractor() is not settled. A block automaton
+ * shifts its blocks and may change its table at odd generations, so its grids are only compared to the grids of
+ * the same parity.
  *
  * \param nbSteps number of iterations of the automate on the cell grid
+ * \param stopWhenSettled Stop as soon as the automaton reaches a fixed point or a cycle
+ * \param keepHistory If false, the generations are not kept for previousStates()
+ * \return False if the run stopped before nbSteps because the automaton settled
  */
-bool Automate::run(unsigned int nbSteps) //void instead ?
+bool Automate::run(unsigned int nbSteps, bool stopWhenSettled, bool keepHistory) //void instead ?
 {
-    for(unsigned int i = 0; i<nbSteps; ++i)
+    compileRules();
+    m_attractor = Attractor();
+    const bool stochastic = m_blockEngine == nullptr
+            && (m_compiledRules->isStochastic() || m_schedule == StepEngine::randomSequential);
+    if (!stopWhenSettled || stochastic)
     {
-        for (CellHandler::iterator it = m_cellHandler->begin(); it != m_cellHandler->end(); ++it)
-        {
-            for (QList<const Rule*>::iterator rule = m_rules.begin(); rule != m_rules.end() ; ++rule)
-            {
-                if((*rule)->matchCell(*it)) //if the cell matches with the rule, its state is changed
-                {
-                    it->setState((*rule)->getCellOutputState());
-                    break;
-                }
-            }
+        for(unsigned int i = 0; i<nbSteps; ++i)
+            advance(keepHistory);
+        return true;
+    }
 
+    // Recent generations: key => generation, and the key and checksum of each generation, oldest first.
+    // The key is the hash of the grid, changed at the odd generations of a block automaton.
+    const bool byParity = m_blockEngine != nullptr;
+    auto key = [byParity](quint64 hash, unsigned int generation) { return byParity && generation % 2 == 1 ? ~hash : hash; };
+    QHash<quint64, unsigned int> recentHashes;
+    QQueue<QPair<quint64, quint64> > recentSums;
+    quint64 hash = m_cellHandler->hash();
+    for(unsigned int i = 0; i<=nbSteps; ++i)
+    {
+        unsigned int generation = m_cellHandler->getGeneration();
+        unsigned int oldestGeneration = generation - recentSums.size();
+        quint64 checksum = m_cellHandler->checksum();
+        QHash<quint64, unsigned int>::const_iterator found = recentHashes.constFind(key(hash, generation));
+        if (found != recentHashes.constEnd() && recentSums.at(found.value() - oldestGeneration).second == checksum)
+        {
+            m_attractor.start = found.value();
+            m_attractor.period = generation - found.value();
+            // An odd period of a block automaton is found as twice its length, the middle grid is the same too
+            unsigned int middle = generation - m_attractor.period / 2;
+            if (byParity && m_attractor.period % 4 == 2
+                    && recentSums.at(middle - oldestGeneration) == qMakePair(key(hash, middle), checksum))
+                m_attractor.period /= 2;
+            return false;
+        }
+        if (i == nbSteps)
+            break;
 
+        recentHashes.insert(key(hash, generation), generation);
+        recentSums.enqueue(qMakePair(key(hash, generation), checksum));
+        if ((unsigned int)recentSums.size() > m_cycleDetectionDepth)
+        {
+            quint64 oldestHash = recentSums.dequeue().first;
+            if (recentHashes.value(oldestHash) == oldestGeneration)
+                recentHashes.remove(oldestHash);
         }
-        m_cellHandler->nextStates(); //apply the changes to all the cells simultaneously
+
+        quint64 hashDelta = 0;
+        advance(keepHistory, &hashDelta);
+        hash += hashDelta;
     }
     return true;
-
 }
 
-/** \brief Accessor of m_cellHandler
+/** \brief Do one step with the engine, then record and export the new generation if needed
+ *
+ * The rules are evaluated on the stencil of the neighbourhood without Cell objects, or block by block for a
+ * block automaton. The statistics
+ * are computed by the engine during the step, see setStatistics().
+ *
+ * \param keepHistory If false, the current generation is not kept for previousStates()
+ * \param hashDelta If not nullptr, the change of the hash of the grid is added to it
  */
-const CellHandler &Automate::getCellHandler() const
+void Automate::advance(bool keepHistory, quint64 *hashDelta)
 {
-    return *m_cellHandler;
+    const bool statisticsWanted = m_keepStatistics || m_statisticsFile != nullptr;
+    GenerationStatistics statistics;
+    if (m_blockEngine != nullptr)
+        m_blockEngine->step(m_cellHandler->getStates(), m_cellHandler->getNextStates(), m_cellHandler->getGeneration(), hashDelta,
+                            statisticsWanted ? &statistics.population : nullptr, statisticsWanted ? &statistics.nbChanged : nullptr);
+    else
+    {
+        m_engine->setRandomStream(m_randomSeed, m_cellHandler->getGeneration());
+        m_engine->step(m_cellHandler->getStates(), m_cellHandler->getNextStates(), hashDelta,
+                       statisticsWanted ? &statistics.population : nullptr, statisticsWanted ? &statistics.nbChanged : nullptr);
+    }
+    m_cellHandler->nextStates(keepHistory); //apply the changes to all the cells simultaneously
+    if (statisticsWanted)
+    {
+        statistics.generation = m_cellHandler->getGeneration();
+        recordStatistics(statistics);
+    }
+    checkpointIfDue();
+    publishFrameIfDue();
 }
 
-void Automate::addRuleFile(QString filename){
-    QFile ruleFile(filename);
-    if (!ruleFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qWarning("Couldn't open given file.");
-        throw QString(QObject::tr("Couldn't open given file"));
+/** \brief Apply the rules nbSteps times, keeping only the starting generation in the history
+ *
+ * It is meant to jump far ahead from another thread: the intermediate generations are not kept,
+ * previousStates() goes back directly to the starting generation. The cells must not be used
+ * by another thread during the call.
+ *
+ * \param nbSteps Number of steps
+ * \param cancelled If not nullptr, the run stops as soon as it is not 0
+ * \param progress If not nullptr, set to the number of steps done
+ * \return False if the run was cancelled
+ */
+bool Automate::fastForward(unsigned int nbSteps, const QAtomicInt *cancelled, QAtomicInt *progress)
+{
+    compileRules();
+    for (unsigned int i = 0; i < nbSteps; ++i)
+    {
+        if (cancelled != nullptr && cancelled->load() != 0)
+            return false;
+        advance(i == 0);
+        if (progress != nullptr)
+            progress->store(i + 1);
     }
+    return true;
+}
 
-    QJsonParseError parseErr;
-    QJsonDocument loadDoc(QJsonDocument::fromJson(ruleFile.readAll(), &parseErr));
+/** \brief Save a checkpoint of the automate, written by another thread
+ *
+ * The snapshot is taken immediately and is not affected by the next steps, see Checkpoint.
+ * If the previous checkpoint is still being written, it is waited for first.
+ *
+ * \param filename File to write, .atk by convention
+ * \return Future result of Checkpoint::write()
+ */
+QFuture<bool> Automate::saveCheckpoint(QString filename)
+{
+    m_checkpointWriting.waitForFinished();
+    const Checkpoint checkpoint(*this);
+    m_checkpointWriting = QtConcurrent::run([=]() { return checkpoint.write(filename); });
+    return m_checkpointWriting;
+}
 
-    ruleFile.close();
+/** \brief Save a checkpoint every interval generations during run() and fastForward()
+ *
+ * The checkpoint of a generation is skipped if the previous one is still being written, the run
+ * never waits for the disk. Checkpoint::resume() continues the run from the file.
+ *
+ * \param filename File of the checkpoints, replaced by each one
+ * \param interval Number of generations between two checkpoints, 0 to stop them
+ */
+void Automate::setCheckpoints(QString filename, unsigned int interval)
+{
+    m_checkpointFile = filename;
+    m_checkpointInterval = interval;
+}
+
+/** \brief Accessor of m_checkpointInterval
+ */
+unsigned int Automate::getCheckpointInterval() const
+{
+    return m_checkpointInterval;
+}
 
+/** \brief Start a checkpoint if the current generation needs one and the previous one is written
+ */
+void Automate::checkpointIfDue()
+{
+    if (m_checkpointInterval != 0 && m_cellHandler->getGeneration() % m_checkpointInterval == 0
+            && m_checkpointWriting.isFinished())
+        saveCheckpoint(m_checkpointFile);
+}
 
-    if (loadDoc.isNull() || loadDoc.isEmpty())
+/** \brief Publish every interval-th generation in a ring of frames in shared memory, see FrameRing
+ *
+ * The current generation is published immediately. The ring is replaced if the export is set again,
+ * and removed when the interval is 0 or when the automate is destroyed.
+ *
+ * \param name Name of the shared memory object
+ * \param interval Number of generations between two frames, 0 to stop the export
+ * \param nbSlots Number of frames kept in the ring
+ * \throw QString Shared memory not available
+ */
+void Automate::setFrameExport(QString name, unsigned int interval, unsigned int nbSlots)
+{
+    delete m_frameRing;
+    m_frameRing = nullptr;
+    m_frameInterval = 0;
+    if (interval == 0)
+        return;
+
+    m_frameRing = new FrameRing(name, m_cellHandler->getDimensions(), nbSlots);
+    m_frameInterval = interval;
+    m_frameRing->publish(m_cellHandler->getStates(), m_cellHandler->getGeneration());
+}
+
+/** \brief Accessor of m_frameInterval
+ */
+unsigned int Automate::getFrameInterval() const
+{
+    return m_frameInterval;
+}
+
+/** \brief Ring of the published frames, nullptr if there is no export
+ */
+const FrameRing *Automate::getFrameRing() const
+{
+    return m_frameRing;
+}
+
+/** \brief Export every interval-th generation as a frame, see FrameExporter
+ *
+ * The current generation is exported immediately. The steps wait for the exporter when its queue is full.
+ *
+ * \param exporter Exporter of the dimensions of the automate, it must exist until the export is stopped
+ * \param interval Number of generations between two frames, 0 to stop the export
+ */
+void Automate::setFrameExporter(FrameExporter *exporter, unsigned int interval)
+{
+    m_frameExporter = interval != 0 ? exporter : nullptr;
+    m_exportInterval = exporter != nullptr ? interval : 0;
+    if (m_frameExporter != nullptr)
+        m_frameExporter->addFrame(m_cellHandler->getSnapshot(), m_cellHandler->getGeneration());
+}
+
+/** \brief Publish the current generation to the frame ring and to the exporter if they need it
+ */
+void Automate::publishFrameIfDue()
+{
+    const unsigned int generation = m_cellHandler->getGeneration();
+    if (m_frameInterval != 0 && generation % m_frameInterval == 0)
+        m_frameRing->publish(m_cellHandler->getStates(), generation);
+    if (m_exportInterval != 0 && generation % m_exportInterval == 0)
+        m_frameExporter->addFrame(m_cellHandler->getSnapshot(), generation);
+}
+
+/** \brief Compute the population of each state at every step of run() and fastForward()
+ *
+ * The populations are counted by the engine in the same pass as the step, see StepEngine::step().
+ * The current generation is recorded immediately, with no changed cell. Calling it again starts a new
+ * series and closes the previous file.
+ *
+ * The CSV file has a header then one line by generation:
+ * \code generation,changed,state0,state1,...,stateN \endcode
+ * The columns go up to the greatest state of the cells and of the rules when the recording starts.
+ * If states greater than that appear later (rules added during the series), their counts are appended
+ * to the lines without a name in the header.
+ *
+ * \param keepSeries Keep the statistics in memory for getStatistics()
+ * \param filename CSV file where the statistics are written as they are computed, empty for none
+ * \throw QString Unusable file
+ */
+void Automate::setStatistics(bool keepSeries, QString filename)
+{
+    delete m_statisticsFile;
+    m_statisticsFile = nullptr;
+    m_keepStatistics = keepSeries;
+    m_statistics.clear();
+
+    compileRules();
+    GenerationStatistics statistics;
+    statistics.generation = m_cellHandler->getGeneration();
+    statistics.population.fill(0, m_compiledRules->getMaxState() + 1);
+    const unsigned int *states = m_cellHandler->getStates();
+    for (unsigned int i = 0; i < m_cellHandler->getSize(); i++)
     {
-        qWarning() << "Could not read data : ";
-        qWarning() << parseErr.errorString();
-        throw QString(parseErr.errorString());
+        unsigned int state = qMin(states[i], CellHandler::getMaxState());
+        if (state >= (unsigned int)statistics.population.size())
+            statistics.population.resize(state + 1);
+        statistics.population[state]++;
     }
 
-    if (!loadDoc.isArray())
+    if (!filename.isEmpty())
     {
-        qWarning() << "We need an array of rules !";
-        throw QString(QObject::tr("We need an array of rules!"));
+        m_statisticsFile = new QFile(filename);
+        if (!m_statisticsFile->open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            delete m_statisticsFile;
+            m_statisticsFile = nullptr;
+            qWarning("Couldn't open given file.");
+            throw QString(QObject::tr("Couldn't open given file"));
+        }
+        m_statisticsColumns = statistics.population.size();
+        QTextStream stream(m_statisticsFile);
+        stream << "generation,changed";
+        for (unsigned int state = 0; state < m_statisticsColumns; state++)
+            stream << ",state" << state;
+        stream << '\n';
     }
 
-    loadRules(loadDoc.array());
+    if (m_keepStatistics || m_statisticsFile != nullptr)
+        recordStatistics(statistics);
+}
+
+/** \brief Statistics of each generation since setStatistics(), if they are kept
+ */
+const QVector<Automate::GenerationStatistics> &Automate::getStatistics() const
+{
+    return m_statistics;
+}
+
+/** \brief Keep the statistics of a generation and write them in the CSV file if needed
+ */
+void Automate::recordStatistics(const GenerationStatistics &statistics)
+{
+    if (m_keepStatistics)
+        m_statistics.push_back(statistics);
+    if (m_statisticsFile == nullptr)
+        return;
+
+    QTextStream stream(m_statisticsFile);
+    stream << statistics.generation << ',' << statistics.nbChanged;
+    const int nbColumns = qMax((int)m_statisticsColumns, statistics.population.size());
+    for (int state = 0; state < nbColumns; state++)
+        stream << ',' << (state < statistics.population.size() ? statistics.population.at(state) : 0);
+    stream << '\n';
+}
+
+/** \brief Cycle found by the last run(), see run()
+ */
+const Automate::Attractor &Automate::getAttractor() const
+{
+    return m_attractor;
+}
+
+/** \brief Accessor of m_cycleDetectionDepth
+ */
+unsigned int Automate::getCycleDetectionDepth() const
+{
+    return m_cycleDetectionDepth;
+}
+
+/** \brief Change the number of recent generations remembered by run(), which is the longest period it can find
+ */
+void Automate::setCycleDetectionDepth(unsigned int depth)
+{
+    m_cycleDetectionDepth = depth;
+}
+
+/** \brief Describe the cycle, like "period 2 from step 10"
+ */
+QString Automate::Attractor::toString() const
+{
+    if (period == 0)
+        return QObject::tr("not settled");
+    if (period == 1)
+        return QObject::tr("fixed point at step %1").arg(start);
+    return QObject::tr("period %1 from step %2").arg(period).arg(start);
+}
+
+/** \brief Accessor of m_cellHandler
+ */
+const CellHandler &Automate::getCellHandler() const
+{
+    return *m_cellHandler;
+}
+
+/** \brief Accessor of m_cellHandler
+ */
+CellHandler &Automate::getCellHandler()
+{
+    return *m_cellHandler;
+}
+
+/** \brief Add the rules of the file to the Automate
+ *
+ * \param filename Rule file, see loadRuleDocument for the format
+ * \throw QString Unreadable or not valid file, no rule is then added
+ */
+void Automate::addRuleFile(QString filename){
+    if (!loadRuleDocument(readRuleFile(filename)))
+        throw QString(QObject::tr("Not valid rule file"));
 }
 
 /** \brief Generate the rules which corresponds to the automaton number
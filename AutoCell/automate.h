@@ -2,11 +2,28 @@
 #define AUTOMATE_H
 #include <QVector>
 #include <QList>
+#include <QSharedPointer>
+#include <QHash>
+#include <QQueue>
+#include <QPair>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QFile>
 
 #include "cellhandler.h"
 #include "rule.h"
 #include "neighbourrule.h"
 #include "matrixrule.h"
+#include "probabilisticrule.h"
+#include "neighbourhood.h"
+#include "compiledrules.h"
+#include "stepengine.h"
+#include "blockrule.h"
+#include "generationsrule.h"
+#include "blockengine.h"
+#include "framering.h"
+
+class FrameExporter;
 
 
 /** \class Automate
@@ -14,16 +31,74 @@
  */
 class Automate
 {
+public:
+    /** \brief Cycle reached by the automaton, found by run() when it stops early
+     *
+     * A period of 1 is a fixed point, a period of 0 means that nothing was found.
+     */
+    struct Attractor
+    {
+        unsigned int start = 0; ///< First generation of the cycle
+        unsigned int period = 0; ///< Number of generations of the cycle
+        QString toString() const;
+    };
+
+    /** \brief Population of each state at one generation, see setStatistics()
+     */
+    struct GenerationStatistics
+    {
+        unsigned int generation = 0; ///< Generation of the cells
+        quint64 nbChanged = 0; ///< Number of cells changed by the step which gave this generation
+        QVector<quint64> population; ///< Number of cells of each state
+    };
+
 private:
     CellHandler* m_cellHandler = nullptr; ///< CellHandler to go through
     QList<const Rule*> m_rules; ///< Rules to use on the cells
+    QSharedPointer<const CompiledRules> m_compiledRules; ///< Flat version of m_rules, null if it must be rebuilt
+    StepEngine* m_engine = nullptr; ///< Engine which applies m_compiledRules on the cells
+    BlockEngine* m_blockEngine = nullptr; ///< Engine of the block rule, used instead of m_engine if there is one
+    quint32 m_randomSeed = 0; ///< Seed of the draws of the probabilistic rules
+    StepEngine::updateSchedules m_schedule = StepEngine::synchronous; ///< Order of the updates of the cells
+    unsigned int m_blockSize = 0; ///< Period of the phases of blockSequential schedules, 0 for the smallest independent one
+    unsigned int m_lookupTableBudget = 1 << 16; ///< Maximum number of entries of the lookup table of the rules
+    unsigned int m_cycleDetectionDepth = 64; ///< Number of recent generations remembered to find a cycle
+    Attractor m_attractor; ///< Cycle found by the last run()
+    QString m_checkpointFile; ///< File of the periodic checkpoints
+    unsigned int m_checkpointInterval = 0; ///< Number of generations between two checkpoints, 0 for none
+    QFuture<bool> m_checkpointWriting; ///< Writing of the last checkpoint
+    FrameRing* m_frameRing = nullptr; ///< Shared memory where the frames are published, nullptr for none
+    unsigned int m_frameInterval = 0; ///< Number of generations between two published frames
+    FrameExporter* m_frameExporter = nullptr; ///< Exporter of the frames, not owned, nullptr for none
+    unsigned int m_exportInterval = 0; ///< Number of generations between two exported frames
+    bool m_keepStatistics = false; ///< True if the statistics of each generation are kept in m_statistics
+    QVector<GenerationStatistics> m_statistics; ///< Statistics of the generations since setStatistics()
+    QFile* m_statisticsFile = nullptr; ///< CSV file where the statistics are streamed, nullptr for none
+    unsigned int m_statisticsColumns = 0; ///< Number of state columns in the header of the CSV file
     friend class AutomateHandler;
+    friend class Checkpoint;
+    friend class SlabCluster;
+    friend class SlabWorker;
 
     bool loadRules(const QJsonArray &json);
+    bool parseRules(const QJsonArray &json, QList<const Rule*> &rules) const;
+    bool loadRuleDocument(const QJsonDocument &document);
+    static QJsonDocument readRuleFile(QString filename);
+    static bool readStates(const QJsonValue &json, QVector<unsigned int> &states);
+    const BlockRule* getBlockRule() const;
+    QJsonDocument ruleDocument() const;
+    void invalidateRules();
+    void buildCompiledRules();
+    void compileRules();
+    void checkpointIfDue();
+    void publishFrameIfDue();
+    void advance(bool keepHistory, quint64 *hashDelta = nullptr);
+    void recordStatistics(const GenerationStatistics &statistics);
 public:
     Automate(QString filename);
     Automate(const QVector<unsigned int> dimensions, CellHandler::generationTypes type = CellHandler::empty, unsigned int stateMax = 1, unsigned int density = 20);
     Automate(QString cellHandlerFilename, QString ruleFilename);
+    Automate* createReplica(CellHandler::generationTypes type, unsigned int stateMax, unsigned int density, quint32 seed) const;
     virtual ~Automate();
 
     bool saveRules(QString filename) const ;
@@ -34,12 +109,38 @@ public:
     void addRule(const Rule* newRule);
     void setRulePriority(const Rule* rule, unsigned int newPlace);
     const QList<const Rule *> &getRules() const;
+    bool hasBlockRule() const;
+    const Neighbourhood &getNeighbourhood() const;
+    void setNeighbourhood(const Neighbourhood &neighbourhood);
+    CellHandler::boundaryTypes getBoundary() const;
+    void setBoundary(CellHandler::boundaryTypes boundary);
+    unsigned int getLookupTableBudget() const;
+    void setLookupTableBudget(unsigned int entries);
+    quint32 getRandomSeed() const;
+    void setRandomSeed(quint32 seed);
+    StepEngine::updateSchedules getUpdateSchedule() const;
+    unsigned int getBlockSize() const;
+    void setUpdateSchedule(StepEngine::updateSchedules schedule, unsigned int blockSize = 0);
 
 
 
 public:
-    bool run(unsigned int nbSteps = 1);
+    bool run(unsigned int nbSteps = 1, bool stopWhenSettled = false, bool keepHistory = true);
+    bool fastForward(unsigned int nbSteps, const QAtomicInt *cancelled = nullptr, QAtomicInt *progress = nullptr);
+    QFuture<bool> saveCheckpoint(QString filename);
+    void setCheckpoints(QString filename, unsigned int interval);
+    unsigned int getCheckpointInterval() const;
+    void setFrameExport(QString name, unsigned int interval, unsigned int nbSlots = 4);
+    unsigned int getFrameInterval() const;
+    const FrameRing* getFrameRing() const;
+    void setFrameExporter(FrameExporter* exporter, unsigned int interval);
+    void setStatistics(bool keepSeries, QString filename = QString());
+    const QVector<GenerationStatistics> &getStatistics() const;
+    const Attractor &getAttractor() const;
+    unsigned int getCycleDetectionDepth() const;
+    void setCycleDetectionDepth(unsigned int depth);
     const CellHandler& getCellHandler() const;
+    CellHandler& getCellHandler();
 };
 
 QList<const Rule*> generate1DRules(unsigned int automatonNumber);
@@ -1,3 +1,5 @@
+#include <QtConcurrent>
+
 #include "automatehandler.h"
 
 /** \brief Initialization of the static value
@@ -17,8 +19,8 @@ AutomateHandler::AutomateHandler()
  */
 AutomateHandler::~AutomateHandler()
 {
-    while(!m_ActiveAutomates.empty())
-        delete(m_ActiveAutomates.first());
+    qDeleteAll(m_ActiveAutomates);
+    m_ActiveAutomates.clear();
 }
 
 
@@ -72,7 +74,7 @@ unsigned int AutomateHandler::getNumberAutomates()const
 
 /** \brief Add an automate in the automate list
  *
- * \param automate to be added to the automate list
+ * \param automate to be added to the automate list, nullptr to reserve a slot (see setAutomate())
  *
  */
 void AutomateHandler::addAutomate(Automate * automate)
@@ -94,3 +96,109 @@ void AutomateHandler::deleteAutomate(Automate * automate)
         m_ActiveAutomates.removeOne(automate);
     }
 }
+
+
+/** \brief Replace the automate at an index of the list
+ *
+ * A slot can be reserved with addAutomate(nullptr) while its automate is loaded in another thread,
+ * and filled by this function once it is loaded.
+ *
+ * \param indexAutomate Index of the automate in the automate list
+ * \param automate New automate, the previous one is deleted
+ */
+void AutomateHandler::setAutomate(int indexAutomate, Automate * automate)
+{
+    if(indexAutomate < 0 || indexAutomate >= m_ActiveAutomates.size())
+        return;
+    delete m_ActiveAutomates.at(indexAutomate);
+    m_ActiveAutomates[indexAutomate] = automate;
+}
+
+
+/** \brief Delete the automate at an index of the list and remove its slot, even if it is empty
+ *
+ * \param indexAutomate Index of the automate in the automate list
+ */
+void AutomateHandler::removeAutomate(int indexAutomate)
+{
+    if(indexAutomate < 0 || indexAutomate >= m_ActiveAutomates.size())
+        return;
+    delete m_ActiveAutomates.takeAt(indexAutomate);
+}
+
+
+/** \brief Start the run of one replica of an automate on the thread pool
+ *
+ * The replica (see Automate::createReplica()) is run nbSteps times, summarized and deleted. It shares the compiled
+ * rules of the model, and its generations are not kept in the history. The model must not be modified until
+ * the run is finished.
+ *
+ * \param model Automate giving the dimensions, neighbourhood, boundary and rules
+ * \param member Initial cells of the replica
+ * \param nbSteps Number of iterations of the replica
+ * \param type Generation type of the cells
+ * \param stateMax Generate states between 0 and stateMax
+ * \param stopWhenSettled Stop the replica as soon as it reaches a fixed point or a cycle
+ * \param pool Thread pool running the replica
+ * \return Future summary of the run
+ */
+QFuture<AutomateHandler::EnsembleSummary> AutomateHandler::startReplica(Automate * model, const EnsembleMember &member, unsigned int nbSteps,
+                                                                        CellHandler::generationTypes type, unsigned int stateMax,
+                                                                        bool stopWhenSettled, QThreadPool * pool) const
+{
+    // Compiled here, then only read by the replicas. The model itself is not run, it needs no engine
+    model->buildCompiledRules();
+
+    return QtConcurrent::run(pool, [=]() {
+        Automate* replica = model->createReplica(type, stateMax, member.density, member.seed);
+        replica->run(nbSteps, stopWhenSettled, false);
+
+        const CellHandler& cells = replica->getCellHandler();
+        EnsembleSummary summary;
+        summary.member = member;
+        summary.generations = cells.getGeneration();
+        summary.attractor = replica->getAttractor();
+        summary.hash = cells.hash();
+        const QVector<unsigned int> states = cells.getSnapshot();
+        for (QVector<unsigned int>::const_iterator it = states.cbegin(); it != states.cend(); ++it)
+        {
+            if (*it >= (unsigned int)summary.population.size())
+                summary.population.resize(*it + 1);
+            summary.population[*it]++;
+        }
+
+        delete replica;
+        return summary;
+    });
+}
+
+
+/** \brief Run replicas of an automate concurrently, with different initial cells
+ *
+ * Each member gives a replica of the model which is run on the thread pool, see startReplica().
+ * The compiled rules of the model are shared by all the replicas.
+ *
+ * \param model Automate giving the dimensions, neighbourhood, boundary and rules
+ * \param members Initial cells of each replica
+ * \param nbSteps Number of iterations of each replica
+ * \param type Generation type of the cells
+ * \param stateMax Generate states between 0 and stateMax
+ * \param stopWhenSettled Stop a replica as soon as it reaches a fixed point or a cycle
+ * \param pool Thread pool running the replicas
+ * \return The summary of each replica, in the order of members
+ */
+QVector<AutomateHandler::EnsembleSummary> AutomateHandler::runEnsemble(Automate * model, const QVector<EnsembleMember> &members, unsigned int nbSteps,
+                                                                       CellHandler::generationTypes type, unsigned int stateMax,
+                                                                       bool stopWhenSettled, QThreadPool * pool) const
+{
+    QVector<QFuture<EnsembleSummary> > runs;
+    runs.reserve(members.size());
+    for (int i = 0; i < members.size(); i++)
+        runs.append(startReplica(model, members.at(i), nbSteps, type, stateMax, stopWhenSettled, pool));
+
+    QVector<EnsembleSummary> summaries;
+    summaries.reserve(runs.size());
+    for (int i = 0; i < runs.size(); i++)
+        summaries.append(runs[i].result());
+    return summaries;
+}
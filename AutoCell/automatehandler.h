@@ -1,6 +1,9 @@
 #ifndef AUTOMATEHANDLER_H
 #define AUTOMATEHANDLER_H
 
+#include <QThreadPool>
+#include <QFuture>
+
 #include "automate.h"
 
 
@@ -9,6 +12,26 @@
  */
 class AutomateHandler
 {
+public:
+    /** \brief Initial cells of one replica of an ensemble
+     */
+    struct EnsembleMember
+    {
+        quint32 seed = 0; ///< Seed of the random generation
+        unsigned int density = 20; ///< Average (%) of non-zeros
+    };
+
+    /** \brief Result of the run of one replica of an ensemble
+     */
+    struct EnsembleSummary
+    {
+        EnsembleMember member; ///< Initial cells of the replica
+        unsigned int generations = 0; ///< Number of generations computed
+        Automate::Attractor attractor; ///< Cycle reached, if the run stopped when settled
+        QVector<unsigned int> population; ///< Number of cells of each state at the end of the run
+        quint64 hash = 0; ///< Hash of the final cells, see CellHandler::hash()
+    };
+
 private:
     QList<Automate*> m_ActiveAutomates; ///< list of existing automates
     static AutomateHandler * m_activeAutomateHandler; ///< active automate handler if existing, nullptr else
@@ -27,6 +50,15 @@ public:
 
     void addAutomate(Automate * automate);
     void deleteAutomate(Automate * automate);
+    void setAutomate(int indexAutomate, Automate * automate);
+    void removeAutomate(int indexAutomate);
+
+    QFuture<EnsembleSummary> startReplica(Automate * model, const EnsembleMember &member, unsigned int nbSteps,
+                                          CellHandler::generationTypes type = CellHandler::random, unsigned int stateMax = 1,
+                                          bool stopWhenSettled = true, QThreadPool * pool = QThreadPool::globalInstance()) const;
+    QVector<EnsembleSummary> runEnsemble(Automate * model, const QVector<EnsembleMember> &members, unsigned int nbSteps,
+                                         CellHandler::generationTypes type = CellHandler::random, unsigned int stateMax = 1,
+                                         bool stopWhenSettled = true, QThreadPool * pool = QThreadPool::globalInstance()) const;
 };
 
 
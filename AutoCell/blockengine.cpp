@@ -0,0 +1,220 @@
+#include <QtConcurrent>
+
+#include "blockengine.h"
+
+/** \brief Number of blocks computed by a thread at once
+ */
+static const quint64 blockEngineTileBlocks = 1 << 12;
+
+/** \brief Prepare the offsets of the cells of a block
+ *
+ * \param rule Block rule to apply, the engine keeps a copy of its tables
+ * \param dimensions Dimensions of the grid
+ * \param boundary Behaviour of the blocks at the borders of the grid
+ * \throw QString The block doesn't have the dimension of the grid
+ */
+BlockEngine::BlockEngine(const BlockRule &rule, const QVector<unsigned int> &dimensions, CellHandler::boundaryTypes boundary) :
+    m_blockSize(rule.getBlockSize()), m_nbStates(rule.getNbStates()), m_table(rule.getTable(0)), m_oddTable(rule.getTable(1)),
+    m_dimensions(dimensions), m_size(1), m_wrap(boundary == CellHandler::toroidal)
+{
+    if (m_blockSize.size() != m_dimensions.size())
+        throw QString(QObject::tr("The block doesn't have the dimension of the grid"));
+    for (int i = 0; i < m_dimensions.size(); i++)
+    {
+        m_strides.push_back(m_size);
+        m_size *= m_dimensions.at(i);
+        if (m_dimensions.at(i) % m_blockSize.at(i) != 0)
+            m_wrap = false;
+    }
+
+    unsigned int nbCells = rule.getNbCells();
+    for (unsigned int cell = 0; cell < nbCells; cell++)
+    {
+        unsigned int rest = cell;
+        unsigned int offset = 0;
+        for (int i = 0; i < m_blockSize.size(); i++)
+        {
+            m_cellCoordinates.push_back(rest % m_blockSize.at(i));
+            offset += (rest % m_blockSize.at(i)) * m_strides.at(i);
+            rest /= m_blockSize.at(i);
+        }
+        m_cellOffsets.push_back(offset);
+    }
+}
+
+/** \brief True if the shifted blocks wrap around the grid instead of stopping at its borders
+ */
+bool BlockEngine::wrapsAround() const
+{
+    return m_wrap;
+}
+
+/** \brief Compute the next generation
+ *
+ * \param states Current states, by linear index
+ * \param nextStates Output, next states by linear index
+ * \param generation Current generation: the blocks are shifted by half a block at odd generations
+ * \param hashDelta If not nullptr, the change of the hash of the grid (see CellHandler::hashCell) is added to it
+ * \param population If not nullptr, replaced by the number of cells of each state in the next generation
+ * \param nbChanged If not nullptr, set to the number of cells whose state changes
+ */
+void BlockEngine::step(const unsigned int *states, unsigned int *nextStates, unsigned int generation, quint64 *hashDelta,
+                       QVector<quint64> *population, quint64 *nbChanged) const
+{
+    if (m_size == 0)
+        return;
+
+    // First block and number of blocks on each dimension. Without wrapping, the shifted partition starts
+    // with a block partly before the grid
+    QVector<int> starts;
+    QVector<unsigned int> counts;
+    quint64 nbBlocks = 1;
+    for (int i = 0; i < m_dimensions.size(); i++)
+    {
+        int offset = generation % 2 == 1 ? m_blockSize.at(i) / 2 : 0;
+        int start = m_wrap || offset == 0 ? offset : offset - (int)m_blockSize.at(i);
+        starts.push_back(start);
+        counts.push_back(m_wrap ? m_dimensions.at(i) / m_blockSize.at(i)
+                                : ((int)m_dimensions.at(i) - start + m_blockSize.at(i) - 1) / m_blockSize.at(i));
+        nbBlocks *= counts.last();
+    }
+
+    const unsigned int *table = generation % 2 == 1 ? m_oddTable.constData() : m_table.constData();
+    QVector<TileStatistics> tiles((nbBlocks + blockEngineTileBlocks - 1) / blockEngineTileBlocks);
+    QVector<int> tileIndexes;
+    for (int t = 0; t < tiles.size(); t++)
+        tileIndexes.push_back(t);
+    TileStatistics *tileStatistics = tiles.data();
+    const bool countPopulation = population != nullptr;
+    const bool computeHash = hashDelta != nullptr;
+    QtConcurrent::blockingMap(tileIndexes, [=](const int &t) {
+        quint64 first = t * blockEngineTileBlocks;
+        stepTile(states, nextStates, table, starts, counts, first, qMin(first + blockEngineTileBlocks, nbBlocks),
+                 countPopulation, computeHash, tileStatistics[t]);
+    });
+
+    // Sums in the order of the tiles
+    if (population != nullptr)
+        population->fill(0, m_nbStates);
+    quint64 changed = 0;
+    for (int t = 0; t < tiles.size(); t++)
+    {
+        const TileStatistics &tile = tiles.at(t);
+        if (population != nullptr)
+        {
+            if (tile.population.size() > population->size())
+                population->resize(tile.population.size());
+            for (int state = 0; state < tile.population.size(); state++)
+                (*population)[state] += tile.population.at(state);
+        }
+        changed += tile.nbChanged;
+        if (hashDelta != nullptr)
+            *hashDelta += tile.hashDelta;
+    }
+    if (nbChanged != nullptr)
+        *nbChanged = changed;
+}
+
+/** \brief Compute a range of blocks
+ *
+ * \param states Current states
+ * \param nextStates Output, next states
+ * \param table Transition table of the generation
+ * \param starts First coordinate of the first block on each dimension
+ * \param counts Number of blocks on each dimension
+ * \param firstBlock Number of the first block of the range
+ * \param lastBlock Number of the block after the range
+ * \param countPopulation Count the cells of each state, only if the population is asked to step()
+ * \param computeHash Compute the change of the hash, only if it is asked to step()
+ * \param statistics Output, statistics of the range
+ */
+void BlockEngine::stepTile(const unsigned int *states, unsigned int *nextStates, const unsigned int *table, const QVector<int> &starts,
+                           const QVector<unsigned int> &counts, quint64 firstBlock, quint64 lastBlock, bool countPopulation, bool computeHash,
+                           TileStatistics &statistics) const
+{
+    const int d = m_dimensions.size();
+    const int nbCells = m_cellOffsets.size();
+    QVector<unsigned int> indexes(nbCells);
+    QVector<int> origin(d);
+    if (countPopulation)
+        statistics.population.fill(0, m_nbStates);
+
+    for (quint64 block = firstBlock; block < lastBlock; block++)
+    {
+        // Coordinates of the first cell of the block, and whether the block fits in the grid
+        quint64 rest = block;
+        bool inside = true;
+        unsigned int base = 0;
+        for (int i = 0; i < d; i++)
+        {
+            origin[i] = starts.at(i) + (int)(rest % counts.at(i)) * (int)m_blockSize.at(i);
+            rest /= counts.at(i);
+            if (origin.at(i) < 0 || origin.at(i) + m_blockSize.at(i) > m_dimensions.at(i))
+                inside = false;
+            base += origin.at(i) * m_strides.at(i);
+        }
+
+        // Linear index of each cell, the cells out of the grid of a partial block are marked with m_size
+        bool complete = true;
+        for (int k = 0; k < nbCells; k++)
+        {
+            if (inside)
+            {
+                indexes[k] = base + m_cellOffsets.at(k);
+                continue;
+            }
+            unsigned int index = 0;
+            for (int i = 0; i < d; i++)
+            {
+                int coordinate = origin.at(i) + m_cellCoordinates.at(k * d + i);
+                if (m_wrap)
+                    coordinate %= m_dimensions.at(i);
+                else if (coordinate < 0 || coordinate >= (int)m_dimensions.at(i))
+                {
+                    index = m_size;
+                    complete = false;
+                    break;
+                }
+                index += coordinate * m_strides.at(i);
+            }
+            indexes[k] = index;
+        }
+
+        // Configuration of the block, digits in base m_nbStates
+        unsigned int configuration = 0;
+        unsigned int weight = 1;
+        for (int k = 0; k < nbCells && complete; k++)
+        {
+            unsigned int state = states[indexes.at(k)];
+            if (state >= m_nbStates)
+                complete = false;
+            configuration += state * weight;
+            weight *= m_nbStates;
+        }
+        unsigned int next = complete ? table[configuration] : 0;
+
+        for (int k = 0; k < nbCells; k++)
+        {
+            unsigned int index = indexes.at(k);
+            if (index == m_size)
+                continue;
+            unsigned int state = states[index];
+            unsigned int nextState = complete ? next % m_nbStates : state;
+            next /= m_nbStates;
+            nextStates[index] = nextState;
+
+            if (countPopulation)
+            {
+                if (nextState >= (unsigned int)statistics.population.size())
+                    statistics.population.resize(nextState + 1);
+                statistics.population[nextState]++;
+            }
+            if (nextState != state)
+            {
+                statistics.nbChanged++;
+                if (computeHash)
+                    statistics.hashDelta += CellHandler::hashCell(index, nextState) - CellHandler::hashCell(index, state);
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef BLOCKENGINE_H
+#define BLOCKENGINE_H
+
+#include <QVector>
+
+#include "blockrule.h"
+#include "cellhandler.h"
+
+/** \class BlockEngine
+ * \brief Compute the next generation of a block cellular automaton, see BlockRule
+ *
+ * The blocks are independent, so they are computed in parallel by tiles of blocks. A block only needs the
+ * linear offsets of its cells from its first cell: there is no neighbour map and no padded grid.
+ *
+ * With toroidal boundaries and dimensions which are multiples of the block size, the shifted partition wraps
+ * around the grid. Otherwise the blocks which don't fit in the grid, at the borders, are not changed.
+ *
+ * The statistics of the step (hash delta, population, changed cells) are computed with the blocks, by tile,
+ * and the tiles are summed in their order.
+ */
+class BlockEngine
+{
+public:
+    BlockEngine(const BlockRule &rule, const QVector<unsigned int> &dimensions, CellHandler::boundaryTypes boundary = CellHandler::fixedZero);
+
+    void step(const unsigned int *states, unsigned int *nextStates, unsigned int generation, quint64 *hashDelta = nullptr,
+              QVector<quint64> *population = nullptr, quint64 *nbChanged = nullptr) const;
+    bool wrapsAround() const;
+
+private:
+    /** \brief Statistics of a tile of blocks
+     */
+    struct TileStatistics
+    {
+        QVector<quint64> population; ///< Number of cells of each state in the next generation
+        quint64 nbChanged = 0; ///< Number of changed cells
+        quint64 hashDelta = 0; ///< Change of the hash of the grid
+    };
+
+    void stepTile(const unsigned int *states, unsigned int *nextStates, const unsigned int *table, const QVector<int> &starts,
+                  const QVector<unsigned int> &counts, quint64 firstBlock, quint64 lastBlock, bool countPopulation, bool computeHash,
+                  TileStatistics &statistics) const;
+
+    QVector<unsigned int> m_blockSize; ///< Number of cells of a block on each dimension
+    unsigned int m_nbStates; ///< Number of states of the tables
+    QVector<unsigned int> m_table; ///< Transition table of the even generations
+    QVector<unsigned int> m_oddTable; ///< Transition table of the odd generations
+    QVector<unsigned int> m_dimensions; ///< Dimensions of the grid
+    unsigned int m_size; ///< Number of cells
+    bool m_wrap; ///< True if the blocks wrap around the grid
+    QVector<unsigned int> m_strides; ///< Linear stride of each dimension
+    QVector<unsigned int> m_cellOffsets; ///< Linear offset of each cell of a block from its first cell
+    QVector<unsigned int> m_cellCoordinates; ///< Coordinates of each cell of a block in the block, dimension by dimension
+};
+
+#endif // BLOCKENGINE_H
@@ -0,0 +1,125 @@
+#include "blockrule.h"
+
+/** \brief Greatest number of configurations of a block
+ */
+static const quint64 blockRuleMaxConfigurations = 1 << 24;
+
+/** \brief Greatest number of cells of a block, a block of 2 states with more cells has too many configurations
+ */
+static const quint64 blockRuleMaxCells = 24;
+
+/** \brief Constructs a block rule
+ *
+ * \param blockSize Number of cells of a block on each dimension
+ * \param nbStates Number of states of the cells
+ * \param table Next configuration of each of the nbStates^(cells of a block) configurations
+ * \param oddTable Table of the odd generations, empty to use the same table
+ * \throw QString Not valid block size
+ * \throw QString The block has too many configurations
+ * \throw QString Not valid table
+ */
+BlockRule::BlockRule(const QVector<unsigned int> &blockSize, unsigned int nbStates, const QVector<unsigned int> &table, const QVector<unsigned int> &oddTable) :
+    Rule(QVector<unsigned int>(), 0), m_blockSize(blockSize), m_nbStates(nbStates), m_table(table), m_oddTable(oddTable)
+{
+    if (blockSize.isEmpty() || blockSize.contains(0) || nbStates < 2)
+        throw QString(QObject::tr("Not valid block size"));
+    quint64 nbCells = 1;
+    for (int i = 0; i < blockSize.size(); i++)
+    {
+        nbCells *= qMin((quint64)blockSize.at(i), blockRuleMaxCells + 1);
+        if (nbCells > blockRuleMaxCells)
+            throw QString(QObject::tr("The block has too many configurations"));
+    }
+    quint64 nbConfigurations = 1;
+    for (unsigned int cell = 0; cell < getNbCells(); cell++)
+    {
+        nbConfigurations *= nbStates;
+        if (nbConfigurations > blockRuleMaxConfigurations)
+            throw QString(QObject::tr("The block has too many configurations"));
+    }
+    if ((quint64)table.size() != nbConfigurations || (!oddTable.isEmpty() && (quint64)oddTable.size() != nbConfigurations))
+        throw QString(QObject::tr("The table must have %1 configurations").arg(nbConfigurations));
+    for (int i = 0; i < table.size(); i++)
+        if (table.at(i) >= nbConfigurations || (!oddTable.isEmpty() && oddTable.at(i) >= nbConfigurations))
+            throw QString(QObject::tr("Not valid configuration in the table"));
+}
+
+/** \brief Accessor of m_blockSize
+ */
+const QVector<unsigned int> &BlockRule::getBlockSize() const
+{
+    return m_blockSize;
+}
+
+/** \brief Number of cells of a block, at most blockRuleMaxCells
+ */
+unsigned int BlockRule::getNbCells() const
+{
+    unsigned int nbCells = 1;
+    for (int i = 0; i < m_blockSize.size(); i++)
+        nbCells *= m_blockSize.at(i);
+    return nbCells;
+}
+
+/** \brief Accessor of m_nbStates
+ */
+unsigned int BlockRule::getNbStates() const
+{
+    return m_nbStates;
+}
+
+/** \brief Transition table used at the given generation
+ */
+const QVector<unsigned int> &BlockRule::getTable(unsigned int generation) const
+{
+    return generation % 2 == 1 && !m_oddTable.isEmpty() ? m_oddTable : m_table;
+}
+
+/** \brief A block rule doesn't apply to a single cell
+ */
+bool BlockRule::matchCell(const Cell *) const
+{
+    return false;
+}
+
+/** \brief Nothing to compile, the block rules are applied by a BlockEngine
+ */
+void BlockRule::compile(CompiledRules &) const
+{
+
+}
+
+/** \brief Copy of the rule, to be deleted by the caller
+ */
+BlockRule *BlockRule::clone() const
+{
+    return new BlockRule(*this);
+}
+
+/** \brief Return a QJsonObject to save the rule
+ */
+QJsonObject BlockRule::toJson() const
+{
+    QJsonObject object;
+    object.insert("type", QJsonValue("block"));
+
+    QJsonArray blockSize;
+    for (int i = 0; i < m_blockSize.size(); i++)
+        blockSize.append(QJsonValue((int)m_blockSize.at(i)));
+    object.insert("blockSize", blockSize);
+    object.insert("nbStates", QJsonValue((int)m_nbStates));
+
+    QJsonArray table;
+    for (int i = 0; i < m_table.size(); i++)
+        table.append(QJsonValue((int)m_table.at(i)));
+    object.insert("table", table);
+    if (!m_oddTable.isEmpty())
+    {
+        QJsonArray oddTable;
+        for (int i = 0; i < m_oddTable.size(); i++)
+            oddTable.append(QJsonValue((int)m_oddTable.at(i)));
+        object.insert("oddTable", oddTable);
+    }
+
+    return object;
+}
@@ -0,0 +1,48 @@
+#ifndef BLOCKRULE_H
+#define BLOCKRULE_H
+
+#include <QVector>
+#include "rule.h"
+
+/** \class BlockRule
+ * \brief Rule of a block cellular automaton: the grid is split in blocks, each block is replaced as a whole
+ *
+ * At each step the grid is partitioned in blocks of blockSize cells, and each block gets the configuration
+ * given by the transition table for its current configuration. The partition is shifted by half a block on
+ * every dimension at odd generations (Margolus neighbourhood), so information crosses the borders of the blocks.
+ *
+ * A configuration is the number whose digits in base nbStates are the states of the cells of the block,
+ * the first cell (lowest coordinates) being the lowest digit and the first dimension the fastest, as the
+ * linear indexes of a grid. The table gives the next configuration of each configuration. An optional second
+ * table is used at odd generations (for example Critters). Margolus "billiard ball" gas:
+ * \code
+ * {"type": "block", "blockSize": [2, 2], "nbStates": 2,
+ *  "table": [0, 8, 4, 3, 2, 5, 9, 7, 1, 6, 10, 11, 12, 13, 14, 15]}
+ * \endcode
+ *
+ * When the rules of an automate contain a BlockRule, it is applied by a BlockEngine instead of the other
+ * rules, see Automate::compileRules(). compile() and matchCell() don't apply to a block rule.
+ */
+class BlockRule : public Rule
+{
+protected:
+    QVector<unsigned int> m_blockSize; ///< Number of cells of a block on each dimension
+    unsigned int m_nbStates; ///< Number of states of the cells, the blocks with other states are not changed
+    QVector<unsigned int> m_table; ///< Next configuration of each configuration
+    QVector<unsigned int> m_oddTable; ///< Table of the odd generations, empty to use m_table
+public:
+    BlockRule(const QVector<unsigned int> &blockSize, unsigned int nbStates, const QVector<unsigned int> &table,
+              const QVector<unsigned int> &oddTable = QVector<unsigned int>());
+
+    const QVector<unsigned int> &getBlockSize() const;
+    unsigned int getNbCells() const;
+    unsigned int getNbStates() const;
+    const QVector<unsigned int> &getTable(unsigned int generation) const;
+
+    bool matchCell(const Cell * c) const;
+    void compile(CompiledRules &program) const;
+    BlockRule* clone() const;
+    QJsonObject toJson() const;
+};
+
+#endif // BLOCKRULE_H
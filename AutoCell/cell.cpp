@@ -1,135 +1,108 @@
 #include "cell.h"
+#include "cellhandler.h"
 
-/** \brief Constructs a cell with the state given. State 0 is dead state
+/** \brief Constructs a view on the cell of the given CellHandler
  *
- * \param state Cell state, dead state by default
+ * \param handler CellHandler which stores the states
+ * \param index Linear index of the cell in the CellHandler
  */
-Cell::Cell(unsigned int state):
-    m_nextState(state)
+Cell::Cell(CellHandler *handler, unsigned int index):
+    m_handler(handler), m_index(index)
 {
-    m_states.push(state);
 }
 
 /** \brief Set temporary state
  *
  * To change current cell state, use setState(unsigned int state) then
- * validState().
- *(
+ * CellHandler::nextStates().
+ *
  * \param state New state
  */
 void Cell::setState(unsigned int state)
 {
-    m_nextState = state;
-}
-
-/** \brief Validate temporary state
- *
- * To change current cell state, use setState(unsigned int state) then
- * validState().
- */
-void Cell::validState()
-{
-    m_states.push(m_nextState);
+    m_handler->m_nextStates[m_index] = state;
 }
 
 /** \brief Force the state change.
  *
- * Is equivalent to setState followed by validState
+ * Is equivalent to setState followed by a validation, without adding a generation
  *
  * \param state New state
  */
 void Cell::forceState(unsigned int state)
 {
-    m_nextState = state;
-    m_states.pop();
-    m_states.push(m_nextState);
+    m_handler->m_states[m_index] = state;
+    m_handler->m_nextStates[m_index] = state;
 }
 
 /** \brief Access current cell state
  */
 unsigned int Cell::getState() const
 {
-    return m_states.top();
+    return m_handler->m_states.at(m_index);
 }
 
-/** \brief Set the previous state
- *
- * \return Return false if we are already at the first state
+/** \brief Linear index of the cell in its CellHandler
  */
-bool Cell::back()
+unsigned int Cell::getIndex() const
 {
-    if (m_states.size() <= 1)
-        return false;
-    m_states.pop();
-    m_nextState = m_states.top();
-    return true;
+    return m_index;
 }
 
-/** \brief Reset the cell to the 1st state
+/** \brief Position of the cell in its CellHandler
  */
-void Cell::reset()
+QVector<unsigned int> Cell::getPosition() const
 {
-    while (m_states.size() > 1)
-        m_states.pop();
-    m_nextState = m_states.top();
+    return m_handler->getPosition(m_index);
 }
 
-/** \fn bool Cell::addNeighbour(const Cell* neighbour)
- * \brief Add a new neighbour to the Cell
+/** \brief Access neighbours list
  *
- * \param relativePosition Relative position of the new neighbour
- * \param neighbour New neighbour
- * \return False if the neighbour already exists
+ * The map key is the relative position of the neighbour (like -1,0 for the cell just above).
+ * The map is built on demand, prefer getNeighbour or countNeighbours.
  */
-bool Cell::addNeighbour(const Cell* neighbour, const QVector<short> relativePosition)
+QMap<QVector<short>, Cell> Cell::getNeighbours() const
 {
-    if (m_neighbours.count(relativePosition))
-        return false;
-
-    m_neighbours.insert(relativePosition, neighbour);
-    return true;
+    QMap<QVector<short>, Cell> neighbours;
+    const QVector<QVector<short> > &positions = m_handler->getNeighbourPositions();
+    for (int i = 0; i < positions.size(); i++)
+    {
+        int index = m_handler->getNeighbourIndex(m_index, positions.at(i));
+        if (index >= 0)
+            neighbours.insert(positions.at(i), Cell(m_handler, index));
+    }
+    return neighbours;
 }
 
-/** \brief Access neighbours list
+/** \brief Tell if there is a neighbour at the relative position
  *
- * The map key is the relative position of the neighbour (like -1,0 for the cell just above)
+ * The positions out of the neighbourhood of the CellHandler, or out of a fixedZero border, have no cell.
  */
-QMap<QVector<short>, const Cell *> Cell::getNeighbours() const
+bool Cell::hasNeighbour(QVector<short> relativePosition) const
 {
-    return m_neighbours;
+    return m_handler->getNeighbourPositions().contains(relativePosition)
+            && m_handler->getNeighbourIndex(m_index, relativePosition) >= 0;
 }
 
-/** \brief Get the neighbour asked. If not existent, return nullptr
+/** \brief Get the neighbour asked, which must exist (see hasNeighbour())
  */
-const Cell *Cell::getNeighbour(QVector<short> relativePosition) const
+Cell Cell::getNeighbour(QVector<short> relativePosition) const
 {
-    return m_neighbours.value(relativePosition, nullptr);
+    return Cell(m_handler, m_handler->getNeighbourIndex(m_index, relativePosition));
 }
 
 /** \brief Return the number of neighbour which have the given state
  */
 unsigned int Cell::countNeighbours(unsigned int filterState) const
 {
-    unsigned int count = 0;
-    for (QMap<QVector<short>, const Cell*>::const_iterator it = m_neighbours.begin(); it != m_neighbours.end(); ++it)
-    {
-        if ((*it)->getState() == filterState)
-            count++;
-    }
-    return count;
+    return m_handler->countNeighboursIf(m_index, [filterState](unsigned int state) { return state == filterState; });
 }
 
 /** \brief Return the number of neighbour which are not dead (=0)
  */
 unsigned int Cell::countNeighbours() const
 {
-    unsigned int count = 0;
-    for (QMap<QVector<short>, const Cell*>::const_iterator it = m_neighbours.begin(); it != m_neighbours.end(); ++it)
-    {
-        if ((*it)->getState() != 0)
-            count++;
-    }
-    return count;
+    return m_handler->countNeighboursIf(m_index, [](unsigned int state) { return state != 0; });
 }
 
 /** \brief Get the relative position, as neighbourPosition minus cellPosition
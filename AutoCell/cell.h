@@ -2,28 +2,33 @@
 #define CELL_H
 
 #include <QVector>
+#include <QMap>
 #include <QDebug>
-#include <QStack>
+
+class CellHandler;
 
 /** \class Cell
- * \brief Contains the state, the next state and the neighbours
+ * \brief Access to the state, the next state and the neighbours of one cell
+ *
+ * States are stored by the CellHandler in flat arrays, the Cell is only a view
+ * on its position in these arrays. Neighbours are computed on demand from the
+ * dimensions of the CellHandler, nothing is stored per cell.
  */
 class Cell
 {
 public:
-    Cell(unsigned int state = 0);
+    Cell(CellHandler* handler = nullptr, unsigned int index = 0);
 
     void setState(unsigned int state);
-    void validState();
     void forceState(unsigned int state);
     unsigned int getState() const;
 
-    bool back();
-    void reset();
+    unsigned int getIndex() const;
+    QVector<unsigned int> getPosition() const;
 
-    bool addNeighbour(const Cell* neighbour, const QVector<short> relativePosition);
-    QMap<QVector<short>, const Cell*> getNeighbours() const;
-    const Cell* getNeighbour(QVector<short> relativePosition) const;
+    QMap<QVector<short>, Cell> getNeighbours() const;
+    bool hasNeighbour(QVector<short> relativePosition) const;
+    Cell getNeighbour(QVector<short> relativePosition) const;
 
     unsigned int countNeighbours(unsigned int filterState) const;
     unsigned int countNeighbours() const;
@@ -31,10 +36,8 @@ public:
     static QVector<short> getRelativePosition(const QVector<unsigned int> cellPosition, const QVector<unsigned int> neighbourPosition);
 
 private:
-    QStack<unsigned int> m_states; ///< Current state
-    unsigned int m_nextState; ///< Temporary state, before validation
-
-    QMap<QVector<short>, const Cell*> m_neighbours; ///< Cell's neighbours. Key is the relative position of the neighbour
+    CellHandler* m_handler; ///< CellHandler which stores the states
+    unsigned int m_index; ///< Linear index of the cell in the CellHandler
 };
 
 #endif // CELL_H
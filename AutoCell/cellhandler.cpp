@@ -1,5 +1,11 @@
 #include <iostream>
+#include <QtConcurrent>
 #include "cellhandler.h"
+#include "counterrandom.h"
+
+/** \brief Number of cells filled by a task of generate()
+ */
+static const unsigned int generationTile = 1 << 16;
 
 /** \brief Construct all the cells from the json file given
  *
@@ -16,6 +22,8 @@
  *          1,2,0,0,0,0,1,2,3,2]
  * }
  * \endcode
+ * The optional "boundary" field gives the behaviour of the neighbours out of the grid:
+ * "fixedZero" (default), "toroidal" or "reflective".
  *
  * \param filename Json file which contains the description of all the cells
  * \throw QString Unreadable file
@@ -69,6 +77,7 @@ CellHandler::CellHandler(const QString filename)
  *          1,2,0,0,0,0,1,2,3,2]
  * }
  * \endcode
+ * The optional "boundary" field is described in CellHandler(const QString filename).
  *
  * \param json Json object which contains the description of all the cells
  * \throw QString Not valid file
@@ -98,25 +107,9 @@ CellHandler::CellHandler(const QJsonObject& json)
 CellHandler::CellHandler(const QVector<unsigned int> dimensions, generationTypes type, unsigned int stateMax, unsigned int density)
 {
     m_dimensions = dimensions;
-    QVector<unsigned int> position;
-    unsigned int size = 1;
-
-    // Set position vector to 0
-
-    for (unsigned short i = 0; i < m_dimensions.size(); i++)
-    {
-        position.push_back(0);
-        size *= m_dimensions.at(i);
-    }
 
-
-    // Creation of cells
-    for (unsigned int j = 0; j < size; j++)
-    {
-        m_cells.insert(position, new Cell(0));
-
-        positionIncrement(position);
-    }
+    // Creation of cells, all dead
+    allocate();
 
     foundNeighbours();
 
@@ -129,24 +122,31 @@ CellHandler::CellHandler(const QVector<unsigned int> dimensions, generationTypes
  */
 CellHandler::~CellHandler()
 {
-    for (QMap<QVector<unsigned int>, Cell* >::iterator it = m_cells.begin(); it != m_cells.end(); ++it)
-    {
-        delete it.value();
-    }
 }
 
 /** \brief Access the cell to the given position
+ *
+ * The Cell is a view on the states built on demand, nothing is stored per cell.
+ */
+Cell CellHandler::getCell(const QVector<unsigned int> position)
+{
+    return Cell(this, getIndex(position));
+}
+
+/** \brief Access the cell to the given position, read only
  */
-Cell *CellHandler::getCell(const QVector<unsigned int> position) const
+const Cell CellHandler::getCell(const QVector<unsigned int> position) const
 {
-    return m_cells.value(position);
+    return Cell(const_cast<CellHandler*>(this), getIndex(position));
 }
 
-/** \brief Return the max state of the CellHandler
+/** \brief Return the max state which can be given to a cell by the user
+ *
+ * It is the greatest state stored on 2 bytes by the StepEngine, every state has a color in the Palette.
  */
 unsigned int CellHandler::getMaxState()
 {
-    return QColor::colorNames().size()-2;
+    return 0xFFFF;
 }
 
 /** \brief Accessor of m_dimensions
@@ -156,36 +156,277 @@ QVector<unsigned int> CellHandler::getDimensions() const
     return m_dimensions;
 }
 
-/** \brief Valid the state of all cells
+/** \brief Return the number of cells
  */
-void CellHandler::nextStates() const
+unsigned int CellHandler::getSize() const
 {
-    for (QMap<QVector<unsigned int>, Cell* >::const_iterator it = m_cells.begin(); it != m_cells.end(); ++it)
+    return m_size;
+}
+
+/** \brief Compute the linear index of the given position
+ *
+ * \throw QString Position out of the grid
+ */
+unsigned int CellHandler::getIndex(const QVector<unsigned int> &position) const
+{
+    if (position.size() != m_dimensions.size())
+        throw QString(QObject::tr("Position out of the grid"));
+    unsigned int index = 0;
+    for (int i = 0; i < m_dimensions.size(); i++)
     {
-        it.value()->validState();
+        if (position.at(i) >= m_dimensions.at(i))
+            throw QString(QObject::tr("Position out of the grid"));
+        index += position.at(i) * m_strides.at(i);
     }
+    return index;
 }
 
-/** \brief Get all the cells to their previous states
+/** \brief Compute the position of the given linear index
  */
-bool CellHandler::previousStates() const
+QVector<unsigned int> CellHandler::getPosition(unsigned int index) const
 {
-    for (QMap<QVector<unsigned int>, Cell* >::const_iterator it = m_cells.begin(); it != m_cells.end(); ++it)
+    QVector<unsigned int> position(m_dimensions.size());
+    for (int i = 0; i < m_dimensions.size(); i++)
     {
-        if (!it.value()->back())
-            return false;
+        position[i] = index % m_dimensions.at(i);
+        index /= m_dimensions.at(i);
     }
-    return true;
+    return position;
 }
 
-/** \brief Reset all the cells to the 1st state
+/** \brief Compute the linear index of a neighbour, according to the boundary mode
+ *
+ * \param index Linear index of the cell
+ * \param relativePosition Relative position of the neighbour
+ * \return Linear index of the neighbour, -1 if it is out of the grid and the boundary is fixedZero
+ */
+int CellHandler::getNeighbourIndex(unsigned int index, const QVector<short> &relativePosition) const
+{
+    if (relativePosition.size() != m_dimensions.size())
+        return -1;
+    int neighbourIndex = 0;
+    for (int i = 0; i < m_dimensions.size(); i++)
+    {
+        int coordinate = mapCoordinate((int)(index % m_dimensions.at(i)) + relativePosition.at(i), m_dimensions.at(i), m_boundary);
+        index /= m_dimensions.at(i);
+        if (coordinate < 0)
+            return -1;
+        neighbourIndex += coordinate * m_strides.at(i);
+    }
+    return neighbourIndex;
+}
+
+/** \brief Relative positions of the neighbours of a cell
+ */
+const QVector<QVector<short> > &CellHandler::getNeighbourPositions() const
+{
+    return m_neighbourPositions;
+}
+
+/** \brief Accessor of m_neighbourhood
+ */
+const Neighbourhood &CellHandler::getNeighbourhood() const
+{
+    return m_neighbourhood;
+}
+
+/** \brief Change the shape of the neighbourhood of the cells
+ *
+ * \throw QString The neighbourhood doesn't have the dimension of the grid
+ */
+void CellHandler::setNeighbourhood(const Neighbourhood &neighbourhood)
+{
+    if (neighbourhood.getDimensions() != (unsigned int)m_dimensions.size())
+        throw QString(QObject::tr("The neighbourhood doesn't have the dimension of the grid"));
+    m_neighbourhood = neighbourhood;
+    foundNeighbours();
+}
+
+/** \brief Accessor of m_boundary
+ */
+CellHandler::boundaryTypes CellHandler::getBoundary() const
+{
+    return m_boundary;
+}
+
+/** \brief Change the behaviour of the neighbours out of the grid
+ */
+void CellHandler::setBoundary(CellHandler::boundaryTypes boundary)
+{
+    m_boundary = boundary;
+}
+
+/** \brief Bring a coordinate back into the grid
+ *
+ * The coordinate can be far away from the grid (neighbourhoods larger than the grid):
+ * a toroidal dimension has a period of length, a reflective one a period of 2*length.
+ *
+ * \param coordinate Coordinate on one dimension, possibly out of the grid
+ * \param length Size of the dimension
+ * \param boundary Boundary mode
+ * \return Coordinate in [0, length[, -1 if the cell doesn't exist (fixedZero)
+ */
+int CellHandler::mapCoordinate(int coordinate, unsigned int length, CellHandler::boundaryTypes boundary)
+{
+    int n = length;
+    if (coordinate >= 0 && coordinate < n)
+        return coordinate;
+    if (boundary == toroidal)
+        return (coordinate % n + n) % n;
+    if (boundary == reflective)
+    {
+        int folded = (coordinate % (2*n) + 2*n) % (2*n);
+        return folded < n ? folded : 2*n - 1 - folded;
+    }
+    return -1;
+}
+
+/** \brief Current states, by linear index
+ */
+const unsigned int *CellHandler::getStates() const
+{
+    return m_states.constData();
+}
+
+/** \brief Temporary states, by linear index, validated by nextStates()
+ */
+unsigned int *CellHandler::getNextStates()
+{
+    return m_nextStates.data();
+}
+
+/** \brief Copy of the current states, by linear index
+ *
+ * QVector is implicitly shared, so the copy is only done when the grid changes.
+ */
+QVector<unsigned int> CellHandler::getSnapshot() const
+{
+    return m_states;
+}
+
+/** \brief Number of the current generation, 0 for the first state
+ */
+unsigned int CellHandler::getGeneration() const
+{
+    return m_generation;
+}
+
+/** \brief Previous states, the last one is restored first by previousStates()
+ *
+ * As the states, the history is implicitly shared and can be copied cheaply.
+ */
+const QStack<QVector<unsigned int> > &CellHandler::getHistory() const
+{
+    return m_history;
+}
+
+/** \brief Number of the generation of each state of getHistory()
+ */
+const QStack<unsigned int> &CellHandler::getHistoryGenerations() const
+{
+    return m_historyGenerations;
+}
+
+/** \brief Replace the states, the generation and the history, to continue a run saved before
+ *
+ * \param states States of the current generation
+ * \param generation Number of the current generation
+ * \param history Previous states, see getHistory()
+ * \param historyGenerations Number of the generation of each previous state
+ * \throw QString The states don't fit the dimensions, or a state is greater than getMaxState()
+ */
+void CellHandler::restore(const QVector<unsigned int> &states, unsigned int generation,
+                          const QStack<QVector<unsigned int> > &history, const QStack<unsigned int> &historyGenerations)
+{
+    if ((unsigned int)states.size() != m_size || history.size() != historyGenerations.size())
+        throw QString(QObject::tr("States don't fit the dimensions"));
+    for (int i = 0; i < history.size(); i++)
+        if ((unsigned int)history.at(i).size() != m_size)
+            throw QString(QObject::tr("States don't fit the dimensions"));
+    for (int i = 0; i <= history.size(); i++)
+    {
+        const QVector<unsigned int> &generationStates = i < history.size() ? history.at(i) : states;
+        for (int j = 0; j < generationStates.size(); j++)
+            if (generationStates.at(j) > getMaxState())
+                throw QString(QObject::tr("A state is greater than the max state"));
+    }
+
+    m_states = states;
+    m_nextStates = m_states;
+    m_generation = generation;
+    m_history = history;
+    m_historyGenerations = historyGenerations;
+}
+
+/** \brief Hash of the current states, see hashCell
  */
-void CellHandler::reset() const
+quint64 CellHandler::hash() const
 {
-    for (QMap<QVector<unsigned int>, Cell* >::const_iterator it = m_cells.begin(); it != m_cells.end(); ++it)
+    quint64 sum = 0;
+    for (unsigned int j = 0; j < m_size; j++)
+        sum += hashCell(j, m_states.at(j));
+    return sum;
+}
+
+/** \brief Second hash of the current states, independent of hash()
+ *
+ * It is a FNV-1a hash of the states in order, so it can't be updated with the changed cells only.
+ */
+quint64 CellHandler::checksum() const
+{
+    const unsigned int *states = m_states.constData();
+    quint64 sum = Q_UINT64_C(0xCBF29CE484222325);
+    for (unsigned int j = 0; j < m_size; j++)
     {
-        it.value()->reset();
+        sum ^= states[j];
+        sum *= Q_UINT64_C(0x100000001B3);
     }
+    return sum;
+}
+
+/** \brief Valid the state of all cells
+ *
+ * The current generation is pushed in the history. As QVector is implicitly shared,
+ * this doesn't copy the states.
+ *
+ * \param keepHistory False to forget the current generation, previousStates() will skip it
+ */
+void CellHandler::nextStates(bool keepHistory)
+{
+    if (keepHistory)
+    {
+        m_history.push(m_states);
+        m_historyGenerations.push(m_generation);
+    }
+    m_states = m_nextStates;
+    m_generation++;
+}
+
+/** \brief Get all the cells to their previous states
+ *
+ * \return Return false if we are already at the first state
+ */
+bool CellHandler::previousStates()
+{
+    if (m_history.isEmpty())
+        return false;
+    m_states = m_history.pop();
+    m_generation = m_historyGenerations.pop();
+    m_nextStates = m_states;
+    return true;
+}
+
+/** \brief Reset all the cells to the 1st state
+ */
+void CellHandler::reset()
+{
+    if (m_history.isEmpty())
+        return;
+    m_states = m_history.first();
+    m_generation = m_historyGenerations.first();
+    m_history.clear();
+    m_historyGenerations.clear();
+    m_nextStates = m_states;
 }
 
 /** \brief Save the CellHandler current configuration in the file given
@@ -213,11 +454,17 @@ bool CellHandler::save(QString filename) const
         stringDimension.push_back(QString::number(m_dimensions.at(i)));
     }
     json["dimensions"] = QJsonValue(stringDimension);
+    if (m_boundary == toroidal)
+        json["boundary"] = QJsonValue("toroidal");
+    else if (m_boundary == reflective)
+        json["boundary"] = QJsonValue("reflective");
 
     QJsonArray cells;
-    for (CellHandler::const_iterator it = begin(); it != end(); ++it)
+    for (CellHandler::span_iterator row = spans(); row != end(); ++row)
     {
-        cells.append(QJsonValue((int)it->getState()));
+        const unsigned int *states = row.states();
+        for (unsigned int x = 0; x < row.length(); x++)
+            cells.append(QJsonValue((int)states[x]));
     }
     json["cells"] = cells;
 
@@ -239,62 +486,74 @@ bool CellHandler::save(QString filename) const
  */
 void CellHandler::generate(CellHandler::generationTypes type, unsigned int stateMax, unsigned short density)
 {
-    if (type == random)
+    generate(type, stateMax, density, QRandomGenerator::global()->generate());
+}
+
+/** \brief Replace Cell values by random values (symetric or not), reproducibly
+ *
+ * The cells are filled in parallel by tiles (see generateStates), the same seed always gives the same
+ * cells whatever the number of threads.
+ *
+ * \param type Type of random generation
+ * \param stateMax Generate states between 0 and stateMax
+ * \param density Average (%) of non-zeros
+ * \param seed Seed of the random generator
+ */
+void CellHandler::generate(CellHandler::generationTypes type, unsigned int stateMax, unsigned short density, quint32 seed)
+{
+    if (type == random || type == symetric)
     {
-        QVector<unsigned int> position;
-        for (unsigned short i = 0; i < m_dimensions.size(); i++)
-        {
-            position.push_back(0);
-        }
-        QRandomGenerator generator((float)qrand()*(float)time_t()/RAND_MAX);
-        for (int j = 0; j < m_cells.size(); j++)
-        {
-            unsigned int state = 0;
-            // 0 have (1-density)% of chance of being generate
-            if (generator.generateDouble()*100.0 < density)
-                 state = (float)(generator.generateDouble()*stateMax) +1;
-            if (state > stateMax)
-                state = stateMax;
-            m_cells.value(position)->forceState(state);
-
-            positionIncrement(position);
-        }
+        const unsigned int length = m_dimensions.at(0);
+        const unsigned int size = m_size;
+        unsigned int *states = m_states.data();
+
+        QVector<unsigned int> tiles;
+        for (unsigned int start = 0; start < size; start += generationTile)
+            tiles.push_back(start);
+        auto fillTile = [=](const unsigned int &start) {
+            generateStates(states + start, start, qMin(generationTile, size - start), length, type, stateMax, density, seed);
+        };
+        if (tiles.size() > 1)
+            QtConcurrent::blockingMap(tiles, fillTile);
+        else if (!tiles.isEmpty())
+            fillTile(tiles.first());
     }
-    else if (type == symetric)
-    {
-        QVector<unsigned int> position;
-        for (short i = 0; i < m_dimensions.size(); i++)
-        {
-            position.push_back(0);
-        }
+    m_nextStates = m_states;
+}
 
-        QRandomGenerator generator((float)qrand()*(float)time_t()/RAND_MAX);
-        QVector<unsigned int> savedStates;
-        for (int j = 0; j < m_cells.size(); j++)
+/** \brief Fill random states (symetric or not) for a range of cells
+ *
+ * The state of a cell only depends on the seed and on its index (see CounterRandom), so any range can be
+ * filled independently of the others. A symetric cell takes the random value of its mirror in the first
+ * half of its line.
+ *
+ * \param states Output, states of the cells of the range
+ * \param first Linear index of the first cell of the range
+ * \param count Number of cells of the range
+ * \param length Length of the 1st dimension, the lines of the symetry
+ * \param type Type of random generation, random or symetric
+ * \param stateMax Generate states between 0 and stateMax
+ * \param density Average (%) of non-zeros
+ * \param seed Seed of the random generator
+ */
+void CellHandler::generateStates(unsigned int *states, quint64 first, unsigned int count, unsigned int length,
+                                 generationTypes type, unsigned int stateMax, unsigned short density, quint32 seed)
+{
+    const CounterRandom generator(seed);
+    const quint64 threshold = (quint64)density << 32;
+    const bool mirror = type == symetric;
+    for (unsigned int j = 0; j < count; j++)
+    {
+        quint64 index = first + j;
+        if (mirror)
         {
-            if (j % m_dimensions.at(0) == 0)
-                savedStates.clear();
-            if (j % m_dimensions.at(0) < (m_dimensions.at(0)+1) / 2)
-            {
-                unsigned int state = 0;
-                // 0 have (1-density)% of chance of being generate
-                if (generator.generateDouble()*100.0 < density)
-                    state = (float)(generator.generateDouble()*stateMax) +1;
-                if (state > stateMax)
-                    state = stateMax;
-                savedStates.push_back(state);
-                m_cells.value(position)->forceState(state);
-            }
-            else
-            {
-                unsigned int i = savedStates.size() - (j % m_dimensions.at(0) - (m_dimensions.at(0)-1)/2 + (m_dimensions.at(0) % 2 == 0 ? 0 : 1));
-                m_cells.value(position)->forceState(savedStates.at(i));
-            }
-            positionIncrement(position);
-
-
+            unsigned int x = index % length;
+            index = index - x + qMin(x, length - 1 - x);
         }
-
+        // Low half: 0 have (1-density)% of chance of being generate, high half: the state
+        quint64 r = generator.at(index);
+        unsigned int state = qMin(1 + (unsigned int)(((r >> 32) * stateMax) >> 32), stateMax);
+        states[j] = (r & 0xFFFFFFFF) * 100 < threshold ? state : 0;
     }
 }
 
@@ -304,12 +563,13 @@ void CellHandler::generate(CellHandler::generationTypes type, unsigned int state
  */
 void CellHandler::print(std::ostream &stream) const
 {
-    for (const_iterator it = begin(); it != end(); ++it)
+    for (span_iterator row = spans(); row != end(); ++row)
     {
-        for (unsigned int d = 0; d < it.changedDimension(); d++)
+        for (unsigned int d = 0; d < row.changedDimension(); d++)
             stream << std::endl;
-        stream << it->getState() << " ";
-
+        const unsigned int *states = row.states();
+        for (unsigned int x = 0; x < row.length(); x++)
+            stream << states[x] << " ";
     }
 
 }
@@ -328,6 +588,15 @@ CellHandler::const_iterator CellHandler::begin() const
     return const_iterator(this);
 }
 
+/** \brief Give the span iterator on the rows (nbDimensions = 1) or slabs of the current CellHandler
+ *
+ * \param nbDimensions Number of dimensions of a span, at most the number of dimensions of the grid
+ */
+CellHandler::span_iterator CellHandler::spans(unsigned int nbDimensions) const
+{
+    return span_iterator(this, nbDimensions);
+}
+
 /** \brief End condition of the iterator
  *
  * See iterator::operator!=(bool finished) for further information.
@@ -341,26 +610,11 @@ bool CellHandler::end() const
  *
  * Exemple of a way to print cell states :
  * \code
- * QVector<unsigned int> position;
- * for (unsigned short i = 0; i < m_dimensions.size(); i++)
- * {
- *      position.push_back(0);
- * }
- * for (unsigned int j = 0; j < m_cells.size(); j++)
+ * for (unsigned int j = 0; j < m_size; j++)
  * {
- *      std::cout << m_cells.value(position)->getState() << " ";
- *      position.replace(0, position.at(0)+1);
- *      for (unsigned short i = 0; i < m_dimensions.size(); i++)
- *      {
- *          if (position.at(i) >= m_dimensions.at(i))
- *          {
- *              position.replace(i, 0);
- *              std::cout << std::endl;
- *              if (i + 1 != m_dimensions.size())
- *                  position.replace(i+1, position.at(i+1)+1);
- *          }
- *
- *      }
+ *      std::cout << m_states.at(j) << " ";
+ *      if ((j + 1) % m_dimensions.at(0) == 0)
+ *          std::cout << std::endl;
  * }
  * \endcode
  *
@@ -393,29 +647,36 @@ bool CellHandler::load(const QJsonObject &json)
     if (!json.contains("cells") || !json["cells"].isArray())
         return false;
 
+    // Optional boundary mode, fixedZero by default
+    m_boundary = fixedZero;
+    if (json.contains("boundary"))
+    {
+        QString boundary = json["boundary"].toString();
+        if (!boundary.compare("toroidal", Qt::CaseInsensitive))
+            m_boundary = toroidal;
+        else if (!boundary.compare("reflective", Qt::CaseInsensitive))
+            m_boundary = reflective;
+        else if (boundary.compare("fixedZero", Qt::CaseInsensitive))
+            return false;
+    }
+
     QJsonArray cells = json["cells"].toArray();
     if (cells.size() != product)
         return false;
 
-    QVector<unsigned int> position;
-    // Set position vector to 0
-    for (unsigned short i = 0; i < m_dimensions.size(); i++)
-    {
-        position.push_back(0);
-    }
-
+    allocate();
 
     // Creation of cells
+    unsigned int *states = m_states.data();
     for (int j = 0; j < cells.size(); j++)
     {
         if (!cells.at(j).isDouble())
             return false;
-        if (cells.at(j).toDouble() < 0)
+        if (cells.at(j).toDouble() < 0 || cells.at(j).toDouble() > getMaxState())
             return false;
-        m_cells.insert(position, new Cell(cells.at(j).toDouble()));
-
-        positionIncrement(position);
+        states[j] = cells.at(j).toDouble();
     }
+    m_nextStates = m_states;
 
     //if (!json.contains("maxState") || !json["maxState"].isDouble())
     //    return false;
@@ -425,31 +686,17 @@ bool CellHandler::load(const QJsonObject &json)
 
 }
 
-/** \brief Set the neighbours of each cells
- *
- * Careful, this is in O(n*3^d), with n the number of cells and d the number of dimensions
+/** \brief Compute the relative positions of the neighbours of a cell
  *
+ * The list comes from the neighbourhood (Moore neighbourhood of radius 1 by default). It is
+ * computed once from the dimensions; the boundary mode is applied when the neighbours of a cell are used.
  */
 void CellHandler::foundNeighbours()
 {
-    QVector<unsigned int> currentPosition;
-    // Set position vector to 0
-    for (unsigned short i = 0; i < m_dimensions.size(); i++)
-    {
-        currentPosition.push_back(0);
-    }
-    // Modification of all the cells
-    for (int j = 0; j < m_cells.size(); j++)
-    {
-        // Get the list of the neighbours positions
-        // This function is recursive
-        QVector<QVector<unsigned int> > listPosition(getListNeighboursPositions(currentPosition));
-
-        // Adding neighbours
-        for (int i = 0; i < listPosition.size(); i++)
-            m_cells.value(currentPosition)->addNeighbour(m_cells.value(listPosition.at(i)), Cell::getRelativePosition(currentPosition, listPosition.at(i)));
-        positionIncrement(currentPosition);
-    }
+    if (m_neighbourhood.getDimensions() != (unsigned int)m_dimensions.size())
+        m_neighbourhood = Neighbourhood(m_dimensions.size());
+
+    m_neighbourPositions = m_neighbourhood.getOffsets();
 
 }
 
@@ -480,85 +727,36 @@ int CellHandler::positionIncrement(QVector<unsigned int> &pos) const
     return changedDimension;
 }
 
-/** \brief Prepare the call of the recursive version of itself
+/** \brief Allocate the states and the cell views from m_dimensions
  *
- * \param position Position of the central cell (x1,x2,x3,..,xn)
- * \return List of positions
+ * All the cells are set to the dead state.
  */
-QVector<QVector<unsigned int> >& CellHandler::getListNeighboursPositions(const QVector<unsigned int> position) const
+void CellHandler::allocate()
 {
-    QVector<QVector<unsigned int> > *list = getListNeighboursPositionsRecursive(position, position.size(), position);
-    // We remove the position of the cell
-    list->removeAll(position);
-    return *list;
+    m_strides.clear();
+    m_strides.push_back(1);
+    for (int i = 0; i < m_dimensions.size(); i++)
+        m_strides.push_back(m_strides.last() * m_dimensions.at(i));
+    m_size = m_dimensions.isEmpty() ? 0 : m_strides.last();
+
+    m_states.fill(0, m_size);
+    m_nextStates = m_states;
+    m_history.clear();
+    m_historyGenerations.clear();
+    m_generation = 0;
 }
 
-/** \brief Recursive function which browse the position possibilities tree
- *
- * Careful, the complexity is in O(3^dimension)<br>
- * Piece of the tree:
- * \code
- *             x_d -1
- *           /
- * x_(d-1)-1/_ x_d
- *          \
- *           \
- *             x_d +1
- *
- *             x_d -1
- *           /
- * x_(d-1)  /_ x_d
- *          \
- *           \
- *             x_d +1
- *
- *             x_d -1
- *           /
- * x_(d-1)+1/ x_d
- *          \
- *           \
- *             x_d +1
- * \endcode
- * The path in the tree to reach the leaf give the position
+/** \brief Construct an initial span iterator to browse the CellHandler
  *
- * \param position Position of the cell
- * \param dimension Current working dimension (number of the digit). Dimension = 2 <=> working on x2 coordinates on (x1, x2, x3, ..., xn) vector
- * \param lastAdd Last position added. Like the father node of the new tree
- * \return List of position
+ * \param handler CellHandler to go through
+ * \param nbDimensions Number of dimensions of a span, brought back between 1 and the number of dimensions
  */
-QVector<QVector<unsigned int> >* CellHandler::getListNeighboursPositionsRecursive(const QVector<unsigned int> position, unsigned int dimension, QVector<unsigned int> lastAdd) const
+CellHandler::span_iterator::span_iterator(const CellHandler *handler, unsigned int nbDimensions):
+        m_handler(handler), m_nbDimensions(qBound(1u, nbDimensions, (unsigned int)qMax(handler->m_dimensions.size(), 1))),
+        m_index(0), m_position(handler->m_dimensions.size(), 0)
 {
-    if (dimension == 0) // Stop condition
-    {
-        QVector<QVector<unsigned int> > *list = new QVector<QVector<unsigned int> >;
-        return list;
-    }
-    QVector<QVector<unsigned int> > *listPositions = new QVector<QVector<unsigned int> >;
-
-    QVector<unsigned int> modifiedPosition(lastAdd);
-
-    // "x_d - 1" tree
-    if (modifiedPosition.at(dimension-1) != 0) // Avoid "negative" position
-        modifiedPosition.replace(dimension-1, position.at(dimension-1) - 1);
-    listPositions->append(*getListNeighboursPositionsRecursive(position, dimension -1, modifiedPosition));
-    if (!listPositions->count(modifiedPosition))
-        listPositions->push_back(modifiedPosition);
-
-    // "x_d" tree
-    modifiedPosition.replace(dimension-1, position.at(dimension-1));
-    listPositions->append(*getListNeighboursPositionsRecursive(position, dimension -1, modifiedPosition));
-    if (!listPositions->count(modifiedPosition))
-        listPositions->push_back(modifiedPosition);
-
-    // "x_d + 1" tree
-    if (modifiedPosition.at(dimension -1) + 1 < m_dimensions.at(dimension-1)) // Avoid position out of the cell space
-        modifiedPosition.replace(dimension-1, position.at(dimension-1) +1);
-    listPositions->append(*getListNeighboursPositionsRecursive(position, dimension -1, modifiedPosition));
-    if (!listPositions->count(modifiedPosition))
-        listPositions->push_back(modifiedPosition);
-
-    return listPositions;
-
+    m_length = m_nbDimensions < (unsigned int)handler->m_strides.size() ? handler->m_strides.at(m_nbDimensions) : 0;
+    m_finished = (handler->m_size == 0);
 }
 
 /** \brief Construct an initial iterator to browse the CellHandler
@@ -567,12 +765,7 @@ QVector<QVector<unsigned int> >* CellHandler::getListNeighboursPositionsRecursiv
  */
 template<typename CellHandler_T, typename Cell_T>
 CellHandler::iteratorT<CellHandler_T,Cell_T>::iteratorT(CellHandler_T *handler):
-        m_handler(handler), m_changedDimension(0)
+        m_handler(handler), m_index(0), m_cell(const_cast<CellHandler*>(handler), 0), m_changedDimension(0)
 {
-    // Initialisation of m_position
-    for (unsigned short i = 0; i < handler->m_dimensions.size(); i++)
-    {
-        m_position.push_back(0);
-    }
-    m_zero = m_position;
+    m_finished = (handler->m_size == 0);
 }
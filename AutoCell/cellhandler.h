@@ -6,19 +6,26 @@
 #include <QJsonDocument>
 #include <QtWidgets>
 #include <QMap>
+#include <QStack>
 #include <QRegExpValidator>
 #include <QDebug>
 
 #include "cell.h"
+#include "neighbourhood.h"
 
 
 
 /** \brief Cell container and cell generator
  *
  * Generate cells from a json file.
+ *
+ * States are stored in flat arrays indexed by the linear index of the cell. The first
+ * dimension is the fastest varying one: index = x1 + d1*(x2 + d2*(x3 + ...)), which is
+ * also the order of the "cells" array of the json files.
  */
 class CellHandler
 {
+    friend class Cell;
 
     /** \brief Implementation of iterator design pattern with a template to generate iterator and const_iterator
      * at the same time.
@@ -45,9 +52,15 @@ class CellHandler
         iteratorT(CellHandler_T* handler);
         /** \brief Increment the current position and handle dimension changes */
         iteratorT& operator++(){
-            m_changedDimension = m_handler->positionIncrement(m_position);
+            m_index++;
+            m_cell = Cell(const_cast<CellHandler*>(m_handler), m_index);
+            // Number of dimensions whose coordinate went back to zero
+            m_changedDimension = 0;
+            while (m_changedDimension < (unsigned int)m_handler->m_dimensions.size()
+                   && m_index % m_handler->m_strides.at(m_changedDimension + 1) == 0)
+                m_changedDimension++;
             // If we return to zero, we have finished
-            if (m_position == m_zero)
+            if (m_index >= m_handler->m_size)
                 m_finished = true;
 
             return *this;
@@ -55,11 +68,11 @@ class CellHandler
         }
         /** \brief Get the current cell */
         Cell_T* operator->() const{
-            return m_handler->m_cells.value(m_position);
+            return &m_cell;
         }
         /** \brief Get the current cell */
         Cell_T* operator*() const{
-            return m_handler->m_cells.value(m_position);
+            return &m_cell;
         }
 
         bool operator!=(bool finished) const { return (m_finished != finished); }
@@ -71,15 +84,83 @@ class CellHandler
 
     private:
         CellHandler_T *m_handler; ///< CellHandler to go through
-        QVector<unsigned int> m_position; ///< Current position of the iterator
+        unsigned int m_index; ///< Linear index of the current cell
+        mutable Cell m_cell; ///< View on the current cell
         bool m_finished = false; ///< If we reach the last position
-        QVector<unsigned int> m_zero; ///< Nul vector of the good dimension (depend of m_handler)
         unsigned int m_changedDimension; ///< Save the number of dimension change
     };
 public:
     typedef iteratorT<const CellHandler, const Cell> const_iterator;
     typedef iteratorT<CellHandler, Cell> iterator;
 
+    /** \brief Iterator on contiguous spans of states: the rows of the first dimension, or slabs of several dimensions
+     *
+     * A span of nbDimensions dimensions holds the cells whose other coordinates are the same, they are
+     * contiguous in the states. The loops on the cells of a span only read a raw pointer, the coordinates are
+     * only updated once per span.
+     *
+     * Example of use, which prints the states as print() does:
+     * \code
+     * for (CellHandler::span_iterator row = handler.spans(); row != handler.end(); ++row)
+     * {
+     *      for (unsigned int i = 0; i < row.changedDimension(); i++)
+     *          std::cout << std::endl;
+     *      for (unsigned int x = 0; x < row.length(); x++)
+     *          std::cout << row.states()[x] << " ";
+     * }
+     * \endcode
+     */
+    class span_iterator
+    {
+    public:
+        span_iterator(const CellHandler *handler, unsigned int nbDimensions);
+        /** \brief Go to the next span and handle dimension changes */
+        span_iterator& operator++(){
+            m_index += m_length;
+            if (m_index >= m_handler->m_size)
+            {
+                m_finished = true;
+                return *this;
+            }
+            // Carry on the coordinates after the ones of the span
+            m_changedDimension = m_nbDimensions;
+            while (m_changedDimension < (unsigned int)m_position.size()
+                   && ++m_position[m_changedDimension] >= m_handler->m_dimensions.at(m_changedDimension))
+                m_position[m_changedDimension++] = 0;
+            return *this;
+        }
+        bool operator!=(bool finished) const { return (m_finished != finished); }
+        /** \brief States of the span, valid until the states of the handler change */
+        const unsigned int *states() const{
+            return m_handler->m_states.constData() + m_index;
+        }
+        /** \brief Number of cells of the span */
+        unsigned int length() const{
+            return m_length;
+        }
+        /** \brief Linear index of the first cell of the span */
+        unsigned int index() const{
+            return m_index;
+        }
+        /** \brief Coordinates of the first cell of the span, the ones of the span dimensions are 0 */
+        const QVector<unsigned int> &position() const{
+            return m_position;
+        }
+        /** \brief Number of dimensions whose coordinate went back to zero, as const_iterator::changedDimension() on the first cell */
+        unsigned int changedDimension() const{
+            return m_changedDimension;
+        }
+
+    private:
+        const CellHandler *m_handler; ///< CellHandler to go through
+        unsigned int m_nbDimensions; ///< Number of dimensions of a span
+        unsigned int m_length; ///< Number of cells of a span
+        unsigned int m_index; ///< Linear index of the first cell of the current span
+        QVector<unsigned int> m_position; ///< Coordinates of the first cell of the current span
+        bool m_finished = false; ///< If we reach the last span
+        unsigned int m_changedDimension = 0; ///< Save the number of dimension change
+    };
+
     /** \brief Type of random generation
      */
     enum generationTypes {
@@ -88,25 +169,75 @@ public:
         symetric ///< Random cells but with vertical symetry (on the 1st dimension component)
     };
 
+    /** \brief Behaviour of the neighbours out of the grid
+     */
+    enum boundaryTypes {
+        fixedZero, ///< Out of the grid cells are in state 0 and are not counted as neighbours
+        toroidal, ///< The grid wraps around on each dimension
+        reflective ///< The grid is mirrored on its borders, the border cell included
+    };
+
     CellHandler(const QString filename);
     CellHandler(const QJsonObject &json);
     CellHandler(const QVector<unsigned int> dimensions, generationTypes type = empty, unsigned int stateMax = 1, unsigned int density = 20);
+    CellHandler(const CellHandler &c) = delete;
+    CellHandler & operator=(const CellHandler &c) = delete;
     virtual ~CellHandler();
 
-    Cell* getCell(const QVector<unsigned int> position) const;
+    Cell getCell(const QVector<unsigned int> position);
+    const Cell getCell(const QVector<unsigned int> position) const;
     static unsigned int getMaxState();
     QVector<unsigned int> getDimensions() const;
-    void nextStates() const;
-    bool previousStates() const;
-    void reset() const;
+    unsigned int getSize() const;
+    unsigned int getIndex(const QVector<unsigned int> &position) const;
+    QVector<unsigned int> getPosition(unsigned int index) const;
+    int getNeighbourIndex(unsigned int index, const QVector<short> &relativePosition) const;
+    const QVector<QVector<short> > &getNeighbourPositions() const;
+    const Neighbourhood &getNeighbourhood() const;
+    void setNeighbourhood(const Neighbourhood &neighbourhood);
+    boundaryTypes getBoundary() const;
+    void setBoundary(boundaryTypes boundary);
+    static int mapCoordinate(int coordinate, unsigned int length, boundaryTypes boundary);
+
+    const unsigned int *getStates() const;
+    unsigned int *getNextStates();
+    QVector<unsigned int> getSnapshot() const;
+    unsigned int getGeneration() const;
+    const QStack<QVector<unsigned int> > &getHistory() const;
+    const QStack<unsigned int> &getHistoryGenerations() const;
+    void restore(const QVector<unsigned int> &states, unsigned int generation,
+                 const QStack<QVector<unsigned int> > &history, const QStack<unsigned int> &historyGenerations);
+    quint64 hash() const;
+    quint64 checksum() const;
+
+    /** \brief Hash of one cell, the hash of the grid is the sum of the hashes of its cells
+     *
+     * As the sum is commutative, the hash of the grid can be updated with the changed cells only.
+     */
+    static inline quint64 hashCell(unsigned int index, unsigned int state)
+    {
+        // splitmix64 finalizer on (index, state)
+        quint64 z = ((quint64)index << 32 | state) + Q_UINT64_C(0x9E3779B97F4A7C15);
+        z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+        return z ^ (z >> 31);
+    }
+
+    void nextStates(bool keepHistory = true);
+    bool previousStates();
+    void reset();
 
     virtual bool save(QString filename) const;
 
     virtual void generate(generationTypes type, unsigned int stateMax = 1, unsigned short density = 50);
+    virtual void generate(generationTypes type, unsigned int stateMax, unsigned short density, quint32 seed);
+    static void generateStates(unsigned int *states, quint64 first, unsigned int count, unsigned int length,
+                               generationTypes type, unsigned int stateMax, unsigned short density, quint32 seed);
     virtual void print(std::ostream &stream) const;
 
     const_iterator begin() const;
     iterator begin();
+    span_iterator spans(unsigned int nbDimensions = 1) const;
     bool end() const;
 
 
@@ -114,11 +245,39 @@ protected:
     virtual bool load(const QJsonObject &json);
     virtual void foundNeighbours();
     virtual int positionIncrement(QVector<unsigned int> &pos) const;
-    virtual QVector<QVector<unsigned int> > *getListNeighboursPositionsRecursive(const QVector<unsigned int> position, unsigned int dimension, QVector<unsigned int> lastAdd) const;
-    QVector<QVector<unsigned int> > &getListNeighboursPositions(const QVector<unsigned int> position) const;
+    void allocate();
+
+    /** \brief Count the neighbours of the cell whose state satisfies the predicate
+     *
+     * Neighbours are resolved with the boundary mode, those which don't exist are not counted.
+     *
+     * \param index Linear index of the cell
+     * \param match Predicate on the neighbour state
+     */
+    template <typename Predicate>
+    unsigned int countNeighboursIf(unsigned int index, Predicate match) const
+    {
+        unsigned int count = 0;
+        for (int n = 0; n < m_neighbourPositions.size(); n++)
+        {
+            int neighbourIndex = getNeighbourIndex(index, m_neighbourPositions.at(n));
+            if (neighbourIndex >= 0 && match(m_states.at(neighbourIndex)))
+                count++;
+        }
+        return count;
+    }
 
     QVector<unsigned int> m_dimensions; ///< Vector of x dimensions
-    QMap<QVector<unsigned int>, Cell* > m_cells; ///< Map of cells, with a x dimensions vector as key
+    QVector<unsigned int> m_strides; ///< Linear stride of each dimension, the last value is the number of cells
+    unsigned int m_size = 0; ///< Number of cells
+    QVector<unsigned int> m_states; ///< Current state of each cell, by linear index
+    QVector<unsigned int> m_nextStates; ///< Temporary states, before validation
+    QStack<QVector<unsigned int> > m_history; ///< Previous generations, the first one is the initial state
+    QStack<unsigned int> m_historyGenerations; ///< Generation number of each state of m_history
+    unsigned int m_generation = 0; ///< Number of the current generation
+    Neighbourhood m_neighbourhood; ///< Shape of the neighbourhood of a cell
+    QVector<QVector<short> > m_neighbourPositions; ///< Relative positions of the neighbours of a cell
+    boundaryTypes m_boundary = fixedZero; ///< Behaviour of the neighbours out of the grid
 };
 
 template class CellHandler::iteratorT<CellHandler, Cell>;
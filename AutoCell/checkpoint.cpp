@@ -0,0 +1,140 @@
+#include <QSaveFile>
+#include <QDataStream>
+
+#include "checkpoint.h"
+#include "automate.h"
+
+/** \brief "ATCK", at the beginning of the checkpoint files
+ */
+static const quint32 checkpointMagic = 0x4154434B;
+
+/** \brief Version of the format of the checkpoint files
+ */
+static const quint32 checkpointVersion = 1;
+
+/** \brief Take a snapshot of the automate
+ *
+ * Only the rules are serialized here, the states and the history are shared with the automate.
+ */
+Checkpoint::Checkpoint(const Automate &automate) :
+    m_dimensions(automate.m_cellHandler->getDimensions()),
+    m_boundary(automate.m_cellHandler->getBoundary()),
+    m_ruleDocument(automate.ruleDocument().toJson(QJsonDocument::Compact)),
+    m_lookupTableBudget(automate.m_lookupTableBudget),
+    m_cycleDetectionDepth(automate.m_cycleDetectionDepth),
+    m_states(automate.m_cellHandler->getSnapshot()),
+    m_generation(automate.m_cellHandler->getGeneration()),
+    m_history(automate.m_cellHandler->getHistory()),
+    m_historyGenerations(automate.m_cellHandler->getHistoryGenerations())
+{
+
+}
+
+/** \brief Write the checkpoint in a binary file
+ *
+ * The file is replaced only once it is completely written, a crash during the writing keeps the
+ * previous checkpoint.
+ *
+ * \param filename File to write, .atk by convention
+ * \return False if the file couldn't be written
+ */
+bool Checkpoint::write(QString filename) const
+{
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning("Couldn't open given file.");
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_10);
+    stream << checkpointMagic << checkpointVersion << m_dimensions << (quint32)m_boundary << m_ruleDocument
+           << m_lookupTableBudget << m_cycleDetectionDepth << m_generation << m_states << (quint32)m_history.size();
+    for (int i = 0; i < m_history.size(); i++)
+        stream << m_historyGenerations.at(i) << m_history.at(i);
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+/** \brief Create an automate from a checkpoint file, which continues the run exactly where it was saved
+ *
+ * \param filename File written by write()
+ * \return New automate, to be deleted by the caller
+ * \throw QString Unreadable file
+ * \throw QString Not valid file
+ */
+Automate *Checkpoint::resume(QString filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning("Couldn't open given file.");
+        throw QString(QObject::tr("Couldn't open given file"));
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_10);
+    quint32 fileMagic = 0, fileVersion = 0;
+    stream >> fileMagic >> fileVersion;
+    if (fileMagic != checkpointMagic || fileVersion != checkpointVersion)
+        throw QString(QObject::tr("File not valid"));
+
+    QVector<unsigned int> dimensions;
+    quint32 boundary = 0, nbHistory = 0;
+    QByteArray ruleDocument;
+    unsigned int lookupTableBudget = 0, cycleDetectionDepth = 0, generation = 0;
+    stream >> dimensions >> boundary >> ruleDocument >> lookupTableBudget >> cycleDetectionDepth >> generation;
+    if (stream.status() != QDataStream::Ok || dimensions.isEmpty() || dimensions.contains(0) || boundary > CellHandler::reflective)
+        throw QString(QObject::tr("File not valid"));
+
+    // The sizes are checked against the rest of the file before anything of their size is allocated
+    const quint64 historyHeaderBytes = sizeof(unsigned int) + sizeof(quint32); // Generation and size of the states
+    quint64 size = 1;
+    for (int i = 0; i < dimensions.size(); i++)
+    {
+        size *= dimensions.at(i);
+        if (size * sizeof(unsigned int) > (quint64)(file.size() - file.pos()))
+            throw QString(QObject::tr("File not valid"));
+    }
+    QVector<unsigned int> states;
+    stream >> states >> nbHistory;
+    if (stream.status() != QDataStream::Ok || (quint64)states.size() != size
+            || nbHistory > (quint64)(file.size() - file.pos()) / (historyHeaderBytes + size * sizeof(unsigned int)))
+        throw QString(QObject::tr("File not valid"));
+
+    QStack<QVector<unsigned int> > history;
+    QStack<unsigned int> historyGenerations;
+    for (quint32 i = 0; i < nbHistory; i++)
+    {
+        unsigned int historyGeneration = 0;
+        QVector<unsigned int> historyStates;
+        stream >> historyGeneration >> historyStates;
+        if (stream.status() != QDataStream::Ok || (quint64)historyStates.size() != size)
+            throw QString(QObject::tr("File not valid"));
+        historyGenerations.push(historyGeneration);
+        history.push(historyStates);
+    }
+
+    Automate* automate = new Automate(dimensions);
+    try
+    {
+        automate->m_lookupTableBudget = lookupTableBudget;
+        automate->m_cycleDetectionDepth = cycleDetectionDepth;
+        automate->setBoundary((CellHandler::boundaryTypes)boundary);
+        if (!automate->loadRuleDocument(QJsonDocument::fromJson(ruleDocument)))
+            throw QString(QObject::tr("File not valid"));
+        automate->m_cellHandler->restore(states, generation, history, historyGenerations);
+    }
+    catch (QString &)
+    {
+        delete automate;
+        throw;
+    }
+    return automate;
+}
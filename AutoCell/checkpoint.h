@@ -0,0 +1,45 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <QVector>
+#include <QStack>
+#include <QByteArray>
+
+#include "cellhandler.h"
+
+class Automate;
+
+
+/** \class Checkpoint
+ * \brief Everything needed to continue a run exactly: cells, generation, history, neighbourhood and rules
+ *
+ * The construction is cheap: the states and the history are implicitly shared with the automate, they
+ * are only copied if the automate changes them. The checkpoint can then be written by another thread
+ * while the automate keeps stepping (see Automate::saveCheckpoint()).
+ * \code
+ * Checkpoint(automate).write("run.atk");
+ * ...
+ * Automate* automate = Checkpoint::resume("run.atk");
+ * \endcode
+ */
+class Checkpoint
+{
+private:
+    QVector<unsigned int> m_dimensions; ///< Dimensions of the cells
+    CellHandler::boundaryTypes m_boundary; ///< Behaviour of the neighbours out of the grid
+    QByteArray m_ruleDocument; ///< Neighbourhood and rules, in the format of the rule files
+    unsigned int m_lookupTableBudget; ///< See Automate::setLookupTableBudget()
+    unsigned int m_cycleDetectionDepth; ///< See Automate::setCycleDetectionDepth()
+    QVector<unsigned int> m_states; ///< Current states
+    unsigned int m_generation; ///< Current generation
+    QStack<QVector<unsigned int> > m_history; ///< Previous states
+    QStack<unsigned int> m_historyGenerations; ///< Generation of each previous state
+
+public:
+    Checkpoint(const Automate &automate);
+
+    bool write(QString filename) const;
+    static Automate* resume(QString filename);
+};
+
+#endif // CHECKPOINT_H
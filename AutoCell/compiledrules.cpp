@@ -0,0 +1,440 @@
+#include <QtMath>
+
+#include "compiledrules.h"
+#include "rule.h"
+
+/** \brief Compile the rules on the stencil of the neighbourhood
+ *
+ * \param rules Rules, in priority order
+ * \param neighbourhood Neighbourhood used by the NeighbourRules
+ * \param lookupTableBudget Maximum number of entries of the lookup table, 0 to never build it
+ */
+CompiledRules::CompiledRules(const QList<const Rule *> &rules, const Neighbourhood &neighbourhood, unsigned int lookupTableBudget):
+    m_neighbourhood(neighbourhood), m_stencil(neighbourhood.getOffsets())
+{
+    for (QList<const Rule*>::const_iterator it = rules.begin(); it != rules.end(); ++it)
+        (*it)->compile(*this);
+    buildMasks();
+    buildBuckets();
+    buildCountTable(lookupTableBudget);
+    buildLookupTable(lookupTableBudget);
+}
+
+/** \brief Add a rule about the number of neighbours in some states
+ *
+ * \param outputState Next state if the rule match
+ * \param currentStates Possible states of the cell
+ * \param interval Bounds (included) of the number of neighbours
+ * \param neighbourStates Counted states, nothing means all states except 0
+ */
+void CompiledRules::addNeighbourRule(unsigned int outputState, const QVector<unsigned int> &currentStates, QPair<unsigned int, unsigned int> interval, const QSet<unsigned int> &neighbourStates)
+{
+    CompiledRule rule;
+    rule.kind = neighbourCount;
+    rule.outputState = outputState;
+    rule.currentStates = currentStates;
+    rule.counter = addCounter(neighbourStates);
+    rule.min = interval.first;
+    rule.max = interval.second;
+    rule.firstCondition = 0;
+    rule.nbConditions = 0;
+    rule.firstThreshold = -1;
+    m_rules.push_back(rule);
+
+    updateMaxState(currentStates);
+    updateMaxState(neighbourStates.toList().toVector());
+    m_maxState = qMax(m_maxState, outputState);
+}
+
+/** \brief Add a rule about the number of neighbours in some states, applied with a probability
+ *
+ * \param outputState Next state if the rule is applied
+ * \param currentStates Possible states of the cell
+ * \param interval Bounds (included) of the number of neighbours
+ * \param neighbourStates Counted states, nothing means all states except 0
+ * \param probability Probability to apply the rule on a matching cell, or per counted neighbour
+ * \param perNeighbour True if the probability is given per counted neighbour
+ */
+void CompiledRules::addProbabilisticRule(unsigned int outputState, const QVector<unsigned int> &currentStates, QPair<unsigned int, unsigned int> interval,
+                                         const QSet<unsigned int> &neighbourStates, double probability, bool perNeighbour)
+{
+    addNeighbourRule(outputState, currentStates, interval, neighbourStates);
+    m_rules.last().firstThreshold = m_thresholds.size();
+
+    // Probability of the count k as a threshold on 53 random bits, 2^53 is always reached
+    const double scale = (double)(Q_UINT64_C(1) << 53);
+    for (int count = 0; count <= m_neighbourhood.size(); count++)
+    {
+        double applied = perNeighbour ? 1 - qPow(1 - probability, count) : probability;
+        m_thresholds.push_back((quint64)(qBound(0.0, applied, 1.0) * scale + 0.5));
+    }
+}
+
+/** \brief Add a rule about the states of specific neighbours
+ *
+ * As in MatrixRule::matchCell(), a position out of the neighbourhood has no cell and is read as 0: its
+ * condition is always true or the rule never matches.
+ *
+ * \param outputState Next state if the rule match
+ * \param currentStates Possible states of the cell
+ * \param matrix Allowed states for each relative position
+ */
+void CompiledRules::addMatrixRule(unsigned int outputState, const QVector<unsigned int> &currentStates, const QMap<QVector<short>, QVector<unsigned int> > &matrix)
+{
+    QMap<QVector<short>, QVector<unsigned int> > conditions;
+    for (QMap<QVector<short>, QVector<unsigned int> >::const_iterator it = matrix.begin(); it != matrix.end(); ++it)
+    {
+        if (m_stencil.contains(it.key()))
+            conditions.insert(it.key(), it.value());
+        else if (!it.value().contains(0))
+            return;
+    }
+
+    CompiledRule rule;
+    rule.kind = CompiledRules::matrix;
+    rule.outputState = outputState;
+    rule.currentStates = currentStates;
+    rule.counter = -1;
+    rule.min = 0;
+    rule.max = 0;
+    rule.firstCondition = m_conditionIndex.size();
+    rule.nbConditions = conditions.size();
+    rule.firstThreshold = -1;
+    for (QMap<QVector<short>, QVector<unsigned int> >::const_iterator it = conditions.constBegin(); it != conditions.constEnd(); ++it)
+    {
+        m_conditionIndex.push_back(m_stencil.indexOf(it.key()));
+        m_conditionStates.push_back(it.value());
+        updateMaxState(it.value());
+    }
+    m_rules.push_back(rule);
+
+    updateMaxState(currentStates);
+    m_maxState = qMax(m_maxState, outputState);
+}
+
+/** \brief Accessor of m_neighbourhood
+ */
+const Neighbourhood &CompiledRules::getNeighbourhood() const
+{
+    return m_neighbourhood;
+}
+
+/** \brief Accessor of m_stencil
+ */
+const QVector<QVector<short> > &CompiledRules::getStencil() const
+{
+    return m_stencil;
+}
+
+/** \brief Greatest distance of a stencil position to the cell on a dimension: a cell only depends on the cells at most this far
+ */
+unsigned int CompiledRules::getReach() const
+{
+    unsigned int reach = 0;
+    for (int n = 0; n < m_stencil.size(); n++)
+        for (int i = 0; i < m_stencil.at(n).size(); i++)
+            reach = qMax(reach, (unsigned int)qAbs(m_stencil.at(n).at(i)));
+    return reach;
+}
+
+/** \brief Accessor of m_rules
+ */
+const QVector<CompiledRules::CompiledRule> &CompiledRules::getRules() const
+{
+    return m_rules;
+}
+
+/** \brief Greatest state mentioned by the rules
+ *
+ * States greater than this one behave all the same way.
+ */
+unsigned int CompiledRules::getMaxState() const
+{
+    return m_maxState;
+}
+
+/** \brief Number of neighbour counters needed by the rules
+ */
+int CompiledRules::getNbCounters() const
+{
+    return m_counters.size();
+}
+
+/** \brief Tell if the state is counted by the counter
+ */
+bool CompiledRules::isCounted(int counter, unsigned int state) const
+{
+    if (m_counters.at(counter).isEmpty())
+        return state != 0;
+    return m_counters.at(counter).contains(state);
+}
+
+/** \brief Number of matrix conditions of all the rules
+ */
+int CompiledRules::getNbConditions() const
+{
+    return m_conditionIndex.size();
+}
+
+/** \brief Stencil index of the matrix condition
+ */
+int CompiledRules::getConditionIndex(int condition) const
+{
+    return m_conditionIndex.at(condition);
+}
+
+/** \brief Allowed states of the matrix condition
+ */
+const QVector<unsigned int> &CompiledRules::getConditionStates(int condition) const
+{
+    return m_conditionStates.at(condition);
+}
+
+/** \brief Number of 64 bits words of a bitmask
+ */
+int CompiledRules::getMaskWords() const
+{
+    return m_maskWords;
+}
+
+/** \brief Bitmask of the possible states of the cell for the rule
+ */
+const quint64 *CompiledRules::getCurrentMask(int rule) const
+{
+    return m_currentMasks.constData() + rule * m_maskWords;
+}
+
+/** \brief Bitmask of the allowed states of the matrix condition
+ */
+const quint64 *CompiledRules::getConditionMask(int condition) const
+{
+    return m_conditionMasks.constData() + condition * m_maskWords;
+}
+
+/** \brief Indexes of the rules whose current states contain the state, in priority order
+ */
+const QVector<int> &CompiledRules::getCandidateRules(unsigned int state) const
+{
+    return m_buckets.at(qMin(state, m_maxState + 1));
+}
+
+/** \brief Thresholds of a probabilistic rule, indexed by the number of counted neighbours
+ *
+ * The rule is applied if the 53 high bits of the random number of the cell are lower than the threshold.
+ */
+const quint64 *CompiledRules::getThresholds(const CompiledRule &rule) const
+{
+    return m_thresholds.constData() + rule.firstThreshold;
+}
+
+/** \brief True if a rule is applied with a probability
+ */
+bool CompiledRules::isStochastic() const
+{
+    return !m_thresholds.isEmpty();
+}
+
+/** \brief Next state of a cell, from its state and the states of its stencil positions
+ *
+ * This is the reference evaluation of the deterministic rules, used to fill the lookup table.
+ *
+ * \param state State of the cell
+ * \param stencilStates State of each stencil position, see getStencil()
+ */
+unsigned int CompiledRules::evaluate(unsigned int state, const unsigned int *stencilStates) const
+{
+    const QVector<int> &candidates = getCandidateRules(state);
+    for (int k = 0; k < candidates.size(); k++)
+    {
+        const CompiledRule &rule = m_rules.at(candidates.at(k));
+        bool matched = true;
+        if (rule.kind == neighbourCount)
+        {
+            unsigned int count = 0;
+            for (int n = 0; n < m_neighbourhood.size(); n++)
+                if (isCounted(rule.counter, stencilStates[n]))
+                    count++;
+            matched = count >= rule.min && count <= rule.max;
+        }
+        else
+        {
+            for (int c = rule.firstCondition; c < rule.firstCondition + rule.nbConditions && matched; c++)
+                matched = allows(getConditionMask(c), stencilStates[m_conditionIndex.at(c)]);
+        }
+        if (matched)
+            return rule.outputState;
+    }
+    return state;
+}
+
+/** \brief True if the rules were compiled into a lookup table
+ */
+bool CompiledRules::hasLookupTable() const
+{
+    return !m_lookupTable.isEmpty();
+}
+
+/** \brief Next state of each configuration, see getLookupWeights() for the encoding
+ *
+ * Only valid for the cells whose state and stencil states are not greater than getMaxState().
+ */
+const QVector<unsigned int> &CompiledRules::getLookupTable() const
+{
+    return m_lookupTable;
+}
+
+/** \brief Weights of the configuration number: the first one is for the cell, then one by stencil position
+ *
+ * The configuration number is the sum of the states multiplied by their weight.
+ */
+const QVector<unsigned int> &CompiledRules::getLookupWeights() const
+{
+    return m_lookupWeights;
+}
+
+/** \brief True if the rules were compiled into a count table
+ */
+bool CompiledRules::hasCountTable() const
+{
+    return !m_countTable.isEmpty();
+}
+
+/** \brief Next state of each state and number of counted neighbours
+ *
+ * The next state of a cell in the state s with c neighbours counted by the only counter of the rules is at
+ * s * (size of the neighbourhood + 1) + c. Only valid for the states not greater than getMaxState().
+ */
+const QVector<unsigned int> &CompiledRules::getCountTable() const
+{
+    return m_countTable;
+}
+
+/** \brief Index of the counter of the states, added if needed
+ */
+int CompiledRules::addCounter(const QSet<unsigned int> &states)
+{
+    int index = m_counters.indexOf(states);
+    if (index < 0)
+    {
+        index = m_counters.size();
+        m_counters.push_back(states);
+    }
+    return index;
+}
+
+/** \brief Take the states into account in m_maxState
+ */
+void CompiledRules::updateMaxState(const QVector<unsigned int> &states)
+{
+    for (int i = 0; i < states.size(); i++)
+        m_maxState = qMax(m_maxState, states.at(i));
+}
+
+/** \brief Convert the sets of states into bitmasks, once m_maxState is known
+ *
+ * The size is chosen so that the last bit is greater than m_maxState.
+ */
+void CompiledRules::buildMasks()
+{
+    m_maskWords = (m_maxState + 1) / 64 + 1;
+    m_lastBit = 64 * m_maskWords - 1;
+
+    m_currentMasks.fill(0, m_rules.size() * m_maskWords);
+    for (int r = 0; r < m_rules.size(); r++)
+        fillMask(m_currentMasks.data() + r * m_maskWords, m_rules.at(r).currentStates);
+
+    m_conditionMasks.fill(0, m_conditionStates.size() * m_maskWords);
+    for (int c = 0; c < m_conditionStates.size(); c++)
+        fillMask(m_conditionMasks.data() + c * m_maskWords, m_conditionStates.at(c));
+}
+
+/** \brief Set the bits of the states in the mask
+ */
+void CompiledRules::fillMask(quint64 *mask, const QVector<unsigned int> &states) const
+{
+    for (int i = 0; i < states.size(); i++)
+        mask[states.at(i) >> 6] |= (quint64)1 << (states.at(i) & 63);
+}
+
+/** \brief Sort the rules by the states they accept
+ */
+void CompiledRules::buildBuckets()
+{
+    m_buckets.fill(QVector<int>(), m_maxState + 2);
+    for (unsigned int state = 0; state < (unsigned int)m_buckets.size(); state++)
+        for (int r = 0; r < m_rules.size(); r++)
+            if (allows(getCurrentMask(r), state))
+                m_buckets[state].push_back(r);
+}
+
+/** \brief Evaluate the rules on every configuration, if there are at most budget of them
+ *
+ * There are (maxState+1)^(stencil size + 1) configurations.
+ */
+void CompiledRules::buildLookupTable(unsigned int budget)
+{
+    m_lookupTable.clear();
+    m_lookupWeights.clear();
+    if (isStochastic() || hasCountTable())
+        return;
+    quint64 base = (quint64)m_maxState + 1;
+    quint64 size = 1;
+    for (int n = 0; n <= m_stencil.size(); n++)
+    {
+        m_lookupWeights.push_back(size);
+        size *= base;
+        if (size > budget)
+        {
+            m_lookupWeights.clear();
+            return;
+        }
+    }
+
+    // Go through the configurations like a counter in base maxState+1, the cell is the lowest digit
+    QVector<unsigned int> configuration(m_stencil.size() + 1, 0);
+    m_lookupTable.resize(size);
+    for (unsigned int index = 0; index < size; index++)
+    {
+        m_lookupTable[index] = evaluate(configuration.at(0), configuration.constData() + 1);
+        for (int n = 0; n < configuration.size(); n++)
+        {
+            if (++configuration[n] < base)
+                break;
+            configuration[n] = 0;
+        }
+    }
+}
+
+/** \brief Evaluate the rules on every state and count, if they only use one counter and fit the budget
+ *
+ * The matrix rules without condition always match, the others prevent the table.
+ */
+void CompiledRules::buildCountTable(unsigned int budget)
+{
+    m_countTable.clear();
+    if (isStochastic() || m_counters.size() != 1 || !m_conditionIndex.isEmpty())
+        return;
+    const quint64 nbCounts = m_neighbourhood.size() + 1;
+    if (((quint64)m_maxState + 1) * nbCounts > budget)
+        return;
+
+    m_countTable.resize((m_maxState + 1) * nbCounts);
+    for (unsigned int state = 0; state <= m_maxState; state++)
+    {
+        const QVector<int> &candidates = getCandidateRules(state);
+        for (unsigned int count = 0; count < nbCounts; count++)
+        {
+            unsigned int next = state;
+            for (int k = 0; k < candidates.size(); k++)
+            {
+                const CompiledRule &rule = m_rules.at(candidates.at(k));
+                if (rule.kind == matrix || (count >= rule.min && count <= rule.max))
+                {
+                    next = rule.outputState;
+                    break;
+                }
+            }
+            m_countTable[state * nbCounts + count] = next;
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef COMPILEDRULES_H
+#define COMPILEDRULES_H
+
+#include <QVector>
+#include <QList>
+#include <QSet>
+#include <QPair>
+#include <QMap>
+#include <QtGlobal>
+
+#include "neighbourhood.h"
+
+class Rule;
+
+/** \class CompiledRules
+ * \brief Flat representation of an ordered list of rules, evaluated on a stencil of relative positions
+ *
+ * The stencil is the list of the offsets of the neighbourhood, a MatrixRule reads the positions out of it
+ * as 0 (see addMatrixRule()). Each rule is compiled by Rule::compile:
+ * - a NeighbourRule becomes an interval on a neighbour counter. A counter is the number of neighbours
+ *   whose state is in a set, it is computed for the whole grid by the kernel of the neighbourhood.
+ * - a MatrixRule becomes a list of conditions (stencil index, allowed states).
+ * - a ProbabilisticRule becomes a neighbour counter interval with a threshold for each count: the rule
+ *   is applied if a random number of 53 bits is lower than the threshold of the count of the cell.
+ *
+ * Once every rule is compiled, the sets of states (current states of each rule, allowed states of each
+ * condition) are also stored as bitmasks of getMaskWords() words, so a test is a shift and a mask.
+ * The last bit of the masks is never set and stands for all the states greater than getMaxState().
+ * The rules are also sorted in buckets by current state (getCandidateRules), so a cell only tests
+ * the rules which can apply to its state.
+ *
+ * When the rules use few states on a small stencil, they are also compiled into a lookup table: each
+ * configuration (state of the cell and of each stencil position) is encoded as a number in base
+ * getMaxState()+1 and gives directly the next state. The table is only built if it fits the budget, and
+ * never for stochastic rules.
+ *
+ * When every rule counts the same states and has no other condition (outer totalistic rules, such as a
+ * GenerationsRule or the NeighbourRules of feuForet.atr), the next state only depends on the state of the
+ * cell and on a single count. The rules are then compiled into a count table of getMaxState()+1 rows of
+ * (size of the neighbourhood + 1) next states instead of the lookup table, if it fits the same budget.
+ *
+ * Nothing in this class depends on the cells, so it can be shared between automata.
+ */
+class CompiledRules
+{
+public:
+    /** \brief Kind of compiled rule
+     */
+    enum ruleKinds {
+        neighbourCount, ///< Number of neighbours in a set of states in an interval
+        matrix ///< Specific states at specific relative positions
+    };
+
+    /** \brief One compiled rule
+     */
+    struct CompiledRule
+    {
+        ruleKinds kind; ///< Kind of rule
+        unsigned int outputState; ///< Next state if the rule match
+        QVector<unsigned int> currentStates; ///< Possible states of the cell
+        int counter; ///< Index of the neighbour counter (neighbourCount)
+        unsigned int min; ///< Lower bound of the interval (neighbourCount)
+        unsigned int max; ///< Upper bound of the interval (neighbourCount)
+        int firstCondition; ///< Index of the first condition (matrix)
+        int nbConditions; ///< Number of conditions (matrix)
+        int firstThreshold; ///< Index of the threshold of the count 0 in getThresholds(), -1 if the rule is deterministic
+    };
+
+    CompiledRules(const QList<const Rule*> &rules, const Neighbourhood &neighbourhood, unsigned int lookupTableBudget = 0);
+
+    void addNeighbourRule(unsigned int outputState, const QVector<unsigned int> &currentStates, QPair<unsigned int, unsigned int> interval, const QSet<unsigned int> &neighbourStates);
+    void addProbabilisticRule(unsigned int outputState, const QVector<unsigned int> &currentStates, QPair<unsigned int, unsigned int> interval,
+                              const QSet<unsigned int> &neighbourStates, double probability, bool perNeighbour);
+    void addMatrixRule(unsigned int outputState, const QVector<unsigned int> &currentStates, const QMap<QVector<short>, QVector<unsigned int> > &matrix);
+
+    const Neighbourhood &getNeighbourhood() const;
+    const QVector<QVector<short> > &getStencil() const;
+    unsigned int getReach() const;
+    const QVector<CompiledRule> &getRules() const;
+    unsigned int getMaxState() const;
+    int getNbCounters() const;
+    bool isCounted(int counter, unsigned int state) const;
+    int getNbConditions() const;
+    int getConditionIndex(int condition) const;
+    const QVector<unsigned int> &getConditionStates(int condition) const;
+    int getMaskWords() const;
+    const quint64 *getCurrentMask(int rule) const;
+    const quint64 *getConditionMask(int condition) const;
+    const QVector<int> &getCandidateRules(unsigned int state) const;
+    const quint64 *getThresholds(const CompiledRule &rule) const;
+    bool isStochastic() const;
+    unsigned int evaluate(unsigned int state, const unsigned int *stencilStates) const;
+    bool hasLookupTable() const;
+    const QVector<unsigned int> &getLookupTable() const;
+    const QVector<unsigned int> &getLookupWeights() const;
+    bool hasCountTable() const;
+    const QVector<unsigned int> &getCountTable() const;
+
+    /** \brief Tell if the state is in the bitmask
+     */
+    inline bool allows(const quint64 *mask, unsigned int state) const
+    {
+        unsigned int bit = qMin(state, m_lastBit);
+        return (mask[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+private:
+    int addCounter(const QSet<unsigned int> &states);
+    void updateMaxState(const QVector<unsigned int> &states);
+    void buildMasks();
+    void fillMask(quint64 *mask, const QVector<unsigned int> &states) const;
+    void buildBuckets();
+    void buildLookupTable(unsigned int budget);
+    void buildCountTable(unsigned int budget);
+
+    Neighbourhood m_neighbourhood; ///< Neighbourhood used by the neighbour counters
+    QVector<QVector<short> > m_stencil; ///< Relative positions, the offsets of the neighbourhood
+    QVector<CompiledRule> m_rules; ///< Rules, in priority order
+    unsigned int m_maxState = 0; ///< Greatest state mentioned by the rules
+    QVector<QSet<unsigned int> > m_counters; ///< States counted by each counter, empty means all states except 0
+    QVector<quint64> m_thresholds; ///< Thresholds of the probabilistic rules, one by number of neighbours from 0 to the size of the neighbourhood
+    QVector<int> m_conditionIndex; ///< Stencil index of each matrix condition
+    QVector<QVector<unsigned int> > m_conditionStates; ///< Allowed states of each matrix condition
+    int m_maskWords = 1; ///< Number of 64 bits words of a bitmask
+    unsigned int m_lastBit = 63; ///< Last bit of the bitmasks, never set
+    QVector<quint64> m_currentMasks; ///< Bitmask of the current states of each rule, m_maskWords words by rule
+    QVector<quint64> m_conditionMasks; ///< Bitmask of the allowed states of each condition, m_maskWords words by condition
+    QVector<QVector<int> > m_buckets; ///< Indexes of the rules which accept each state, in priority order, the last one for the states greater than m_maxState
+    QVector<unsigned int> m_lookupTable; ///< Next state of each configuration, empty if there is no table
+    QVector<unsigned int> m_lookupWeights; ///< Weight of the cell then of each stencil position in the configuration number
+    QVector<unsigned int> m_countTable; ///< Next state by state and number of counted neighbours, empty if there is no table
+};
+
+#endif // COMPILEDRULES_H
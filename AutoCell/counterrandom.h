@@ -0,0 +1,71 @@
+#ifndef COUNTERRANDOM_H
+#define COUNTERRANDOM_H
+
+#include <QtGlobal>
+
+
+/** \class CounterRandom
+ * \brief Counter-based random generator: each number is a function of a key and of its index, without state
+ *
+ * The n-th number of a key is the n-th output of SplitMix64 started at the key, so any number can be drawn
+ * directly, in any order and from any thread: the cells of a grid can be filled in parallel and still give
+ * the same grid whatever the number of threads.
+ *
+ * The key is built from a seed and a stream number, different streams of the same seed are independent.
+ * \code
+ * CounterRandom random(seed);
+ * for (unsigned int i = 0; i < size; i++)
+ *     states[i] = random.bounded(i, 2);
+ * \endcode
+ */
+class CounterRandom
+{
+private:
+    quint64 m_key; ///< Start of the SplitMix64 sequence
+
+    /** \brief SplitMix64 finalizer
+     */
+    static inline quint64 mix(quint64 z)
+    {
+        z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+        return z ^ (z >> 31);
+    }
+
+public:
+    /** \brief Construct the generator of the given seed and stream
+     *
+     * \param seed Seed given by the user
+     * \param stream Independent sequence of the seed, for example the step of a run
+     */
+    explicit CounterRandom(quint64 seed, quint64 stream = 0) :
+        m_key(mix(mix(seed + Q_UINT64_C(0x9E3779B97F4A7C15)) ^ (stream * Q_UINT64_C(0xD1B54A32D192ED03))))
+    {
+
+    }
+
+    /** \brief Random 64 bits number of the given index
+     */
+    inline quint64 at(quint64 index) const
+    {
+        return mix(m_key + (index + 1) * Q_UINT64_C(0x9E3779B97F4A7C15));
+    }
+
+    /** \brief Random number in [0, bound[ of the given index
+     *
+     * Uses the high 32 bits of the number of the index (multiply and shift, without division).
+     */
+    inline quint32 bounded(quint64 index, quint32 bound) const
+    {
+        return (quint32)(((at(index) >> 32) * bound) >> 32);
+    }
+
+    /** \brief Random number in [0, 1[ of the given index
+     */
+    inline double uniform(quint64 index) const
+    {
+        return (at(index) >> 11) * (1.0 / (Q_UINT64_C(1) << 53));
+    }
+};
+
+#endif // COUNTERRANDOM_H
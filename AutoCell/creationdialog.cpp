@@ -13,6 +13,11 @@ CreationDialog::CreationDialog(QWidget *parent) : QDialog(parent)
     m_densityBox->setValue(20);
     m_stateMaxBox = new QSpinBox();
     m_stateMaxBox->setValue(1);
+    QLabel *boundaryLabel = new QLabel(tr("Borders :"));
+    m_boundaryBox = new QComboBox();
+    m_boundaryBox->addItem(tr("Dead cells"), CellHandler::fixedZero);
+    m_boundaryBox->addItem(tr("Wrap around"), CellHandler::toroidal);
+    m_boundaryBox->addItem(tr("Mirror"), CellHandler::reflective);
 
     QHBoxLayout *densityLayout = new QHBoxLayout();
     densityLayout->addWidget(m_densityLabel);
@@ -22,6 +27,10 @@ CreationDialog::CreationDialog(QWidget *parent) : QDialog(parent)
     stateMaxLayout->addWidget(m_stateMaxLabel);
     stateMaxLayout->addWidget(m_stateMaxBox);
 
+    QHBoxLayout *boundaryLayout = new QHBoxLayout();
+    boundaryLayout->addWidget(boundaryLabel);
+    boundaryLayout->addWidget(m_boundaryBox);
+
     m_dimensionsEdit = new QLineEdit;
     QRegExp rgx("([0-9]+,)*");
     QRegExpValidator *v = new QRegExpValidator(rgx, this);
@@ -36,6 +45,7 @@ CreationDialog::CreationDialog(QWidget *parent) : QDialog(parent)
     layout->addWidget(m_dimensionsEdit);
     layout->addLayout(densityLayout);
     layout->addLayout(stateMaxLayout);
+    layout->addLayout(boundaryLayout);
     layout->addWidget(grpBox);
     layout->addWidget(m_doneBt);
     setLayout(layout);
@@ -86,7 +96,9 @@ void CreationDialog::processSettings(){
         QVector<unsigned int> dimensions;
         for(int i = 0; i < dimList.size(); i++) dimensions.append(dimList.at(i).toInt());
 
-        emit settingsFilled(dimensions, genType, m_stateMaxBox->value(), m_densityBox->value());
+        CellHandler::boundaryTypes boundary = (CellHandler::boundaryTypes)m_boundaryBox->currentData().toInt();
+
+        emit settingsFilled(dimensions, genType, m_stateMaxBox->value(), m_densityBox->value(), boundary);
         this->close();
     }
 
@@ -20,7 +20,8 @@ public:
 signals:
     void settingsFilled(const QVector<unsigned int> dimensions,
                         CellHandler::generationTypes type = CellHandler::generationTypes::empty,
-                        unsigned int stateMax = 1, unsigned int density = 20);
+                        unsigned int stateMax = 1, unsigned int density = 20,
+                        CellHandler::boundaryTypes boundary = CellHandler::boundaryTypes::fixedZero);
 
 public slots:
     void processSettings();
@@ -29,6 +30,7 @@ private:
     QLineEdit *m_dimensionsEdit;
     QSpinBox *m_densityBox;
     QSpinBox *m_stateMaxBox;
+    QComboBox *m_boundaryBox;
     QPushButton *m_doneBt;
 
     QGroupBox *m_groupBox;
@@ -0,0 +1,159 @@
+#include <QtConcurrent>
+#include <QFileInfo>
+#include <QDir>
+
+#include "frameexporter.h"
+#include "palette.h"
+
+/** \brief Open the output and start the encoders
+ *
+ * \param filename Output file, its suffix chooses the format
+ * \param dimensions Dimensions of the frames
+ * \param cellSize Size of a cell in pixels
+ * \param nbThreads Number of encoders
+ * \param queueLength Number of frames waiting or being encoded before addFrame() waits
+ * \throw QString Not valid dimensions
+ * \throw QString Unusable file
+ */
+FrameExporter::FrameExporter(QString filename, const QVector<unsigned int> &dimensions, unsigned int cellSize, int nbThreads, int queueLength) :
+    m_filename(filename), m_dimensions(dimensions), m_cellSize(qMax(cellSize, 1u)), m_freeSlots(qMax(queueLength, 1))
+{
+    if (dimensions.isEmpty() || dimensions.contains(0))
+        throw QString(QObject::tr("Not valid dimensions"));
+    m_pool.setMaxThreadCount(qMax(nbThreads, 1));
+
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    m_format = suffix == "rgb" || suffix == "raw" ? rawVideo : imageSequence;
+    if (m_format == rawVideo)
+    {
+        m_video.setFileName(filename);
+        if (!m_video.open(QIODevice::WriteOnly))
+        {
+            qWarning("Couldn't open given file.");
+            throw QString(QObject::tr("Couldn't open given file"));
+        }
+    }
+}
+
+/** \brief Wait for the frames in the queue
+ */
+FrameExporter::~FrameExporter()
+{
+    finish();
+}
+
+/** \brief Accessor of m_format
+ */
+FrameExporter::formats FrameExporter::getFormat() const
+{
+    return m_format;
+}
+
+/** \brief Size of the frames in pixels
+ */
+QSize FrameExporter::getFrameSize() const
+{
+    unsigned int height = 1;
+    for (int i = 1; i < m_dimensions.size(); i++)
+        height *= m_dimensions.at(i);
+    return QSize(m_dimensions.at(0) * m_cellSize, height * m_cellSize);
+}
+
+/** \brief Number of frames added
+ */
+quint64 FrameExporter::getNbFrames() const
+{
+    return m_nbFrames;
+}
+
+/** \brief Draw the states, one line of cells at a time copied cellSize times
+ */
+QImage FrameExporter::render(const QVector<unsigned int> &states) const
+{
+    const QSize size = getFrameSize();
+    const unsigned int length = m_dimensions.at(0);
+    QImage image(size, QImage::Format_RGB888);
+    for (int row = 0; row < size.height(); row += m_cellSize)
+    {
+        const unsigned int *cell = states.constData() + (row / m_cellSize) * length;
+        uchar *pixel = image.scanLine(row);
+        for (unsigned int x = 0; x < length; x++)
+        {
+            const QRgb color = Palette::rgb(cell[x]);
+            for (unsigned int i = 0; i < m_cellSize; i++)
+            {
+                *pixel++ = qRed(color);
+                *pixel++ = qGreen(color);
+                *pixel++ = qBlue(color);
+            }
+        }
+        for (unsigned int i = 1; i < m_cellSize; i++)
+            memcpy(image.scanLine(row + i), image.constScanLine(row), size.width() * 3);
+    }
+    return image;
+}
+
+/** \brief Draw and write a frame, in a thread of the pool
+ *
+ * The raw frames are drawn in parallel but written in the order they were added.
+ */
+void FrameExporter::encode(const QVector<unsigned int> &states, unsigned int generation, quint64 frame)
+{
+    QImage image = render(states);
+
+    if (m_format == imageSequence)
+    {
+        QFileInfo info(m_filename);
+        QString suffix = info.suffix().isEmpty() ? "png" : info.suffix();
+        QString name = info.dir().filePath(QString("%1_%2.%3").arg(info.completeBaseName()).arg(generation, 6, 10, QChar('0')).arg(suffix));
+        if (!image.save(name))
+            m_failed.store(1);
+    }
+    else
+    {
+        QMutexLocker locker(&m_videoMutex);
+        while (m_nextWritten != frame)
+            m_videoTurn.wait(&m_videoMutex);
+        const qint64 lineBytes = image.width() * 3;
+        for (int row = 0; row < image.height(); row++)
+            if (m_video.write((const char*)image.constScanLine(row), lineBytes) != lineBytes)
+                m_failed.store(1);
+        m_nextWritten++;
+        m_videoTurn.wakeAll();
+    }
+
+    m_freeSlots.release();
+}
+
+/** \brief Queue a frame, wait first if the queue is full
+ *
+ * \param states States by linear index, of the dimensions of the exporter. They are implicitly shared,
+ * not copied, unless the caller changes them during the encoding
+ * \param generation Generation of the states, used to name the images
+ * \throw QString States don't fit the dimensions
+ */
+void FrameExporter::addFrame(const QVector<unsigned int> &states, unsigned int generation)
+{
+    const QSize size = getFrameSize();
+    if ((quint64)states.size() * m_cellSize * m_cellSize != (quint64)size.width() * size.height())
+        throw QString(QObject::tr("States don't fit the dimensions"));
+    m_freeSlots.acquire();
+    const quint64 frame = m_nbFrames++;
+    QtConcurrent::run(&m_pool, [=]() { encode(states, generation, frame); });
+}
+
+/** \brief Wait for the frames in the queue and close the output
+ *
+ * \return False if a frame couldn't be written
+ */
+bool FrameExporter::finish()
+{
+    m_pool.waitForDone();
+    if (m_video.isOpen())
+    {
+        if (!m_video.flush())
+            m_failed.store(1);
+        m_video.close();
+    }
+    return m_failed.load() == 0;
+}
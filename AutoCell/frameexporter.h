@@ -0,0 +1,73 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include <QVector>
+#include <QString>
+#include <QSize>
+#include <QImage>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+
+/** \class FrameExporter
+ * \brief Export generations as images, encoded by a bounded queue of background threads
+ *
+ * A frame is drawn with the colors of the Palette, one square of cellSize pixels by cell: the first
+ * dimension is horizontal, the other ones are stacked vertically. Two formats are chosen by the suffix
+ * of the file:
+ * - .rgb or .raw: raw video, every frame appended in order as 24-bit RGB pixels, which can be encoded with
+ *   \code ffmpeg -f rawvideo -pix_fmt rgb24 -s <width>x<height> -r 25 -i run.rgb run.mp4 \endcode
+ * - any other suffix: one image by frame, run.png gives run_000000.png, run_000001.png... numbered by
+ *   generation.
+ *
+ * addFrame() only waits when the queue is full, which slows the simulation down to the speed of the
+ * encoders instead of using more memory.
+ */
+class FrameExporter
+{
+public:
+    /** \brief Output formats
+     */
+    enum formats {
+        imageSequence, ///< One image file by frame
+        rawVideo ///< One file of raw RGB frames
+    };
+
+private:
+    QString m_filename; ///< Output file, or pattern of the image files
+    formats m_format; ///< Output format
+    QVector<unsigned int> m_dimensions; ///< Dimensions of the frames
+    unsigned int m_cellSize; ///< Size of a cell in pixels
+    QThreadPool m_pool; ///< Encoders
+    QSemaphore m_freeSlots; ///< Free places in the queue of frames
+    QFile m_video; ///< Output file of the raw video
+    QMutex m_videoMutex; ///< Protect m_nextWritten
+    QWaitCondition m_videoTurn; ///< Signaled when a raw frame is written
+    quint64 m_nextWritten = 0; ///< Number of the next raw frame to write
+    quint64 m_nbFrames = 0; ///< Number of frames added
+    QAtomicInt m_failed; ///< Not 0 if a frame couldn't be written
+
+    QImage render(const QVector<unsigned int> &states) const;
+    void encode(const QVector<unsigned int> &states, unsigned int generation, quint64 frame);
+
+public:
+    FrameExporter(QString filename, const QVector<unsigned int> &dimensions, unsigned int cellSize = 1,
+                  int nbThreads = QThread::idealThreadCount(), int queueLength = 8);
+    FrameExporter(const FrameExporter &e) = delete;
+    FrameExporter & operator=(const FrameExporter &e) = delete;
+    ~FrameExporter();
+
+    formats getFormat() const;
+    QSize getFrameSize() const;
+    quint64 getNbFrames() const;
+
+    void addFrame(const QVector<unsigned int> &states, unsigned int generation);
+    bool finish();
+};
+
+#endif // FRAMEEXPORTER_H
@@ -0,0 +1,239 @@
+#include <atomic>
+#include <cstring>
+#include <QObject>
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "framering.h"
+
+/** \brief "ATFR", at the beginning of the shared memory
+ */
+static const quint32 frameRingMagic = 0x41544652;
+
+/** \brief Version of the layout of the shared memory
+ */
+static const quint32 frameRingVersion = 1;
+
+/** \brief Offset of the first slot and of the states in a slot
+ */
+static const quint64 frameRingAlignment = 64;
+
+/** \brief Maximum number of dimensions of a frame
+ */
+static const int frameRingMaxDimensions = 8;
+
+/** \brief Number of attempts of readLatest() while the writer overwrites the frames
+ */
+static const int frameRingReadAttempts = 100;
+
+/** \brief Name of a POSIX shared memory object, which starts with '/'
+ */
+static QString sharedMemoryName(QString name)
+{
+    return name.startsWith("/") ? name : "/" + name;
+}
+
+/** \brief Create the shared memory object, replacing any object of the same name
+ *
+ * \param name Name of the shared memory object
+ * \param dimensions Dimensions of the frames
+ * \param nbSlots Number of frames kept, readers have nbSlots - 1 frames of time to copy a frame
+ * \throw QString Not valid dimensions
+ * \throw QString Shared memory not available
+ */
+FrameRing::FrameRing(QString name, const QVector<unsigned int> &dimensions, unsigned int nbSlots) :
+    m_name(sharedMemoryName(name)), m_dimensions(dimensions)
+{
+    if (dimensions.isEmpty() || dimensions.size() > frameRingMaxDimensions || dimensions.contains(0))
+        throw QString(QObject::tr("Not valid dimensions"));
+    nbSlots = qMax(nbSlots, 2u);
+
+    m_size = 1;
+    for (int i = 0; i < dimensions.size(); i++)
+        m_size *= dimensions.at(i);
+    quint64 slotBytes = frameRingAlignment + m_size * sizeof(unsigned int);
+    slotBytes = (slotBytes + frameRingAlignment - 1) / frameRingAlignment * frameRingAlignment;
+    m_bytes = frameRingAlignment + nbSlots * slotBytes;
+
+#ifdef Q_OS_UNIX
+    QByteArray path = m_name.toLocal8Bit();
+    shm_unlink(path.constData());
+    int descriptor = shm_open(path.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (descriptor < 0)
+        throw QString(QObject::tr("Couldn't create the shared memory %1").arg(m_name));
+    if (ftruncate(descriptor, m_bytes) != 0)
+    {
+        close(descriptor);
+        shm_unlink(path.constData());
+        throw QString(QObject::tr("Couldn't create the shared memory %1").arg(m_name));
+    }
+    void *memory = mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(path.constData());
+        throw QString(QObject::tr("Couldn't create the shared memory %1").arg(m_name));
+    }
+    m_memory = (uchar*)memory;
+#else
+    throw QString(QObject::tr("Shared memory frames are not supported on this system"));
+#endif
+
+    // The memory is filled with zeros: no frame is published and every sequence is even
+    RingHeader *ring = header();
+    ring->version = frameRingVersion;
+    ring->nbSlots = nbSlots;
+    ring->firstSlot = frameRingAlignment;
+    ring->slotBytes = slotBytes;
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->magic = frameRingMagic;
+}
+
+/** \brief Remove the shared memory object, the readers which mapped it can still read it
+ */
+FrameRing::~FrameRing()
+{
+#ifdef Q_OS_UNIX
+    munmap(m_memory, m_bytes);
+    shm_unlink(m_name.toLocal8Bit().constData());
+#endif
+}
+
+/** \brief Header at the beginning of the shared memory
+ */
+FrameRing::RingHeader *FrameRing::header() const
+{
+    return (RingHeader*)m_memory;
+}
+
+/** \brief Slot of the frame number index
+ */
+FrameRing::FrameHeader *FrameRing::slot(quint64 index) const
+{
+    return (FrameHeader*)(m_memory + frameRingAlignment + (index % header()->nbSlots) * header()->slotBytes);
+}
+
+/** \brief Accessor of m_name
+ */
+QString FrameRing::getName() const
+{
+    return m_name;
+}
+
+/** \brief Accessor of m_dimensions
+ */
+QVector<unsigned int> FrameRing::getDimensions() const
+{
+    return m_dimensions;
+}
+
+/** \brief Number of frames kept in the ring
+ */
+unsigned int FrameRing::getNbSlots() const
+{
+    return header()->nbSlots;
+}
+
+/** \brief Number of frames published since the creation of the ring
+ */
+quint64 FrameRing::getNbPublished() const
+{
+    return header()->published.load();
+}
+
+/** \brief Copy a frame in the next slot of the ring
+ *
+ * \param states States by linear index, of the dimensions of the ring
+ * \param generation Generation of the states
+ */
+void FrameRing::publish(const unsigned int *states, unsigned int generation)
+{
+    RingHeader *ring = header();
+    const quint64 index = ring->published.load();
+    FrameHeader *frame = slot(index);
+
+    // Odd sequence before any write in the slot, even sequence after the last one
+    const quint64 sequence = frame->sequence.load();
+    frame->sequence.store(sequence + 1);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    frame->generation = generation;
+    frame->stateWidth = sizeof(unsigned int);
+    frame->nbDimensions = m_dimensions.size();
+    for (int i = 0; i < m_dimensions.size(); i++)
+        frame->dimensions[i] = m_dimensions.at(i);
+    memcpy((uchar*)frame + frameRingAlignment, states, m_size * sizeof(unsigned int));
+
+    frame->sequence.storeRelease(sequence + 2);
+    ring->published.storeRelease(index + 1);
+}
+
+/** \brief Copy the last complete frame of a ring, as an external reader would do
+ *
+ * \param name Name of the shared memory object
+ * \param dimensions Output, dimensions of the frame
+ * \param generation Output, generation of the frame
+ * \param states Output, states of the frame
+ * \return False if there is no ring of this name, no frame yet, or if no frame could be copied before
+ * being overwritten
+ */
+bool FrameRing::readLatest(QString name, QVector<unsigned int> &dimensions, unsigned int &generation, QVector<unsigned int> &states)
+{
+#ifdef Q_OS_UNIX
+    int descriptor = shm_open(sharedMemoryName(name).toLocal8Bit().constData(), O_RDONLY, 0);
+    if (descriptor < 0)
+        return false;
+    struct stat status;
+    void *memory = fstat(descriptor, &status) == 0 && status.st_size >= (off_t)frameRingAlignment ?
+                mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+    close(descriptor);
+    if (memory == MAP_FAILED)
+        return false;
+
+    bool found = false;
+    const RingHeader *ring = (const RingHeader*)memory;
+    if (ring->magic == frameRingMagic && ring->version == frameRingVersion)
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        for (int attempt = 0; attempt < frameRingReadAttempts && !found; attempt++)
+        {
+            const quint64 published = ring->published.loadAcquire();
+            if (published == 0)
+                break;
+            const FrameHeader *frame = (const FrameHeader*)((const uchar*)memory + ring->firstSlot
+                                                            + ((published - 1) % ring->nbSlots) * ring->slotBytes);
+            const quint64 sequence = frame->sequence.loadAcquire();
+            if (sequence % 2 != 0)
+                continue;
+
+            generation = frame->generation;
+            dimensions.resize(qMin(frame->nbDimensions, (quint32)frameRingMaxDimensions));
+            quint64 size = 1;
+            for (int i = 0; i < dimensions.size(); i++)
+            {
+                dimensions[i] = frame->dimensions[i];
+                size *= dimensions.at(i);
+            }
+            if (frame->stateWidth != sizeof(unsigned int) || frameRingAlignment + size * sizeof(unsigned int) > ring->slotBytes)
+                continue;
+            states.resize(size);
+            memcpy(states.data(), (const uchar*)frame + frameRingAlignment, size * sizeof(unsigned int));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            found = frame->sequence.load() == sequence;
+        }
+    }
+    munmap(memory, status.st_size);
+    return found;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(dimensions);
+    Q_UNUSED(generation);
+    Q_UNUSED(states);
+    return false;
+#endif
+}
@@ -0,0 +1,88 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <QVector>
+#include <QString>
+#include <QAtomicInteger>
+
+
+/** \class FrameRing
+ * \brief Ring of frames in POSIX shared memory, read by other processes without copy or parsing
+ *
+ * The shared memory object (/dev/shm/<name> on Linux) is made of a header of 64 bytes followed by
+ * nbSlots slots of slotBytes bytes. All the numbers are in the byte order of the machine.
+ *
+ * Header:
+ * | Offset | Type   | Content                                             |
+ * |--------|--------|-----------------------------------------------------|
+ * | 0      | uint32 | magic "ATFR" (0x41544652)                           |
+ * | 4      | uint32 | version, 1                                          |
+ * | 8      | uint32 | nbSlots                                             |
+ * | 12     | uint32 | offset of the first slot, 64                        |
+ * | 16     | uint64 | slotBytes                                           |
+ * | 24     | uint64 | number of published frames, the last one is in slot (n - 1) % nbSlots |
+ *
+ * Slot:
+ * | Offset | Type      | Content                                          |
+ * |--------|-----------|--------------------------------------------------|
+ * | 0      | uint64    | sequence, odd while the frame is written         |
+ * | 8      | uint64    | generation                                       |
+ * | 16     | uint32    | stateWidth, bytes per state                      |
+ * | 20     | uint32    | number of dimensions, at most 8                  |
+ * | 24     | uint32[8] | dimensions                                       |
+ * | 64     |           | states by linear index, the first dimension is the fastest |
+ *
+ * A reader copies a slot between two reads of its sequence: the frame is complete if both are equal and
+ * even, otherwise it was overwritten during the copy and the reader tries again (see readLatest()).
+ */
+class FrameRing
+{
+private:
+    /** \brief Header of the shared memory
+     */
+    struct RingHeader
+    {
+        quint32 magic;
+        quint32 version;
+        quint32 nbSlots;
+        quint32 firstSlot;
+        quint64 slotBytes;
+        QAtomicInteger<quint64> published;
+    };
+
+    /** \brief Header of a slot
+     */
+    struct FrameHeader
+    {
+        QAtomicInteger<quint64> sequence;
+        quint64 generation;
+        quint32 stateWidth;
+        quint32 nbDimensions;
+        quint32 dimensions[8];
+    };
+
+    QString m_name; ///< Name of the shared memory object, starting with '/'
+    QVector<unsigned int> m_dimensions; ///< Dimensions of the frames
+    quint64 m_size; ///< Number of cells of a frame
+    quint64 m_bytes; ///< Size of the shared memory
+    uchar *m_memory = nullptr; ///< Mapped shared memory
+
+    RingHeader *header() const;
+    FrameHeader *slot(quint64 index) const;
+
+public:
+    FrameRing(QString name, const QVector<unsigned int> &dimensions, unsigned int nbSlots = 4);
+    FrameRing(const FrameRing &r) = delete;
+    FrameRing & operator=(const FrameRing &r) = delete;
+    ~FrameRing();
+
+    QString getName() const;
+    QVector<unsigned int> getDimensions() const;
+    unsigned int getNbSlots() const;
+    quint64 getNbPublished() const;
+
+    void publish(const unsigned int *states, unsigned int generation);
+    static bool readLatest(QString name, QVector<unsigned int> &dimensions, unsigned int &generation, QVector<unsigned int> &states);
+};
+
+#endif // FRAMERING_H
@@ -0,0 +1,138 @@
+#include <algorithm>
+
+#include "generationsrule.h"
+#include "compiledrules.h"
+
+/** \brief Sorted copy of the counts, without duplicates
+ */
+static QVector<unsigned int> sortedCounts(QVector<unsigned int> counts)
+{
+    std::sort(counts.begin(), counts.end());
+    counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+    return counts;
+}
+
+/** \brief Sorted counts as intervals of consecutive counts
+ */
+static QVector<QPair<unsigned int, unsigned int> > countIntervals(const QVector<unsigned int> &counts)
+{
+    QVector<QPair<unsigned int, unsigned int> > intervals;
+    for (int i = 0; i < counts.size(); i++)
+    {
+        if (!intervals.isEmpty() && intervals.last().second + 1 == counts.at(i))
+            intervals.last().second = counts.at(i);
+        else
+            intervals.push_back(qMakePair(counts.at(i), counts.at(i)));
+    }
+    return intervals;
+}
+
+/** \brief Constructs a Generations rule
+ *
+ * \param birth Numbers of alive neighbours for which a dead cell is born
+ * \param survival Numbers of alive neighbours for which an alive cell stays alive
+ * \param nbStates Number of states, with the dead and the alive ones
+ * \throw QString Not valid number of states
+ */
+GenerationsRule::GenerationsRule(const QVector<unsigned int> &birth, const QVector<unsigned int> &survival, unsigned int nbStates) :
+    Rule(QVector<unsigned int>(), 1), m_birth(sortedCounts(birth)), m_survival(sortedCounts(survival)), m_nbStates(nbStates)
+{
+    if (nbStates < 2)
+        throw QString(QObject::tr("A Generations rule needs at least 2 states"));
+    for (unsigned int state = 0; state < nbStates; state++)
+        m_currentCellPossibleValues.push_back(state);
+}
+
+/** \brief Accessor of m_birth
+ */
+const QVector<unsigned int> &GenerationsRule::getBirth() const
+{
+    return m_birth;
+}
+
+/** \brief Accessor of m_survival
+ */
+const QVector<unsigned int> &GenerationsRule::getSurvival() const
+{
+    return m_survival;
+}
+
+/** \brief Accessor of m_nbStates
+ */
+unsigned int GenerationsRule::getNbStates() const
+{
+    return m_nbStates;
+}
+
+/** \brief Next state of a cell
+ *
+ * \param state State of the cell
+ * \param nbAlive Number of neighbours in the state 1
+ */
+unsigned int GenerationsRule::getNextState(unsigned int state, unsigned int nbAlive) const
+{
+    if (state == 0)
+        return m_birth.contains(nbAlive) ? 1 : 0;
+    if (state == 1)
+        return m_survival.contains(nbAlive) ? 1 : (m_nbStates > 2 ? 2 : 0);
+    if (state < m_nbStates)
+        return (state + 1) % m_nbStates;
+    return state;
+}
+
+/** \brief Checks if the cell changes of state, its next state is given by getNextState()
+ *
+ * \param c current cell
+ */
+bool GenerationsRule::matchCell(const Cell *c) const
+{
+    return getNextState(c->getState(), c->countNeighbours(1)) != c->getState();
+}
+
+/** \brief Compile the rule as NeighbourRules on the counter of the state 1
+ *
+ * The survival intervals keep the alive cells in the state 1 before the rule which makes them die.
+ */
+void GenerationsRule::compile(CompiledRules &program) const
+{
+    const QSet<unsigned int> alive = QSet<unsigned int>() << 1;
+    const QPair<unsigned int, unsigned int> anyCount(0, program.getNeighbourhood().size());
+
+    QVector<QPair<unsigned int, unsigned int> > intervals = countIntervals(m_birth);
+    for (int i = 0; i < intervals.size(); i++)
+        program.addNeighbourRule(1, QVector<unsigned int>() << 0, intervals.at(i), alive);
+    intervals = countIntervals(m_survival);
+    for (int i = 0; i < intervals.size(); i++)
+        program.addNeighbourRule(1, QVector<unsigned int>() << 1, intervals.at(i), alive);
+    program.addNeighbourRule(m_nbStates > 2 ? 2 : 0, QVector<unsigned int>() << 1, anyCount, alive);
+    for (unsigned int state = 2; state < m_nbStates; state++)
+        program.addNeighbourRule((state + 1) % m_nbStates, QVector<unsigned int>() << state, anyCount, alive);
+}
+
+/** \brief Copy of the rule, to be deleted by the caller
+ */
+GenerationsRule *GenerationsRule::clone() const
+{
+    return new GenerationsRule(*this);
+}
+
+/** \brief Return a QJsonObject to save the rule
+ */
+QJsonObject GenerationsRule::toJson() const
+{
+    QJsonObject object;
+    object.insert("type", QJsonValue("generations"));
+
+    QJsonArray birth;
+    for (int i = 0; i < m_birth.size(); i++)
+        birth.append(QJsonValue((int)m_birth.at(i)));
+    object.insert("birth", birth);
+
+    QJsonArray survival;
+    for (int i = 0; i < m_survival.size(); i++)
+        survival.append(QJsonValue((int)m_survival.at(i)));
+    object.insert("survival", survival);
+    object.insert("nbStates", QJsonValue((int)m_nbStates));
+
+    return object;
+}
@@ -0,0 +1,45 @@
+#ifndef GENERATIONSRULE_H
+#define GENERATIONSRULE_H
+
+#include <QVector>
+#include "rule.h"
+
+/** \class GenerationsRule
+ * \brief Rule of the "Generations" family: birth and survival counts of alive neighbours, then decay states
+ *
+ * The state 0 is dead, 1 is alive and the states from 2 to nbStates - 1 are dying. Only the alive neighbours
+ * are counted:
+ * - a dead cell is born if its number of alive neighbours is in the birth counts,
+ * - an alive cell stays alive if its number of alive neighbours is in the survival counts, otherwise it
+ *   starts dying (state 2, or 0 if there are only 2 states),
+ * - a dying cell goes to the next state whatever its neighbours, the last one goes back to 0.
+ *
+ * Brian's Brain (B2/S/C3):
+ * \code
+ * {"type": "generations", "birth": [2], "survival": [], "nbStates": 3}
+ * \endcode
+ *
+ * The rule is compiled into NeighbourRules which all count the state 1, so the CompiledRules evaluate it with
+ * their count table: one count and one table access per cell.
+ */
+class GenerationsRule : public Rule
+{
+protected:
+    QVector<unsigned int> m_birth; ///< Numbers of alive neighbours for which a dead cell is born, sorted
+    QVector<unsigned int> m_survival; ///< Numbers of alive neighbours for which an alive cell stays alive, sorted
+    unsigned int m_nbStates; ///< Number of states, the dying states are from 2 to m_nbStates - 1
+public:
+    GenerationsRule(const QVector<unsigned int> &birth, const QVector<unsigned int> &survival, unsigned int nbStates = 2);
+
+    const QVector<unsigned int> &getBirth() const;
+    const QVector<unsigned int> &getSurvival() const;
+    unsigned int getNbStates() const;
+    unsigned int getNextState(unsigned int state, unsigned int nbAlive) const;
+
+    bool matchCell(const Cell * c) const;
+    void compile(CompiledRules &program) const;
+    GenerationsRule* clone() const;
+    QJsonObject toJson() const;
+};
+
+#endif // GENERATIONSRULE_H
@@ -3,9 +3,49 @@
 #include "cell.h"
 #include "mainwindow.h"
 #include "ruleeditor.h"
+#include "sweepdriver.h"
+#include "slabworker.h"
 
 int main(int argc, char * argv[])
 {
+    // Parameter sweep without GUI, see SweepDriver
+    if (SweepDriver::isRequested(argc, argv))
+    {
+        QCoreApplication app(argc, argv);
+        app.setOrganizationName("LO21-project");
+        app.setApplicationName("AutoCell");
+
+        try
+        {
+            SweepDriver driver;
+            if (!driver.parseArguments(app.arguments()))
+                return 0;
+            return driver.run() ? 0 : 1;
+        }
+        catch (QString &error)
+        {
+            qCritical() << error;
+            return 1;
+        }
+    }
+
+    // Worker process of a SlabCluster
+    if (SlabWorker::isRequested(argc, argv))
+    {
+        QCoreApplication app(argc, argv);
+
+        try
+        {
+            SlabWorker worker;
+            return worker.run(app.arguments()) ? 0 : 1;
+        }
+        catch (QString &error)
+        {
+            qCritical() << error;
+            return 1;
+        }
+    }
+
     QApplication app(argc, argv);
     QApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
 
@@ -16,29 +16,18 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     m_tabs = NULL;
     m_running = false;
 
+    m_jumpWatcher = new QFutureWatcher<bool>(this);
+    m_jumpTimer = new QTimer(this);
+    connect(m_jumpWatcher, SIGNAL(finished()), this, SLOT(jumpFinished()));
+    connect(m_jumpTimer, SIGNAL(timeout()), this, SLOT(updateJumpProgress()));
+
+    // Only the tabs are restored, each automaton is loaded when its tab is first shown
     QSettings settings;
     int nbAutomate = settings.value("nbAutomate").toInt();
     for (int i = 0; i < nbAutomate; i++)
     {
         QString fileName = QString(".automate"+QString::number(i));
-        try{
-            AutomateHandler::getAutomateHandler().addAutomate(new Automate(QString(fileName+".atc"), QString(fileName+".atr")));
-        if(m_tabs == NULL)
-            createTabs();
-        m_tabs->addTab(createTab(), "Automaton "+ QString::number(AutomateHandler::getAutomateHandler().getNumberAutomates()));
-        updateBoard(AutomateHandler::getAutomateHandler().getNumberAutomates()-1);
-        }
-        catch (QString &s)
-        {
-            QMessageBox msgBox;
-            msgBox.warning(0,"Error",s);
-            msgBox.setFixedSize(500,200);
-        }
-        QFile fichier(QString(fileName + ".atc"));
-        fichier.remove();
-        fichier.close();
-        QFile fichier2(QString(fileName + ".atr"));
-        fichier2.remove();
+        addPendingTab(QString(fileName+".atc"), QString(fileName+".atr"), true, "Automaton "+ QString::number(i+1));
     }
     m_zoom->setValue(settings.value("zoom").toInt());
     m_timeStep->setValue(settings.value("timestamp").toInt());
@@ -50,17 +39,73 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
  */
 MainWindow::~MainWindow()
 {
+    // Stop a running jump before saving the automata
+    m_jumpCancelled.store(1);
+    m_jumpWatcher->waitForFinished();
+    stopExport();
+
+    // Wait for the automata being loaded, the ones of the open tabs are kept
+    for (int i = 0; i < m_abandonedLoads.size(); i++)
+    {
+        m_abandonedLoads.at(i)->waitForFinished();
+        delete m_abandonedLoads.at(i)->result().automate;
+    }
+    for (QMap<QWidget*, PendingTab>::iterator it = m_pendingTabs.begin(); it != m_pendingTabs.end(); ++it)
+    {
+        if (it.value().watcher == nullptr)
+            continue;
+        it.value().watcher->waitForFinished();
+        LoadResult result = it.value().watcher->result();
+        if (result.automate != nullptr)
+        {
+            AutomateHandler::getAutomateHandler().setAutomate(m_tabs->indexOf(it.key()), result.automate);
+            removePendingFiles(it.value());
+        }
+    }
+
     // Saving settings for further sessions
     QSettings settings;
-    settings.setValue("nbAutomate", AutomateHandler::getAutomateHandler().getNumberAutomates());
     settings.setValue("zoom", m_zoom->value());
     settings.setValue("timestamp", m_timeStep->value());
 
+    // The files of the tabs never shown are first moved aside: as the tabs can be moved, a saved automaton
+    // could otherwise overwrite the files of a pending tab before they are moved to their new index
+    QMap<unsigned int, QString> movedFiles;
     for (unsigned int i = 0; i < AutomateHandler::getAutomateHandler().getNumberAutomates(); i++)
     {
-        AutomateHandler::getAutomateHandler().getAutomate(i)->saveAll(QString(".automate"+QString::number(i)+".atc"), QString(".automate"+QString::number(i)+".atr"));
+        if (AutomateHandler::getAutomateHandler().getAutomate(i) != nullptr)
+            continue;
+        const PendingTab pending = m_pendingTabs.value(m_tabs->widget(i));
+        if (!pending.sessionFiles || pending.watcher != nullptr || !QFile::exists(pending.cellFile))
+            continue;
+        QString temporaryName = QString(".pending"+QString::number(i));
+        QFile::remove(QString(temporaryName+".atc"));
+        QFile::remove(QString(temporaryName+".atr"));
+        QFile::rename(pending.cellFile, QString(temporaryName+".atc"));
+        QFile::rename(pending.ruleFile, QString(temporaryName+".atr"));
+        movedFiles.insert(i, temporaryName);
     }
 
+    int nbSaved = 0;
+    for (unsigned int i = 0; i < AutomateHandler::getAutomateHandler().getNumberAutomates(); i++)
+    {
+        QString fileName = QString(".automate"+QString::number(nbSaved));
+        Automate *automate = AutomateHandler::getAutomateHandler().getAutomate(i);
+        if (automate != nullptr)
+        {
+            automate->saveAll(QString(fileName+".atc"), QString(fileName+".atr"));
+            nbSaved++;
+        }
+        else if (movedFiles.contains(i))
+        {
+            QFile::remove(QString(fileName+".atc"));
+            QFile::remove(QString(fileName+".atr"));
+            QFile::rename(QString(movedFiles.value(i)+".atc"), QString(fileName+".atc"));
+            QFile::rename(QString(movedFiles.value(i)+".atr"), QString(fileName+".atr"));
+            nbSaved++;
+        }
+    }
+    settings.setValue("nbAutomate", nbSaved);
 }
 
 
@@ -108,6 +153,10 @@ void MainWindow::createButtons(){
     QAction *saveAutomaton = new QAction(saveIcon, tr("Save automaton"), this);
     QAction *newAutomaton = new QAction(newIcon, tr("New automaton"), this);
     QAction *resetAutomaton = new QAction(resetIcon, tr("Reset automaton"), this);
+    QAction *goToGeneration = new QAction(tr("Go to..."), this);
+    goToGeneration->setToolTip(tr("Go to generation"));
+    QAction *exportFrames = new QAction(tr("Export..."), this);
+    exportFrames->setToolTip(tr("Export the next generations as images or raw video"));
 
     m_previousStateBt = new QToolButton(this);
     m_nextStateBt = new QToolButton(this);
@@ -116,6 +165,8 @@ void MainWindow::createButtons(){
     m_newAutomatonBt = new QToolButton(this);
     m_openAutomatonBt = new QToolButton(this);
     m_resetBt = new QToolButton(this);
+    m_goToBt = new QToolButton(this);
+    m_exportBt = new QToolButton(this);
 
     m_previousStateBt->setDefaultAction(previousState);
     m_nextStateBt->setDefaultAction(nextState);
@@ -124,6 +175,8 @@ void MainWindow::createButtons(){
     m_newAutomatonBt->setDefaultAction(newAutomaton);
     m_openAutomatonBt->setDefaultAction(openAutomaton);
     m_resetBt->setDefaultAction(resetAutomaton);
+    m_goToBt->setDefaultAction(goToGeneration);
+    m_exportBt->setDefaultAction(exportFrames);
 
     m_previousStateBt->setIconSize(QSize(30,30));
     m_nextStateBt->setIconSize(QSize(30,30));
@@ -148,6 +201,8 @@ void MainWindow::createButtons(){
     connect(m_previousStateBt, SIGNAL(clicked(bool)), this, SLOT(backward()));
     connect(m_playPauseBt, SIGNAL(clicked(bool)), this, SLOT(handlePlayPause()));
     connect(m_resetBt,SIGNAL(clicked(bool)), this,SLOT(reset()));
+    connect(m_goToBt, SIGNAL(clicked(bool)), this, SLOT(goToGeneration()));
+    connect(m_exportBt, SIGNAL(clicked(bool)), this, SLOT(exportFrames()));
     connect(m_zoom, SIGNAL(valueChanged(int)), this, SLOT(setSize(int)));
 
 }
@@ -191,6 +246,8 @@ void MainWindow::createToolBar(){
     tbLayout->addWidget(m_playPauseBt, Qt::AlignCenter);
     tbLayout->addWidget(m_nextStateBt, Qt::AlignCenter);
     tbLayout->addWidget(m_resetBt, Qt::AlignCenter);
+    tbLayout->addWidget(m_goToBt, Qt::AlignCenter);
+    tbLayout->addWidget(m_exportBt, Qt::AlignCenter);
     tbLayout->addLayout(tsLayout);
     tbLayout->addLayout(csLayout);
 
@@ -206,13 +263,25 @@ void MainWindow::createToolBar(){
 }
 
 /** \fn MainWindow::createTab()
- * \brief Creates a new Tab with an empty board
+ * \brief Creates a new Tab with an empty board for the last automaton
  */
 
 QWidget* MainWindow::createTab(){
     QWidget *tab = new QWidget(this);
-    QVBoxLayout *layout = new QVBoxLayout(this);
-    QVector<unsigned int> dimensions = AutomateHandler::getAutomateHandler().getAutomate(AutomateHandler::getAutomateHandler().getNumberAutomates()-1)->getCellHandler().getDimensions();
+    fillTab(tab, AutomateHandler::getAutomateHandler().getNumberAutomates()-1);
+    return tab;
+}
+
+/** \fn MainWindow::fillTab(QWidget *tab, int index)
+ * \brief Replaces the content of a tab by an empty board with the dimensions of the automaton at the given index
+ */
+
+void MainWindow::fillTab(QWidget *tab, int index){
+    qDeleteAll(tab->findChildren<QWidget*>(QString(), Qt::FindDirectChildrenOnly));
+    delete tab->layout();
+
+    QVBoxLayout *layout = new QVBoxLayout();
+    QVector<unsigned int> dimensions = AutomateHandler::getAutomateHandler().getAutomate(index)->getCellHandler().getDimensions();
     int boardVSize = 0;
     int boardHSize = 0;
     if(dimensions.size() > 1){
@@ -249,26 +318,178 @@ QWidget* MainWindow::createTab(){
      layout->addWidget(scrollArea);
      tab->setLayout(layout);
      connect(board, SIGNAL(cellClicked(int,int)), this, SLOT(cellPressed(int,int)));
-     return tab;
+}
+
+/** \fn MainWindow::addPendingTab(QString cellFile, QString ruleFile, bool sessionFiles, QString title)
+ * \brief Adds a tab which only shows the name and the size of its file until its automaton is loaded by startLoad()
+ *
+ * A slot is reserved for the automaton in the AutomateHandler.
+ */
+
+QWidget* MainWindow::addPendingTab(QString cellFile, QString ruleFile, bool sessionFiles, QString title){
+    PendingTab pending;
+    pending.cellFile = cellFile;
+    pending.ruleFile = ruleFile;
+    pending.sessionFiles = sessionFiles;
+
+    QWidget *tab = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout();
+    QFileInfo info(cellFile);
+    QLabel *label = new QLabel(tr("%1 (%2 KiB)").arg(info.fileName()).arg((info.size() + 1023) / 1024), tab);
+    label->setAlignment(Qt::AlignCenter);
+    QProgressBar *progress = new QProgressBar(tab);
+    progress->setRange(0, 0);
+    progress->setVisible(false);
+    QPushButton *cancel = new QPushButton(tr("Cancel"), tab);
+    cancel->setVisible(false);
+    connect(cancel, SIGNAL(clicked(bool)), this, SLOT(cancelLoad()));
+
+    layout->addStretch();
+    layout->addWidget(label);
+    layout->addWidget(progress);
+    layout->addWidget(cancel, 0, Qt::AlignCenter);
+    layout->addStretch();
+    tab->setLayout(layout);
+
+    AutomateHandler::getAutomateHandler().addAutomate(nullptr);
+    m_pendingTabs.insert(tab, pending);
+    if(m_tabs == NULL) createTabs();
+    m_tabs->addTab(tab, title);
+    return tab;
+}
+
+/** \fn MainWindow::startLoad(QWidget *tab)
+ * \brief Loads the automaton of a pending tab in another thread, if it isn't already loading
+ */
+
+void MainWindow::startLoad(QWidget *tab){
+    if(!m_pendingTabs.contains(tab) || m_pendingTabs.value(tab).watcher != nullptr)
+        return;
+    PendingTab &pending = m_pendingTabs[tab];
+    pending.watcher = new QFutureWatcher<LoadResult>(this);
+    connect(pending.watcher, SIGNAL(finished()), this, SLOT(loadFinished()));
+    pending.watcher->setFuture(QtConcurrent::run(&MainWindow::loadAutomate, pending.cellFile, pending.ruleFile));
+
+    tab->findChild<QProgressBar*>()->setVisible(true);
+    tab->findChild<QPushButton*>()->setVisible(true);
+}
+
+/** \fn MainWindow::loadAutomate(QString cellFile, QString ruleFile)
+ * \brief Loads an automaton from a cell file and a rule file, or from a checkpoint (.atk), called in another thread
+ */
+
+MainWindow::LoadResult MainWindow::loadAutomate(QString cellFile, QString ruleFile){
+    LoadResult result;
+    try{
+        if(cellFile.endsWith(".atk"))
+            result.automate = Checkpoint::resume(cellFile);
+        else if(ruleFile.isEmpty())
+            result.automate = new Automate(cellFile);
+        else
+            result.automate = new Automate(cellFile, ruleFile);
+    }
+    catch (QString &s)
+    {
+        result.error = s;
+    }
+    return result;
+}
+
+/** \fn MainWindow::removePendingFiles(const PendingTab &pending)
+ * \brief Deletes the files of a pending tab if they were saved by the last session
+ */
+
+void MainWindow::removePendingFiles(const PendingTab &pending){
+    if(!pending.sessionFiles)
+        return;
+    QFile::remove(pending.cellFile);
+    QFile::remove(pending.ruleFile);
+}
+
+/** \fn MainWindow::setAutomatonButtonsEnabled(bool enabled)
+ * \brief Enables the buttons which use the automaton of the current tab
+ */
+
+void MainWindow::setAutomatonButtonsEnabled(bool enabled){
+    m_previousStateBt->setEnabled(enabled);
+    m_playPauseBt->setEnabled(enabled);
+    m_nextStateBt->setEnabled(enabled);
+    m_resetBt->setEnabled(enabled);
+    m_goToBt->setEnabled(enabled);
+    m_exportBt->setEnabled(enabled);
+    m_cellSetter->setEnabled(enabled);
+}
+
+/** \fn MainWindow::cancelLoad()
+ * \brief Closes the current tab while its automaton is loading
+ */
+
+void MainWindow::cancelLoad(){
+    if(m_tabs != NULL && m_pendingTabs.contains(m_tabs->currentWidget()))
+        closeTab(m_tabs->currentIndex());
+}
+
+/** \fn MainWindow::loadFinished()
+ * \brief Shows the board of a loaded automaton, or removes its tab if it couldn't be loaded
+ *
+ * The automaton of a closed tab is deleted.
+ */
+
+void MainWindow::loadFinished(){
+    QFutureWatcher<LoadResult> *watcher = static_cast<QFutureWatcher<LoadResult>*>(sender());
+    LoadResult result = watcher->result();
+    watcher->deleteLater();
+
+    QWidget *tab = nullptr;
+    for (QMap<QWidget*, PendingTab>::const_iterator it = m_pendingTabs.constBegin(); it != m_pendingTabs.constEnd(); ++it)
+        if(it.value().watcher == watcher)
+            tab = it.key();
+    if(tab == nullptr){
+        m_abandonedLoads.removeOne(watcher);
+        delete result.automate;
+        return;
+    }
+
+    PendingTab pending = m_pendingTabs.take(tab);
+    int index = m_tabs->indexOf(tab);
+    if(result.automate == nullptr){
+        AutomateHandler::getAutomateHandler().removeAutomate(index);
+        m_tabs->removeTab(index);
+        tab->deleteLater();
+        QMessageBox msgBox;
+        msgBox.warning(0,"Error",result.error);
+        msgBox.setFixedSize(500,200);
+        return;
+    }
+    removePendingFiles(pending);
+
+    AutomateHandler::getAutomateHandler().setAutomate(index, result.automate);
+    fillTab(tab, index);
+    updateBoard(index);
+    if(m_tabs->currentWidget() == tab)
+        setAutomatonButtonsEnabled(true);
+
+    // An opened cell file has no rules yet
+    if(!pending.sessionFiles && !pending.cellFile.endsWith(".atk")){
+        openRuleEditor(tab);
+    }
 }
 
 /** \fn MainWindow::openFile()
  * \brief Opens a file browser for the user to select automaton files and creates an automaton
+ *
+ * A checkpoint file (.atk) gives back a whole run, with its rules and its history.
+ * The file is loaded in another thread, see startLoad().
  */
 void MainWindow::openFile(){
     QString fileName = QFileDialog::getOpenFileName(this, tr("Open Cell file"), ".",
-                                                    tr("Automaton cell files (*.atc)"));
-    if(!fileName.isEmpty()){
-        AutomateHandler::getAutomateHandler().addAutomate(new Automate(fileName));
-        if(m_tabs == NULL) createTabs();
-        m_tabs->addTab(createTab(), "Automaton "+ QString::number(AutomateHandler::getAutomateHandler().getNumberAutomates()+1));
-        updateBoard(AutomateHandler::getAutomateHandler().getNumberAutomates()-1);
-
-        RuleEditor* ruleEditor = new RuleEditor(AutomateHandler::getAutomateHandler().getAutomate(AutomateHandler::getAutomateHandler().getNumberAutomates()-1)->getCellHandler().getDimensions().size(), this);
-        connect(ruleEditor, SIGNAL(fileImported(QString)),this,SLOT(addAutomatonRuleFile(QString)));
-        connect(ruleEditor, SIGNAL(rulesFilled(QList<const NeighbourRule*>)), this, SLOT(addAutomatonRules(QList<const NeighbourRule*>)));
-        ruleEditor->show();
-    }
+                                                    tr("Automaton cell files (*.atc);;Checkpoints (*.atk)"));
+    if(fileName.isEmpty())
+        return;
+    QWidget *tab = addPendingTab(fileName, QString(), false,
+                                 "Automaton "+ QString::number(AutomateHandler::getAutomateHandler().getNumberAutomates()+1));
+    m_tabs->setCurrentWidget(tab);
+    startLoad(tab);
 }
 
 
@@ -276,7 +497,25 @@ void MainWindow::openFile(){
  * \brief Allows user to select a location and saves automaton's state and settings
  */
 void MainWindow::saveToFile(){
-    if(AutomateHandler::getAutomateHandler().getNumberAutomates() > 0){
+    if(m_tabs != NULL && m_pendingTabs.contains(m_tabs->currentWidget())){
+        // The files of the last session are copied without loading them
+        const PendingTab pending = m_pendingTabs.value(m_tabs->currentWidget());
+        if(!pending.sessionFiles){
+            QMessageBox msgBox;
+            msgBox.critical(0,"Error","The automaton is still loading !");
+            msgBox.setFixedSize(500,200);
+            return;
+        }
+        QString automatonFileName = QFileDialog::getSaveFileName(this, tr("Save Automaton cell configuration"),
+                                                        ".", tr("Automaton Cells file (*.atc"));
+        if(!automatonFileName.isEmpty())
+            QFile::copy(pending.cellFile, automatonFileName+".atc");
+        QString ruleFileName = QFileDialog::getSaveFileName(this, tr("Save Automaton rules"),
+                                                        ".", tr("Automaton Rules file (*.atr"));
+        if(!ruleFileName.isEmpty())
+            QFile::copy(pending.ruleFile, ruleFileName+".atr");
+    }
+    else if(AutomateHandler::getAutomateHandler().getNumberAutomates() > 0){
         QString automatonFileName = QFileDialog::getSaveFileName(this, tr("Save Automaton cell configuration"),
                                                         ".", tr("Automaton Cells file (*.atc"));
         AutomateHandler::getAutomateHandler().getAutomate(m_tabs->currentIndex())->saveCells(automatonFileName+".atc");
@@ -297,21 +536,25 @@ void MainWindow::saveToFile(){
 
 void MainWindow::openCreationWindow(){
     CreationDialog *window = new CreationDialog(this);
-    connect(window, SIGNAL(settingsFilled(QVector<uint>,CellHandler::generationTypes,uint,uint)),
-            this, SLOT(receiveCellHandler(QVector<uint>,CellHandler::generationTypes,uint,uint)));
+    connect(window, SIGNAL(settingsFilled(QVector<uint>,CellHandler::generationTypes,uint,uint,CellHandler::boundaryTypes)),
+            this, SLOT(receiveCellHandler(QVector<uint>,CellHandler::generationTypes,uint,uint,CellHandler::boundaryTypes)));
     window->show();
 }
 
 /** \fn MainWindow::receiveCellHandler(const QVector<unsigned int> dimensions,
                                 CellHandler::generationTypes type,
-                                unsigned int stateMax, unsigned int density)
+                                unsigned int stateMax, unsigned int density,
+                                CellHandler::boundaryTypes boundary)
  * \brief Creates a new cellHandler with the provided arguments and updates the board with the created cellHandler
  */
 
 void MainWindow::receiveCellHandler(const QVector<unsigned int> dimensions,
                                 CellHandler::generationTypes type,
-                                unsigned int stateMax, unsigned int density){
-    AutomateHandler::getAutomateHandler().addAutomate(new Automate(dimensions, type, stateMax, density));
+                                unsigned int stateMax, unsigned int density,
+                                CellHandler::boundaryTypes boundary){
+    Automate* automate = new Automate(dimensions, type, stateMax, density);
+    automate->setBoundary(boundary);
+    AutomateHandler::getAutomateHandler().addAutomate(automate);
 
     if(m_tabs == NULL) createTabs();
     QWidget* newTab = createTab();
@@ -319,10 +562,7 @@ void MainWindow::receiveCellHandler(const QVector<unsigned int> dimensions,
     m_tabs->setCurrentWidget(newTab);
     updateBoard(AutomateHandler::getAutomateHandler().getNumberAutomates()-1);
 
-    RuleEditor* ruleEditor = new RuleEditor(AutomateHandler::getAutomateHandler().getAutomate(AutomateHandler::getAutomateHandler().getNumberAutomates()-1)->getCellHandler().getDimensions().size(), this);
-    connect(ruleEditor, SIGNAL(fileImported(QString)),this,SLOT(addAutomatonRuleFile(QString)));
-    connect(ruleEditor, SIGNAL(rulesFilled(QList<const Rule*>)), this, SLOT(addAutomatonRules(QList<const Rule*>)));
-    ruleEditor->show();
+    openRuleEditor(newTab);
 
 }
 
@@ -359,31 +599,27 @@ void MainWindow::updateBoard(int index){
         QVector<unsigned int> dimensions = cellHandler->getDimensions();
         QTableWidget* board = getBoard(index);
         if(dimensions.size() > 1){
-            int i = 0;
-            int j = 0;
-            for (CellHandler::const_iterator it = cellHandler->begin(); it != cellHandler->end() && it.changedDimension() < 2; ++it){
-                    if(it.changedDimension() > 0){
-                        i = 0;
-                        j++;
-                    }
-                    board->item(i,j)->setBackgroundColor(getColor(it->getState()));
-                    i++;
+            // Rows of the first plane
+            for (CellHandler::span_iterator row = cellHandler->spans(); row != cellHandler->end() && row.changedDimension() < 2; ++row){
+                    const unsigned int *states = row.states();
+                    int j = row.position().at(1);
+                    for (unsigned int i = 0; i < row.length(); i++)
+                        board->item(i,j)->setBackgroundColor(Palette::color(states[i]));
             }
         }
         else{ // dimension = 1
             if (board->rowCount() != 1)
                 addEmptyRow(index);
             int i = board->rowCount() -1;
-            int j = 0;
-            for (CellHandler::const_iterator it = cellHandler->begin(); it != cellHandler->end() && it.changedDimension() < 1; ++it){
-                    board->item(i,j)->setBackgroundColor(getColor(it->getState()));
-                    j++;
-            }
+            CellHandler::span_iterator row = cellHandler->spans();
+            const unsigned int *states = row.states();
+            for (unsigned int j = 0; row != cellHandler->end() && j < row.length(); j++)
+                    board->item(i,j)->setBackgroundColor(Palette::color(states[j]));
             if (board->rowCount() == 1)
                 addEmptyRow(index);
 
             // Go to bottom
-            QScrollArea *scrool = static_cast<QScrollArea*>(m_tabs->currentWidget()->layout()->itemAt(0)->widget());
+            QScrollArea *scrool = static_cast<QScrollArea*>(m_tabs->widget(index)->layout()->itemAt(0)->widget());
 
             scrool->verticalScrollBar()->setSliderPosition(scrool->verticalScrollBar()->maximum());
 
@@ -408,67 +644,6 @@ QTableWidget* MainWindow::getBoard(int n){
     return m_tabs->widget(n)->findChild<QTableWidget *>();
 }
 
-/** \brief Return the color wich correspond to the cellState
- *
- * The maximal state supported is 21. Use hookMoreColor to add more.
- */
-QColor MainWindow::getColor(int cellState)
-{
-    if (cellState > QColor::colorNames().size() -2)
-        return Qt::black;
-    switch (cellState)
-    {
-    case 0:
-        return Qt::white;
-    case 1:
-        return Qt::black;
-    case 2:
-        return Qt::red;
-    case 3:
-        return Qt::green;
-    case 4:
-        return Qt::blue;
-    case 5:
-        return Qt::yellow;
-    case 6:
-        return QColor(170, 110, 40); // brown
-    case 7:
-        return QColor(145,30, 180); // purple
-    case 8:
-        return QColor(245,130,48); // orange
-    case 9:
-        return Qt::cyan;
-    case 10:
-        return Qt::magenta;
-    case 11:
-        return QColor(210, 245, 60); // Lime
-    case 12:
-        return QColor(250, 190, 190); // pink
-    case 13:
-        return QColor(0,128,128); // Teal
-    case 14:
-        return QColor(230, 190, 255); // Lavender
-    case 15:
-        return QColor(255, 250, 200); // beige
-    case 16:
-        return QColor(128, 0,0); // Maroon
-    case 17:
-        return QColor(170, 255, 195); // Mint
-    case 18:
-        return QColor(128, 128, 0); // Olive
-    case 19:
-        return QColor(255, 215, 180); // Coral
-    case 20:
-        return QColor(0,0,128); // Navy
-    case 21:
-        return Qt::gray;
-
-
-    }
-
-    return hookMoreColor(cellState);
-}
-
 /** \fn MainWindow::createTabs()
  * \brief Creates a QTabWidget for the main window and displays it
  */
@@ -507,29 +682,89 @@ void MainWindow::addEmptyRow(unsigned int n)
  */
 
 void MainWindow::closeTab(int n){
+    QWidget *tab = m_tabs->widget(n);
+    if(m_pendingTabs.contains(tab)){
+        // The automaton isn't loaded: the files of the last session can be saved, an opened file is left as it is
+        const PendingTab pending = m_pendingTabs.value(tab);
+        if(pending.sessionFiles){
+            m_tabs->blockSignals(true);
+            m_tabs->setCurrentIndex(n);
+            m_tabs->blockSignals(false);
+            saveToFile();
+        }
+        m_pendingTabs.remove(tab);
+        if(pending.watcher != nullptr)
+            m_abandonedLoads.append(pending.watcher);
+        removePendingFiles(pending);
+        AutomateHandler::getAutomateHandler().removeAutomate(n);
+        m_tabs->removeTab(n);
+        tab->deleteLater();
+        return;
+    }
     m_tabs->setCurrentIndex(n);
     saveToFile();
     AutomateHandler::getAutomateHandler().deleteAutomate(AutomateHandler::getAutomateHandler().getAutomate(n));
     m_tabs->removeTab(n);
 }
 
-/** \fn MainWindow::addAutomatonRules(QList<const Rule *> rules)
- * \brief Adds a list of rules to the last Automaton
+/** \fn MainWindow::openRuleEditor(QWidget *tab)
+ * \brief Opens a RuleEditor for the automaton of a loaded tab
+ *
+ * The rules are given to the automaton of this tab, even if other tabs were added or removed in the meantime.
+ */
+
+void MainWindow::openRuleEditor(QWidget *tab){
+    Automate *automate = AutomateHandler::getAutomateHandler().getAutomate(m_tabs->indexOf(tab));
+    RuleEditor* ruleEditor = new RuleEditor(automate->getCellHandler().getDimensions().size(), this);
+    connect(ruleEditor, &RuleEditor::fileImported, this, [this, tab](QString path) { addAutomatonRuleFile(tab, path); });
+    connect(ruleEditor, &RuleEditor::rulesFilled, this, [this, tab](QList<const Rule*> rules) { addAutomatonRules(tab, rules); });
+    ruleEditor->show();
+}
+
+/** \fn MainWindow::addAutomatonRules(QWidget *tab, QList<const Rule *> rules)
+ * \brief Adds a list of rules to the Automaton of a tab, the rules are deleted if the tab was closed
  */
 
-void MainWindow::addAutomatonRules(QList<const Rule *> rules){
+void MainWindow::addAutomatonRules(QWidget *tab, QList<const Rule *> rules){
+    Automate *automate = nullptr;
+    if(m_tabs != NULL && m_tabs->indexOf(tab) >= 0)
+        automate = AutomateHandler::getAutomateHandler().getAutomate(m_tabs->indexOf(tab));
+    if(automate == nullptr){
+        qDeleteAll(rules);
+        QMessageBox msgBox;
+        msgBox.warning(0,"Error",tr("The automaton of these rules was closed"));
+        msgBox.setFixedSize(500,200);
+        return;
+    }
     for(int i =0 ; i < rules.size();i++)
     {
-        AutomateHandler::getAutomateHandler().getAutomate(AutomateHandler::getAutomateHandler().getNumberAutomates()-1)->addRule(rules.at(i));
+        automate->addRule(rules.at(i));
     }
 }
 
-/** \fn MainWindow::addAutomatonRuleFile(QString path)
- * \brief Adds a list of rules to the last Automaton from a given file
+/** \fn MainWindow::addAutomatonRuleFile(QWidget *tab, QString path)
+ * \brief Adds a list of rules to the Automaton of a tab from a given file
  */
 
-void MainWindow::addAutomatonRuleFile(QString path){
-    AutomateHandler::getAutomateHandler().getAutomate(AutomateHandler::getAutomateHandler().getNumberAutomates()-1)->addRuleFile(path);
+void MainWindow::addAutomatonRuleFile(QWidget *tab, QString path){
+    Automate *automate = nullptr;
+    if(m_tabs != NULL && m_tabs->indexOf(tab) >= 0)
+        automate = AutomateHandler::getAutomateHandler().getAutomate(m_tabs->indexOf(tab));
+    if(automate == nullptr){
+        QMessageBox msgBox;
+        msgBox.warning(0,"Error",tr("The automaton of these rules was closed"));
+        msgBox.setFixedSize(500,200);
+        return;
+    }
+    try{
+        automate->addRuleFile(path);
+    }
+    catch (QString &s)
+    {
+        QMessageBox msgBox;
+        msgBox.warning(0,"Error",s);
+        msgBox.setFixedSize(500,200);
+    }
 }
 
 /** \fn MainWindow::handlePlayPause()
@@ -620,11 +855,11 @@ void MainWindow::cellPressed(int i, int j){
     if(cellHandler->getDimensions().size() > 1){
         coord.append(i);
         coord.append(j);
-        m_cellSetter->setValue(cellHandler->getCell(coord)->getState());
+        m_cellSetter->setValue(cellHandler->getCell(coord).getState());
     }
     else{
         coord.append(j);
-        m_cellSetter->setValue(cellHandler->getCell(coord)->getState());
+        m_cellSetter->setValue(cellHandler->getCell(coord).getState());
     }
 }
 
@@ -641,24 +876,22 @@ void MainWindow::changeCellValue(){
     }
     else{
         if(m_currentCellX > -1 && m_currentCellY > -1){
-            const CellHandler* cellHandler = &(AutomateHandler::getAutomateHandler().getAutomate(m_tabs->currentIndex())->getCellHandler());
+            CellHandler* cellHandler = &(AutomateHandler::getAutomateHandler().getAutomate(m_tabs->currentIndex())->getCellHandler());
             QVector<unsigned int> coord;
             if(cellHandler->getDimensions().size() > 1){
                 coord.append(m_currentCellX);
                 coord.append(m_currentCellY);
-                cellHandler->getCell(coord)->forceState(m_cellSetter->value());
+                cellHandler->getCell(coord).forceState(m_cellSetter->value());
                 updateBoard(m_tabs->currentIndex());
             }
             else{
                 coord.append(m_currentCellY);
-                cellHandler->getCell(coord)->forceState(m_cellSetter->value());
+                cellHandler->getCell(coord).forceState(m_cellSetter->value());
                 QTableWidget *board = getBoard(m_tabs->currentIndex());
-                int i = 0;
-                int j = 0;
-                for (CellHandler::const_iterator it = cellHandler->begin(); it != cellHandler->end() && it.changedDimension() < 1; ++it){
-                        board->item(i,j)->setBackgroundColor(getColor(it->getState()));
-                        j++;
-                }
+                CellHandler::span_iterator row = cellHandler->spans();
+                const unsigned int *states = row.states();
+                for (unsigned int j = 0; row != cellHandler->end() && j < row.length(); j++)
+                        board->item(0,j)->setBackgroundColor(Palette::color(states[j]));
             }
 
         }
@@ -679,7 +912,15 @@ void MainWindow::handleTabChanged(){
             delete m_timer;
             m_running = !m_running;
         }
+
+        // The automaton of a restored tab is loaded when the tab is first shown
+        bool loaded = !m_pendingTabs.contains(m_tabs->currentWidget());
+        if(!loaded)
+            startLoad(m_tabs->currentWidget());
+        setAutomatonButtonsEnabled(loaded);
     }
+    else
+        setAutomatonButtonsEnabled(true);
 
 }
 
@@ -694,6 +935,8 @@ void MainWindow::setSize(int newCellSize)
         for (int i = 0; i < m_tabs->count(); i++)
         {
             QTableWidget* board = getBoard(i);
+            if (board == nullptr) // Not loaded yet
+                continue;
             if (m_cellSize < 10)
                 board->setShowGrid(false);
             else
@@ -706,3 +949,148 @@ void MainWindow::setSize(int newCellSize)
         }
     }
 }
+
+/** \fn MainWindow::goToGeneration()
+ * \brief Asks a generation number and computes it in another thread
+ *
+ * The intermediate generations are neither displayed nor kept in the history, only the final one is shown.
+ */
+void MainWindow::goToGeneration(){
+    if(AutomateHandler::getAutomateHandler().getNumberAutomates()== 0){
+        QMessageBox msgBox;
+        msgBox.critical(0,"Error","Please create or import an Automaton first !");
+        msgBox.setFixedSize(500,200);
+        return;
+    }
+    if(m_jumpWatcher->isRunning())
+        return;
+
+    Automate* automate = AutomateHandler::getAutomateHandler().getAutomate(m_tabs->currentIndex());
+    int current = automate->getCellHandler().getGeneration();
+    bool ok = false;
+    int target = QInputDialog::getInt(this, tr("Go to generation"), tr("Generation :"), current + 1, current + 1, INT_MAX, 1, &ok);
+    if(!ok)
+        return;
+
+    startJump(target - current, tr("Computing generation %1...").arg(target));
+}
+
+/** \fn MainWindow::startJump()
+ * \brief Computes nbSteps generations of the current automaton in another thread
+ *
+ * The interface is disabled and a progress dialog is shown until the end of the jump.
+ */
+void MainWindow::startJump(unsigned int nbSteps, QString label){
+    if(m_running)
+        handlePlayPause();
+
+    // The automaton must not be used by the interface until the end of the jump
+    Automate* automate = AutomateHandler::getAutomateHandler().getAutomate(m_tabs->currentIndex());
+    m_jumpTab = m_tabs->currentWidget();
+    m_jumpCancelled.store(0);
+    m_jumpDone.store(0);
+    m_toolBar->setEnabled(false);
+    m_tabs->setEnabled(false);
+
+    m_jumpProgress = new QProgressDialog(label, tr("Cancel"), 0, nbSteps, this);
+    m_jumpProgress->setWindowModality(Qt::WindowModal);
+    m_jumpProgress->setMinimumDuration(0);
+    m_jumpProgress->setValue(0);
+    connect(m_jumpProgress, SIGNAL(canceled()), this, SLOT(cancelJump()));
+
+    m_jumpWatcher->setFuture(QtConcurrent::run(automate, &Automate::fastForward, nbSteps,
+                                               (const QAtomicInt*)&m_jumpCancelled, &m_jumpDone));
+    m_jumpTimer->start(100);
+}
+
+/** \fn MainWindow::exportFrames()
+ * \brief Asks a file and a number of generations, and exports them while they are computed in another thread
+ *
+ * The suffix of the file chooses the format, see FrameExporter.
+ */
+void MainWindow::exportFrames(){
+    if(AutomateHandler::getAutomateHandler().getNumberAutomates()== 0){
+        QMessageBox msgBox;
+        msgBox.critical(0,"Error","Please create or import an Automaton first !");
+        msgBox.setFixedSize(500,200);
+        return;
+    }
+    if(m_jumpWatcher->isRunning())
+        return;
+
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export frames"), "",
+                                                    tr("PNG images (*.png);;Raw RGB video (*.rgb)"));
+    if(fileName.isEmpty())
+        return;
+    bool ok = false;
+    int nbSteps = QInputDialog::getInt(this, tr("Export frames"), tr("Number of generations :"), 100, 1, INT_MAX, 1, &ok);
+    if(!ok)
+        return;
+
+    Automate* automate = AutomateHandler::getAutomateHandler().getAutomate(m_tabs->currentIndex());
+    try{
+        m_exporter = new FrameExporter(fileName, automate->getCellHandler().getDimensions());
+        m_exportAutomate = automate;
+        automate->setFrameExporter(m_exporter, 1);
+    }
+    catch (QString &s){
+        stopExport();
+        QMessageBox msgBox;
+        msgBox.warning(0,"Error",s);
+        msgBox.setFixedSize(500,200);
+        return;
+    }
+    startJump(nbSteps, tr("Exporting %1 generations...").arg(nbSteps));
+}
+
+/** \fn MainWindow::stopExport()
+ * \brief Waits for the frames being exported and closes the export
+ *
+ * \return False if a frame couldn't be written
+ */
+bool MainWindow::stopExport(){
+    if(m_exporter == nullptr)
+        return true;
+    m_exportAutomate->setFrameExporter(nullptr, 0);
+    m_exportAutomate = nullptr;
+    bool ok = m_exporter->finish();
+    delete m_exporter;
+    m_exporter = nullptr;
+    return ok;
+}
+
+/** \fn MainWindow::updateJumpProgress()
+ * \brief Shows the number of steps done by the jump
+ */
+void MainWindow::updateJumpProgress(){
+    if(m_jumpProgress != nullptr && !m_jumpProgress->wasCanceled())
+        m_jumpProgress->setValue(m_jumpDone.load());
+}
+
+/** \fn MainWindow::cancelJump()
+ * \brief Stops the jump, the automaton stays at the last computed generation
+ */
+void MainWindow::cancelJump(){
+    m_jumpCancelled.store(1);
+}
+
+/** \fn MainWindow::jumpFinished()
+ * \brief Displays the generation reached by the jump and gives the interface back
+ */
+void MainWindow::jumpFinished(){
+    m_jumpTimer->stop();
+    if(m_jumpProgress != nullptr){
+        m_jumpProgress->deleteLater();
+        m_jumpProgress = nullptr;
+    }
+    m_toolBar->setEnabled(true);
+    m_tabs->setEnabled(true);
+    if(m_tabs->indexOf(m_jumpTab) >= 0)
+        updateBoard(m_tabs->indexOf(m_jumpTab));
+
+    if(!stopExport()){
+        QMessageBox msgBox;
+        msgBox.warning(0,"Error",tr("Some frames couldn't be written"));
+        msgBox.setFixedSize(500,200);
+    }
+}
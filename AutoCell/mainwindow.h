@@ -3,16 +3,26 @@
 
 #include <QMainWindow>
 #include <QtWidgets>
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QAtomicInt>
 #include "cellhandler.h"
 #include "automate.h"
 #include "creationdialog.h"
 #include "automatehandler.h"
+#include "checkpoint.h"
+#include "frameexporter.h"
+#include "palette.h"
 #include "ruleeditor.h"
 
 /** \class MainWindow
  * \brief Simulation window
  *
  * Displays the automaton's current state as a board and contains user interaction components.
+ *
+ * The automata are loaded in another thread: the tabs of the last session are restored with their files only,
+ * and each one is loaded when it is first shown. An opened file is loaded at once, its tab shows a progress bar
+ * and a cancel button until the end of the load.
  */
 
 class MainWindow : public QMainWindow
@@ -33,6 +43,8 @@ class MainWindow : public QMainWindow
     QToolButton *m_saveAutomatonBt;
     QToolButton *m_newAutomatonBt;
     QToolButton *m_resetBt;
+    QToolButton *m_goToBt;
+    QToolButton *m_exportBt;
 
 
     QSpinBox *m_timeStep; ///< Simulation time step duration input
@@ -44,6 +56,40 @@ class MainWindow : public QMainWindow
     bool m_running; ///< If the automaton is running
     QToolBar *m_toolBar; ///< Toolbar containing the buttons
 
+    // Jump to a generation, computed in another thread
+    QFutureWatcher<bool> *m_jumpWatcher; ///< Watch the end of the jump
+    QProgressDialog *m_jumpProgress = nullptr; ///< Progress of the jump, with a cancel button
+    QTimer *m_jumpTimer; ///< Refresh m_jumpProgress during the jump
+    QAtomicInt m_jumpCancelled; ///< Not 0 to stop the jump
+    QAtomicInt m_jumpDone; ///< Number of steps done by the jump
+    QWidget *m_jumpTab = nullptr; ///< Tab of the automaton which jumps, its index can change if a failed load removes a tab
+
+    /** \brief Automaton loaded in another thread
+     */
+    struct LoadResult
+    {
+        Automate *automate = nullptr; ///< Loaded automaton, nullptr if it couldn't be loaded
+        QString error; ///< Why the automaton couldn't be loaded
+    };
+
+    /** \brief Tab whose automaton is not loaded yet
+     *
+     * Its slot in the AutomateHandler is reserved with nullptr and the tab only shows the file until the load ends.
+     */
+    struct PendingTab
+    {
+        QString cellFile; ///< Cell file (.atc) or checkpoint (.atk)
+        QString ruleFile; ///< Rule file, empty for none
+        bool sessionFiles = false; ///< The files were saved by the last session, they are deleted once loaded
+        QFutureWatcher<LoadResult> *watcher = nullptr; ///< Running load, nullptr until the tab is first shown
+    };
+
+    QMap<QWidget*, PendingTab> m_pendingTabs; ///< Tabs whose automaton is not loaded yet
+    QList<QFutureWatcher<LoadResult>*> m_abandonedLoads; ///< Loads of closed tabs, their automaton is deleted when they end
+
+    FrameExporter *m_exporter = nullptr; ///< Export of the generations computed by the jump, nullptr for none
+    Automate *m_exportAutomate = nullptr; ///< Exported automaton
+
     int m_currentCellX;
     int m_currentCellY;
 
@@ -56,17 +102,23 @@ class MainWindow : public QMainWindow
     void createToolBar();
     void createBoard();
     QWidget* createTab();
+    void fillTab(QWidget *tab, int index);
+    QWidget* addPendingTab(QString cellFile, QString ruleFile, bool sessionFiles, QString title);
+    void startLoad(QWidget *tab);
+    void removePendingFiles(const PendingTab &pending);
+    void setAutomatonButtonsEnabled(bool enabled);
+    void openRuleEditor(QWidget *tab);
+    void addAutomatonRules(QWidget *tab, QList<const Rule *> rules);
+    void addAutomatonRuleFile(QWidget *tab, QString path);
+    static LoadResult loadAutomate(QString cellFile, QString ruleFile);
     void createTabs();
 
     void addEmptyRow(unsigned int n);
     void updateBoard(int index);
     void nextState(unsigned int n);
     QTableWidget* getBoard(int n);
-
-    static virtual QColor getColor(int cellState);
-    /** \brief Allow the user to create more colors
-     */
-    static virtual QColor hookMoreColor(int cellState) { return QColor((Qt::GlobalColor)(cellState +2))};
+    void startJump(unsigned int nbSteps, QString label);
+    bool stopExport();
 
 
 public:
@@ -81,9 +133,8 @@ public slots:
     void openCreationWindow();
     void receiveCellHandler(const QVector<unsigned int> dimensions,
                         CellHandler::generationTypes type = CellHandler::generationTypes::empty,
-                        unsigned int stateMax = 1, unsigned int density = 20);
-    void addAutomatonRules(QList<const Rule *> rules);
-    void addAutomatonRuleFile(QString path);
+                        unsigned int stateMax = 1, unsigned int density = 20,
+                        CellHandler::boundaryTypes boundary = CellHandler::boundaryTypes::fixedZero);
     void forward();
     void backward();
     void closeTab(int n);
@@ -94,6 +145,13 @@ public slots:
     void changeCellValue();
     void handleTabChanged();
     void setSize(int newCellSize);
+    void goToGeneration();
+    void updateJumpProgress();
+    void cancelJump();
+    void jumpFinished();
+    void exportFrames();
+    void cancelLoad();
+    void loadFinished();
 
 };
 
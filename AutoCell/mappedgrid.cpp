@@ -0,0 +1,287 @@
+#include <cstring>
+#include <QtConcurrent>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "mappedgrid.h"
+#include "automate.h"
+
+/** \brief Number of cells filled by a task of generate()
+ */
+static const quint64 mappedGenerationTile = 1 << 20;
+
+/** \brief Open or create the files of the grid
+ *
+ * If the file already has the size of the grid, its states are kept as the current generation, so a grid
+ * can be reopened. The file of the next generation is filename + ".next".
+ *
+ * \param filename File of the states
+ * \param dimensions Dimensions of the grid
+ * \param boundary Behaviour of the neighbours out of the grid
+ * \param slabBytes Size of the states of a slab, the memory used by a step is about 4 times this size
+ * \throw QString Not valid dimensions
+ * \throw QString Unusable file
+ */
+MappedGrid::MappedGrid(QString filename, const QVector<unsigned int> &dimensions, CellHandler::boundaryTypes boundary, unsigned int slabBytes) :
+    m_dimensions(dimensions), m_boundary(boundary), m_filename(filename)
+{
+    if (dimensions.isEmpty() || dimensions.contains(0))
+        throw QString(QObject::tr("Not valid dimensions"));
+
+    m_layerSize = 1;
+    for (int i = 0; i < dimensions.size() - 1; i++)
+        m_layerSize *= dimensions.at(i);
+    m_nbLayers = dimensions.last();
+    m_slabLayers = qBound<quint64>(1, slabBytes / (m_layerSize * sizeof(unsigned int)), m_nbLayers);
+
+    const qint64 bytes = getSize() * sizeof(unsigned int);
+    m_files[0].setFileName(filename);
+    m_files[1].setFileName(filename + ".next");
+    for (int i = 0; i < 2; i++)
+    {
+        if (!m_files[i].open(QIODevice::ReadWrite))
+        {
+            qWarning("Couldn't open given file.");
+            throw QString(QObject::tr("Couldn't open given file"));
+        }
+        // A new file is filled with zeros
+        if (m_files[i].size() != bytes && !m_files[i].resize(bytes))
+            throw QString(QObject::tr("Couldn't resize given file"));
+        m_states[i] = (unsigned int*)m_files[i].map(0, bytes);
+        if (m_states[i] == nullptr)
+            throw QString(QObject::tr("Couldn't map given file"));
+#ifdef Q_OS_UNIX
+        posix_madvise(m_states[i], bytes, POSIX_MADV_SEQUENTIAL);
+#endif
+    }
+}
+
+/** \brief Close the files, the file of the grid keeps the current generation
+ */
+MappedGrid::~MappedGrid()
+{
+    clearEngines();
+    for (int i = 0; i < 2; i++)
+    {
+        m_files[i].unmap((uchar*)m_states[i]);
+        m_files[i].close();
+    }
+    if (m_current == 1)
+    {
+        QFile::remove(m_filename);
+        QFile::rename(m_filename + ".next", m_filename);
+    }
+    else
+        QFile::remove(m_filename + ".next");
+}
+
+/** \brief Delete the engines, which depend on the rules
+ */
+void MappedGrid::clearEngines()
+{
+    for (QHash<unsigned int, StepEngine*>::iterator it = m_engines.begin(); it != m_engines.end(); ++it)
+        delete it.value();
+    m_engines.clear();
+}
+
+/** \brief Engine for a slab with its halo, built the first time
+ *
+ * \param nbLayers Number of layers of the slab with its halo
+ */
+StepEngine *MappedGrid::getEngine(unsigned int nbLayers)
+{
+    StepEngine* engine = m_engines.value(nbLayers, nullptr);
+    if (engine == nullptr)
+    {
+        QVector<unsigned int> dimensions = m_dimensions;
+        dimensions.last() = nbLayers;
+        engine = new StepEngine(m_rules, dimensions, m_boundary);
+        m_engines.insert(nbLayers, engine);
+    }
+    return engine;
+}
+
+/** \brief Tell the system if layers of a file will be read soon or not anymore
+ *
+ * \param file Index of the file
+ * \param firstLayer First layer of the range
+ * \param nbLayers Number of layers of the range, it is clipped to the grid
+ * \param willNeed True if the layers will be needed soon, false if they won't be needed anymore
+ */
+void MappedGrid::advise(int file, quint64 firstLayer, quint64 nbLayers, bool willNeed) const
+{
+#ifdef Q_OS_UNIX
+    if (firstLayer >= m_nbLayers || nbLayers == 0)
+        return;
+    nbLayers = qMin(nbLayers, m_nbLayers - firstLayer);
+    static const quintptr page = sysconf(_SC_PAGESIZE);
+    quintptr begin = (quintptr)(m_states[file] + firstLayer * m_layerSize);
+    quintptr end = (quintptr)(m_states[file] + (firstLayer + nbLayers) * m_layerSize);
+    begin -= begin % page;
+    posix_madvise((void*)begin, end - begin, willNeed ? POSIX_MADV_WILLNEED : POSIX_MADV_DONTNEED);
+#else
+    Q_UNUSED(file);
+    Q_UNUSED(firstLayer);
+    Q_UNUSED(nbLayers);
+    Q_UNUSED(willNeed);
+#endif
+}
+
+/** \brief Accessor of m_dimensions
+ */
+QVector<unsigned int> MappedGrid::getDimensions() const
+{
+    return m_dimensions;
+}
+
+/** \brief Number of cells
+ */
+quint64 MappedGrid::getSize() const
+{
+    return m_layerSize * m_nbLayers;
+}
+
+/** \brief Number of the current generation, 0 when the grid is opened or generated
+ */
+unsigned int MappedGrid::getGeneration() const
+{
+    return m_generation;
+}
+
+/** \brief Accessor of m_boundary
+ */
+CellHandler::boundaryTypes MappedGrid::getBoundary() const
+{
+    return m_boundary;
+}
+
+/** \brief Mapped states of the current generation, by linear index
+ */
+const unsigned int *MappedGrid::getStates() const
+{
+    return m_states[m_current];
+}
+
+/** \brief Mapped states of the current generation, by linear index, which can be modified
+ */
+unsigned int *MappedGrid::getStates()
+{
+    return m_states[m_current];
+}
+
+/** \brief Use the rules, the neighbourhood and the random seed of an automate
+ *
+ * \param automate Automate of the same number of dimensions, its cells are not used
+ * \throw QString Block rules are not supported
+ * \throw QString Only the synchronous schedule is supported
+ * \throw QString The automate doesn't have the dimension of the grid
+ */
+void MappedGrid::setRules(const Automate &automate)
+{
+    if (automate.hasBlockRule())
+        throw QString(QObject::tr("Block rules are not supported"));
+    if (automate.getUpdateSchedule() != StepEngine::synchronous)
+        throw QString(QObject::tr("Only the synchronous schedule is supported"));
+    if (automate.getCellHandler().getDimensions().size() != m_dimensions.size())
+        throw QString(QObject::tr("The rules don't have the dimension of the grid"));
+    clearEngines();
+    m_rules = QSharedPointer<const CompiledRules>(new CompiledRules(automate.getRules(), automate.getNeighbourhood(), automate.getLookupTableBudget()));
+    m_randomSeed = automate.getRandomSeed();
+}
+
+/** \brief Replace the states by random values (symetric or not), or by 0
+ *
+ * The states are the ones of CellHandler::generate() for the same dimensions and seed.
+ *
+ * \param type Type of generation
+ * \param stateMax Generate states between 0 and stateMax
+ * \param density Average (%) of non-zeros
+ * \param seed Seed of the random generator
+ */
+void MappedGrid::generate(CellHandler::generationTypes type, unsigned int stateMax, unsigned short density, quint32 seed)
+{
+    const quint64 size = getSize();
+    const unsigned int length = m_dimensions.at(0);
+    unsigned int *states = m_states[m_current];
+
+    QVector<quint64> tiles;
+    for (quint64 start = 0; start < size; start += mappedGenerationTile)
+        tiles.push_back(start);
+    QtConcurrent::blockingMap(tiles, [=](const quint64 &start) {
+        unsigned int count = qMin(mappedGenerationTile, size - start);
+        if (type == CellHandler::empty)
+            memset(states + start, 0, count * sizeof(unsigned int));
+        else
+            CellHandler::generateStates(states + start, start, count, length, type, stateMax, density, seed);
+    });
+    m_generation = 0;
+}
+
+/** \brief Compute the next generation, slab by slab
+ *
+ * Each slab is copied with its halo in m_slabStates: the layers of the halo out of the grid are mapped
+ * by the boundary, except for fixedZero grids where the slab stops at the border of the grid and the
+ * engine handles it. The engine computes the slab and its halo, only the slab is kept.
+ *
+ * \throw QString No rules given
+ */
+void MappedGrid::step()
+{
+    if (m_rules.isNull())
+        throw QString(QObject::tr("No rules given"));
+
+    const unsigned int *states = m_states[m_current];
+    unsigned int *nextStates = m_states[1 - m_current];
+    const int halo = m_rules->getReach();
+    const quint64 layerBytes = m_layerSize * sizeof(unsigned int);
+    const quint64 bufferSize = (m_slabLayers + 2 * halo) * m_layerSize;
+    if ((quint64)m_slabStates.size() < bufferSize)
+    {
+        m_slabStates.resize(bufferSize);
+        m_slabNextStates.resize(bufferSize);
+    }
+
+    for (unsigned int first = 0; first < m_nbLayers; first += m_slabLayers)
+    {
+        const unsigned int last = qMin(first + m_slabLayers, m_nbLayers);
+        int haloFirst = (int)first - halo;
+        int haloLast = (int)last + halo;
+        if (m_boundary == CellHandler::fixedZero)
+        {
+            haloFirst = qMax(haloFirst, 0);
+            haloLast = qMin(haloLast, (int)m_nbLayers);
+        }
+        advise(m_current, haloLast, m_slabLayers, true);
+
+        for (int layer = haloFirst; layer < haloLast; layer++)
+        {
+            quint64 source = CellHandler::mapCoordinate(layer, m_nbLayers, m_boundary);
+            memcpy(m_slabStates.data() + (layer - haloFirst) * m_layerSize, states + source * m_layerSize, layerBytes);
+        }
+        // The draws of the probabilistic rules are keyed on the index of the cell in the whole grid
+        StepEngine* engine = getEngine(haloLast - haloFirst);
+        engine->setRandomStream(m_randomSeed, m_generation, (quint64)((qint64)haloFirst * (qint64)m_layerSize));
+        engine->step(m_slabStates.constData(), m_slabNextStates.data());
+        memcpy(nextStates + first * m_layerSize, m_slabNextStates.constData() + (first - haloFirst) * m_layerSize, (last - first) * layerBytes);
+
+        // The layers before the halo of the next slab are not read again during this step
+        if ((int)last - halo > qMax(haloFirst, 0))
+            advise(m_current, qMax(haloFirst, 0), last - halo - qMax(haloFirst, 0), false);
+        advise(1 - m_current, first, last - first, false);
+    }
+
+    m_current = 1 - m_current;
+    m_generation++;
+}
+
+/** \brief Compute nbSteps generations
+ *
+ * \throw QString No rules given
+ */
+void MappedGrid::run(unsigned int nbSteps)
+{
+    for (unsigned int i = 0; i < nbSteps; i++)
+        step();
+}
@@ -0,0 +1,76 @@
+#ifndef MAPPEDGRID_H
+#define MAPPEDGRID_H
+
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QSharedPointer>
+
+#include "cellhandler.h"
+#include "compiledrules.h"
+#include "stepengine.h"
+
+class Automate;
+
+
+/** \class MappedGrid
+ * \brief Grid of states stored in memory-mapped files, for grids larger than the memory
+ *
+ * The states of the current and of the next generation are two files of 4 bytes per cell, by linear index.
+ * A step walks the grid slab by slab along the last dimension: each slab is copied with its halo of
+ * neighbouring layers in a small buffer, computed by a StepEngine, and its result is written in the other
+ * file. The files are read and written in streaming order, and the system is told so, so that a step
+ * costs about two sequential passes on the disk.
+ *
+ * The rules and the neighbourhood are given by an automate, usually a small one:
+ * \code
+ * MappedGrid grid("big.states", {2000, 2000, 500});
+ * grid.setRules(automate);
+ * grid.generate(CellHandler::random, 1, 20, seed);
+ * grid.run(100);
+ * \endcode
+ */
+class MappedGrid
+{
+private:
+    QVector<unsigned int> m_dimensions; ///< Dimensions of the grid
+    CellHandler::boundaryTypes m_boundary; ///< Behaviour of the neighbours out of the grid
+    quint64 m_layerSize; ///< Number of cells of a layer, all the dimensions but the last one
+    unsigned int m_nbLayers; ///< Length of the last dimension
+    unsigned int m_slabLayers; ///< Number of layers computed at once
+    QString m_filename; ///< File of the current generation when the grid is closed
+    QFile m_files[2]; ///< Files of the states
+    unsigned int *m_states[2]; ///< Mapped states of each file
+    int m_current = 0; ///< Index of the file of the current generation
+    unsigned int m_generation = 0; ///< Number of the current generation
+    QSharedPointer<const CompiledRules> m_rules; ///< Rules to apply
+    quint32 m_randomSeed = 0; ///< Seed of the probabilistic rules
+    QHash<unsigned int, StepEngine*> m_engines; ///< Engine of each number of layers of the slabs with their halo
+    QVector<unsigned int> m_slabStates; ///< Working buffer, states of the current slab and its halo
+    QVector<unsigned int> m_slabNextStates; ///< Working buffer, next states of the current slab and its halo
+
+    void clearEngines();
+    StepEngine *getEngine(unsigned int nbLayers);
+    void advise(int file, quint64 firstLayer, quint64 nbLayers, bool willNeed) const;
+
+public:
+    MappedGrid(QString filename, const QVector<unsigned int> &dimensions,
+               CellHandler::boundaryTypes boundary = CellHandler::fixedZero, unsigned int slabBytes = 64 << 20);
+    MappedGrid(const MappedGrid &g) = delete;
+    MappedGrid & operator=(const MappedGrid &g) = delete;
+    ~MappedGrid();
+
+    QVector<unsigned int> getDimensions() const;
+    quint64 getSize() const;
+    unsigned int getGeneration() const;
+    CellHandler::boundaryTypes getBoundary() const;
+    const unsigned int *getStates() const;
+    unsigned int *getStates();
+
+    void setRules(const Automate &automate);
+    void generate(CellHandler::generationTypes type, unsigned int stateMax, unsigned short density, quint32 seed);
+    void step();
+    void run(unsigned int nbSteps);
+};
+
+#endif // MAPPEDGRID_H
@@ -1,4 +1,5 @@
 #include "matrixrule.h"
+#include "compiledrules.h"
 
 /** \brief Returns a vector fill of the integers between min and max (all included)
  * \return Interval
@@ -40,9 +41,9 @@ bool MatrixRule::matchCell(const Cell *cell) const
     // Rappel : QMap<relativePosition, possibleStates>
     for (QMap<QVector<short>,  QVector<unsigned int> >::const_iterator it = m_matrix.begin() ; it != m_matrix.end(); ++it)
     {
-        if (cell->getNeighbour(it.key()) != nullptr) // Border management
+        if (cell->hasNeighbour(it.key())) // Border management
         {
-            if (! it.value().contains(cell->getNeighbour(it.key())->getState()))
+            if (! it.value().contains(cell->getNeighbour(it.key()).getState()))
             {
                 matched = false;
                 break;
@@ -62,6 +63,20 @@ bool MatrixRule::matchCell(const Cell *cell) const
     return matched;
 }
 
+/** \brief Compile the rule as a list of conditions on the stencil
+ */
+void MatrixRule::compile(CompiledRules &program) const
+{
+    program.addMatrixRule(m_cellOutputState, m_currentCellPossibleValues, m_matrix);
+}
+
+/** \brief Copy of the rule, to be deleted by the caller
+ */
+MatrixRule *MatrixRule::clone() const
+{
+    return new MatrixRule(*this);
+}
+
 /** \brief Add a possible state to a relative position
  */
 void MatrixRule::addNeighbourState(QVector<short> relativePosition, unsigned int matchState)
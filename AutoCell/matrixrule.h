@@ -17,6 +17,8 @@ class MatrixRule : public Rule
 
 
         virtual bool matchCell(const Cell* cell) const;
+        virtual void compile(CompiledRules &program) const;
+        virtual MatrixRule* clone() const;
         virtual void addNeighbourState(QVector<short> relativePosition, unsigned int matchState);
         virtual void addNeighbourState(QVector<short> relativePosition, QVector<unsigned int> matchStates);
 
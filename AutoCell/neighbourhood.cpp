@@ -0,0 +1,417 @@
+#include <climits>
+
+#include "neighbourhood.h"
+
+/** \brief Greatest number of positions of the square (cube...) of side 2*radius+1 of a neighbourhood
+ *
+ * It also keeps the offsets within a short: the radius is at most 32767.
+ */
+static const quint64 neighbourhoodMaxPositions = 1 << 16;
+
+/** \brief Construct a neighbourhood of the given shape
+ *
+ * The relative positions are listed in the order of the cells in a CellHandler
+ * (first dimension is the fastest varying).
+ *
+ * \param dimensions Number of dimensions of the grid
+ * \param type Shape of the neighbourhood, custom is not allowed here
+ * \param radius Radius of the shape, ignored by hexagonal neighbourhoods
+ * \throw QString Not valid neighbourhood
+ * \throw QString The radius is too large for the dimensions
+ */
+Neighbourhood::Neighbourhood(unsigned int dimensions, neighbourhoodTypes type, unsigned int radius):
+    m_type(type), m_radius(radius), m_dimensions(dimensions)
+{
+    if (type == custom)
+        throw QString(QObject::tr("A custom neighbourhood needs a list of offsets"));
+    if (type == hexagonal)
+    {
+        if (dimensions != 2)
+            throw QString(QObject::tr("Hexagonal neighbourhoods need 2 dimensions"));
+        m_radius = 1;
+    }
+    if (m_radius == 0)
+        throw QString(QObject::tr("The radius of a neighbourhood can't be 0"));
+
+    // Count in base 2r+1 on each component: digit k <=> k - r
+    quint64 nbPositions = 1;
+    for (unsigned int i = 0; i < m_dimensions; i++)
+    {
+        nbPositions *= 2 * (quint64)m_radius + 1;
+        if (nbPositions > neighbourhoodMaxPositions)
+            throw QString(QObject::tr("The radius of the neighbourhood is too large"));
+    }
+    unsigned int width = 2 * m_radius + 1;
+
+    for (unsigned int n = 0; n < nbPositions; n++)
+    {
+        QVector<short> relativePosition(m_dimensions);
+        unsigned int digits = n;
+        unsigned int norm1 = 0;
+        for (unsigned int i = 0; i < m_dimensions; i++)
+        {
+            relativePosition[i] = (short)(digits % width) - (short)m_radius;
+            digits /= width;
+            norm1 += qAbs(relativePosition.at(i));
+        }
+        if (norm1 == 0) // The cell itself
+            continue;
+        if (m_type == vonNeumann && norm1 > m_radius)
+            continue;
+        if (m_type == hexagonal && relativePosition.at(0) == relativePosition.at(1)) // (-1,-1) and (1,1)
+            continue;
+        m_offsets.push_back(relativePosition);
+    }
+}
+
+/** \brief Construct a custom neighbourhood from its relative positions
+ *
+ * \throw QString Not valid neighbourhood
+ */
+Neighbourhood::Neighbourhood(const QVector<QVector<short> > offsets):
+    m_type(custom), m_radius(0), m_dimensions(0)
+{
+    if (offsets.isEmpty())
+        throw QString(QObject::tr("A custom neighbourhood needs a list of offsets"));
+    m_dimensions = offsets.first().size();
+    for (int n = 0; n < offsets.size(); n++)
+    {
+        if ((unsigned int)offsets.at(n).size() != m_dimensions)
+            throw QString(QObject::tr("Offsets of a neighbourhood must have the same size"));
+        if (offsets.at(n).count(0) == offsets.at(n).size() || m_offsets.contains(offsets.at(n)))
+            continue;
+        m_offsets.push_back(offsets.at(n));
+    }
+    m_radius = getReach();
+}
+
+/** \brief Create a neighbourhood from its json description
+ *
+ * \param json Json object which contains the description, see Neighbourhood
+ * \param dimensions Number of dimensions of the grid
+ * \throw QString Not valid neighbourhood
+ */
+Neighbourhood Neighbourhood::fromJson(const QJsonObject &json, unsigned int dimensions)
+{
+    if (!json.contains("type") || !json["type"].isString())
+        throw QString(QObject::tr("The neighbourhood needs a type"));
+
+    unsigned int radius = 1;
+    if (json.contains("radius"))
+    {
+        if (!json["radius"].isDouble() || json["radius"].toDouble() < 1 || json["radius"].toDouble() > SHRT_MAX)
+            throw QString(QObject::tr("Not valid neighbourhood radius"));
+        radius = json["radius"].toInt();
+    }
+
+    QString type = json["type"].toString();
+    if (!type.compare("moore", Qt::CaseInsensitive))
+        return Neighbourhood(dimensions, moore, radius);
+    if (!type.compare("vonNeumann", Qt::CaseInsensitive))
+        return Neighbourhood(dimensions, vonNeumann, radius);
+    if (!type.compare("hexagonal", Qt::CaseInsensitive))
+        return Neighbourhood(dimensions, hexagonal);
+    if (!type.compare("custom", Qt::CaseInsensitive))
+    {
+        if (!json.contains("offsets") || !json["offsets"].isArray())
+            throw QString(QObject::tr("A custom neighbourhood needs a list of offsets"));
+        QVector<QVector<short> > offsets;
+        QJsonArray offsetsJson = json["offsets"].toArray();
+        for (int n = 0; n < offsetsJson.size(); n++)
+        {
+            if (!offsetsJson.at(n).isArray())
+                throw QString(QObject::tr("Not valid neighbourhood offset"));
+            QJsonArray positionJson = offsetsJson.at(n).toArray();
+            if ((unsigned int)positionJson.size() != dimensions)
+                throw QString(QObject::tr("Not valid neighbourhood offset"));
+            QVector<short> relativePosition;
+            for (int i = 0; i < positionJson.size(); i++)
+            {
+                if (!positionJson.at(i).isDouble() || qAbs(positionJson.at(i).toDouble()) > SHRT_MAX)
+                    throw QString(QObject::tr("Not valid neighbourhood offset"));
+                relativePosition.push_back(positionJson.at(i).toInt());
+            }
+            offsets.push_back(relativePosition);
+        }
+        return Neighbourhood(offsets);
+    }
+    throw QString(QObject::tr("Unknown neighbourhood type"));
+}
+
+/** \brief Return a QJsonObject to save the neighbourhood
+ */
+QJsonObject Neighbourhood::toJson() const
+{
+    QJsonObject object;
+    switch (m_type)
+    {
+    case moore:
+        object.insert("type", QJsonValue("moore"));
+        object.insert("radius", QJsonValue((int)m_radius));
+        break;
+    case vonNeumann:
+        object.insert("type", QJsonValue("vonNeumann"));
+        object.insert("radius", QJsonValue((int)m_radius));
+        break;
+    case hexagonal:
+        object.insert("type", QJsonValue("hexagonal"));
+        break;
+    case custom:
+    {
+        object.insert("type", QJsonValue("custom"));
+        QJsonArray offsets;
+        for (int n = 0; n < m_offsets.size(); n++)
+        {
+            QJsonArray relativePosition;
+            for (int i = 0; i < m_offsets.at(n).size(); i++)
+                relativePosition.append(QJsonValue((int)m_offsets.at(n).at(i)));
+            offsets.append(relativePosition);
+        }
+        object.insert("offsets", offsets);
+        break;
+    }
+    }
+    return object;
+}
+
+/** \brief Accessor of m_type
+ */
+Neighbourhood::neighbourhoodTypes Neighbourhood::getType() const
+{
+    return m_type;
+}
+
+/** \brief Accessor of m_radius
+ */
+unsigned int Neighbourhood::getRadius() const
+{
+    return m_radius;
+}
+
+/** \brief Accessor of m_dimensions
+ */
+unsigned int Neighbourhood::getDimensions() const
+{
+    return m_dimensions;
+}
+
+/** \brief Greatest distance (infinity norm) between a cell and its neighbours
+ */
+unsigned int Neighbourhood::getReach() const
+{
+    unsigned int reach = 0;
+    for (int n = 0; n < m_offsets.size(); n++)
+        for (int i = 0; i < m_offsets.at(n).size(); i++)
+            reach = qMax(reach, (unsigned int)qAbs(m_offsets.at(n).at(i)));
+    return reach;
+}
+
+/** \brief Number of neighbours
+ */
+int Neighbourhood::size() const
+{
+    return m_offsets.size();
+}
+
+/** \brief Relative positions of the neighbours
+ */
+const QVector<QVector<short> > &Neighbourhood::getOffsets() const
+{
+    return m_offsets;
+}
+
+/** \brief Index of the relative position in the stencil, -1 if it is not a neighbour
+ */
+int Neighbourhood::indexOf(const QVector<short> &relativePosition) const
+{
+    return m_offsets.indexOf(relativePosition);
+}
+
+/** \brief True for the Moore neighbourhood of radius 1, used when nothing is specified
+ */
+bool Neighbourhood::isDefault() const
+{
+    return m_type == moore && m_radius == 1;
+}
+
+/** \brief Count, for each cell, the neighbours whose indicator is set
+ *
+ * The grid is surrounded by a halo of ghost cells whose indicators are already set according
+ * to the boundary mode, so the kernels don't have to check the borders. Each shape has its own kernel.
+ *
+ * \param dimensions Dimensions of the padded grid (grid + 2*halo), must have getDimensions() components
+ * \param halo Width of the halo, at least getReach()
+ * \param indicator 1 for each padded cell which has to be counted, 0 otherwise
+ * \param counts Output, number of counted neighbours of each padded cell, only valid out of the halo
+ * \param buffer Working buffer of the size of the padded grid, only used by the Moore kernel: the caller keeps it
+ * between the steps so it is not allocated at each count
+ */
+void Neighbourhood::countNeighbours(const QVector<unsigned int> &dimensions, unsigned int halo, const unsigned char *indicator, unsigned int *counts,
+                                    unsigned int *buffer) const
+{
+    for (int i = 0; i < dimensions.size(); i++)
+        if (dimensions.at(i) <= 2 * halo)
+            return;
+
+    switch (m_type)
+    {
+    case moore:
+        countMoore(dimensions, indicator, counts, buffer);
+        break;
+    case hexagonal:
+        countHexagonal(dimensions, halo, indicator, counts);
+        break;
+    default:
+        countOffsets(dimensions, halo, indicator, counts);
+        break;
+    }
+}
+
+/** \brief Moore kernel: the box sum is separable, so it is computed with a sliding window along each dimension
+ *
+ * The complexity is in O(n*d) instead of O(n*(2r+1)^d). Along each dimension, only the windows
+ * which don't cross the padded borders are computed, the other values are never read.
+ */
+void Neighbourhood::countMoore(const QVector<unsigned int> &dimensions, const unsigned char *indicator, unsigned int *counts, unsigned int *buffer) const
+{
+    unsigned int size = 1;
+    for (int i = 0; i < dimensions.size(); i++)
+        size *= dimensions.at(i);
+
+    QVector<unsigned int> window;
+    unsigned int *source = buffer;
+    unsigned int *target = counts;
+    for (unsigned int j = 0; j < size; j++)
+        source[j] = indicator[j];
+
+    int r = m_radius;
+    unsigned int stride = 1;
+    for (int k = 0; k < dimensions.size(); k++)
+    {
+        int length = dimensions.at(k);
+        unsigned int block = stride * length;
+        if (k == 0)
+        {
+            // Contiguous lines: scalar sliding window
+            for (unsigned int start = 0; start < size; start += block)
+            {
+                const unsigned int *in = source + start;
+                unsigned int *out = target + start;
+                unsigned int sum = 0;
+                for (int x = 0; x < 2 * r; x++)
+                    sum += in[x];
+                for (int x = r; x < length - r; x++)
+                {
+                    sum += in[x + r];
+                    out[x] = sum;
+                    sum -= in[x - r];
+                }
+            }
+        }
+        else
+        {
+            // Lines along dimension k are strided: slide a whole row of the lower dimensions at once
+            window.resize(stride);
+            unsigned int *sum = window.data();
+            for (unsigned int start = 0; start < size; start += block)
+            {
+                const unsigned int *in = source + start;
+                unsigned int *out = target + start;
+                for (unsigned int j = 0; j < stride; j++)
+                    sum[j] = 0;
+                for (int x = 0; x < 2 * r; x++)
+                    for (unsigned int j = 0; j < stride; j++)
+                        sum[j] += in[x * stride + j];
+                for (int x = r; x < length - r; x++)
+                {
+                    const unsigned int *added = in + (x + r) * stride;
+                    const unsigned int *removed = in + (x - r) * stride;
+                    unsigned int *row = out + x * stride;
+                    for (unsigned int j = 0; j < stride; j++)
+                    {
+                        sum[j] += added[j];
+                        row[j] = sum[j];
+                        sum[j] -= removed[j];
+                    }
+                }
+            }
+        }
+        qSwap(source, target);
+        stride = block;
+    }
+
+    // The cell itself is not a neighbour
+    for (unsigned int j = 0; j < size; j++)
+        counts[j] = source[j] - indicator[j];
+}
+
+/** \brief Hexagonal kernel, unrolled on the 6 neighbours
+ */
+void Neighbourhood::countHexagonal(const QVector<unsigned int> &dimensions, unsigned int halo, const unsigned char *indicator, unsigned int *counts) const
+{
+    int width = dimensions.at(0);
+    int height = dimensions.at(1);
+    int h = halo;
+    for (int y = h; y < height - h; y++)
+    {
+        const unsigned char *row = indicator + y * width;
+        const unsigned char *up = row - width;
+        const unsigned char *down = row + width;
+        unsigned int *out = counts + y * width;
+        for (int x = h; x < width - h; x++)
+            out[x] = row[x - 1] + row[x + 1] + up[x] + up[x + 1] + down[x] + down[x - 1];
+    }
+}
+
+/** \brief Generic kernel: the shifted indicator rows are added for each offset
+ */
+void Neighbourhood::countOffsets(const QVector<unsigned int> &dimensions, unsigned int halo, const unsigned char *indicator, unsigned int *counts) const
+{
+    int d = dimensions.size();
+    int h = halo;
+    QVector<int> strides(d + 1);
+    strides[0] = 1;
+    for (int i = 0; i < d; i++)
+        strides[i+1] = strides.at(i) * dimensions.at(i);
+
+    QVector<int> linearOffsets;
+    for (int n = 0; n < m_offsets.size(); n++)
+    {
+        int linearOffset = 0;
+        for (int i = 0; i < d; i++)
+            linearOffset += m_offsets.at(n).at(i) * strides.at(i);
+        linearOffsets.push_back(linearOffset);
+    }
+
+    int width = dimensions.at(0);
+    QVector<int> position(d, h);
+    bool finished = false;
+    while (!finished)
+    {
+        int rowStart = 0;
+        for (int i = 1; i < d; i++)
+            rowStart += position.at(i) * strides.at(i);
+        unsigned int *out = counts + rowStart;
+        for (int x = h; x < width - h; x++)
+            out[x] = 0;
+        for (int n = 0; n < linearOffsets.size(); n++)
+        {
+            const unsigned char *in = indicator + rowStart + linearOffsets.at(n);
+            for (int x = h; x < width - h; x++)
+                out[x] += in[x];
+        }
+
+        // Next row out of the halo
+        finished = true;
+        for (int i = 1; i < d; i++)
+        {
+            position[i]++;
+            if (position.at(i) < (int)dimensions.at(i) - h)
+            {
+                finished = false;
+                break;
+            }
+            position[i] = h;
+        }
+    }
+}
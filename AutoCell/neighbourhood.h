@@ -0,0 +1,64 @@
+#ifndef NEIGHBOURHOOD_H
+#define NEIGHBOURHOOD_H
+
+#include <QVector>
+#include <QString>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QObject>
+
+/** \class Neighbourhood
+ * \brief Shape of the neighbourhood of a cell, compiled into a fixed list of relative positions (stencil)
+ *
+ * Typical json description, in the "neighbourhood" field of a .atr file:
+ * \code
+ * {"type": "moore", "radius": 1}
+ * {"type": "vonNeumann", "radius": 2}
+ * {"type": "hexagonal"}
+ * {"type": "custom", "offsets": [[-1,0], [1,0], [0,2]]}
+ * \endcode
+ * Hexagonal grids use axial coordinates: the 6 neighbours of (x1,x2) are (x1±1,x2), (x1,x2±1),
+ * (x1+1,x2-1) and (x1-1,x2+1).
+ */
+class Neighbourhood
+{
+public:
+    /** \brief Shapes of neighbourhood
+     */
+    enum neighbourhoodTypes {
+        moore, ///< All cells at a distance (infinity norm) lower than the radius
+        vonNeumann, ///< All cells at a distance (norm 1) lower than the radius
+        hexagonal, ///< Hexagonal grid in axial coordinates, 2 dimensions only
+        custom ///< Explicit list of relative positions
+    };
+
+    Neighbourhood(unsigned int dimensions = 1, neighbourhoodTypes type = moore, unsigned int radius = 1);
+    Neighbourhood(const QVector<QVector<short> > offsets);
+
+    static Neighbourhood fromJson(const QJsonObject &json, unsigned int dimensions);
+    QJsonObject toJson() const;
+
+    neighbourhoodTypes getType() const;
+    unsigned int getRadius() const;
+    unsigned int getDimensions() const;
+    unsigned int getReach() const;
+    int size() const;
+    const QVector<QVector<short> > &getOffsets() const;
+    int indexOf(const QVector<short> &relativePosition) const;
+    bool isDefault() const;
+
+    void countNeighbours(const QVector<unsigned int> &dimensions, unsigned int halo, const unsigned char *indicator, unsigned int *counts,
+                         unsigned int *buffer) const;
+
+private:
+    void countMoore(const QVector<unsigned int> &dimensions, const unsigned char *indicator, unsigned int *counts, unsigned int *buffer) const;
+    void countHexagonal(const QVector<unsigned int> &dimensions, unsigned int halo, const unsigned char *indicator, unsigned int *counts) const;
+    void countOffsets(const QVector<unsigned int> &dimensions, unsigned int halo, const unsigned char *indicator, unsigned int *counts) const;
+
+    neighbourhoodTypes m_type; ///< Shape of the neighbourhood
+    unsigned int m_radius; ///< Radius of the shape, not used by custom neighbourhoods
+    unsigned int m_dimensions; ///< Number of dimensions of the grid
+    QVector<QVector<short> > m_offsets; ///< Relative positions of the neighbours, without the cell itself
+};
+
+#endif // NEIGHBOURHOOD_H
@@ -1,4 +1,5 @@
 #include "neighbourrule.h"
+#include "compiledrules.h"
 
 /** \page page_1 Game of life
  *
@@ -141,6 +142,20 @@ bool NeighbourRule::matchCell(const Cell *c)const
 
 }
 
+/** \brief Compile the rule as an interval on a neighbour counter
+ */
+void NeighbourRule::compile(CompiledRules &program) const
+{
+    program.addNeighbourRule(m_cellOutputState, m_currentCellPossibleValues, m_neighbourInterval, m_neighbourPossibleValues);
+}
+
+/** \brief Copy of the rule, to be deleted by the caller
+ */
+NeighbourRule *NeighbourRule::clone() const
+{
+    return new NeighbourRule(*this);
+}
+
 /** \brief Return a QJsonObject to save the rule
  */
 QJsonObject NeighbourRule::toJson() const
@@ -0,0 +1,79 @@
+#include <cmath>
+#include <QVector>
+
+#include "palette.h"
+
+/** \brief Color of each state
+ */
+static const QRgb paletteColors[] = {
+    qRgb(255, 255, 255), // white
+    qRgb(0, 0, 0), // black
+    qRgb(255, 0, 0), // red
+    qRgb(0, 255, 0), // green
+    qRgb(0, 0, 255), // blue
+    qRgb(255, 255, 0), // yellow
+    qRgb(170, 110, 40), // brown
+    qRgb(145, 30, 180), // purple
+    qRgb(245, 130, 48), // orange
+    qRgb(0, 255, 255), // cyan
+    qRgb(255, 0, 255), // magenta
+    qRgb(210, 245, 60), // lime
+    qRgb(250, 190, 190), // pink
+    qRgb(0, 128, 128), // teal
+    qRgb(230, 190, 255), // lavender
+    qRgb(255, 250, 200), // beige
+    qRgb(128, 0, 0), // maroon
+    qRgb(170, 255, 195), // mint
+    qRgb(128, 128, 0), // olive
+    qRgb(255, 215, 180), // coral
+    qRgb(0, 0, 128), // navy
+    qRgb(160, 160, 164) // gray
+};
+
+/** \brief Number of states with their own color
+ */
+int Palette::getNbColors()
+{
+    return sizeof(paletteColors) / sizeof(QRgb);
+}
+
+/** \brief Number of states whose color is kept in the table of generated colors
+ */
+static const unsigned int paletteTableSize = 1 << 16;
+
+/** \brief Color of a state, named or generated, as a QRgb value
+ */
+QRgb Palette::rgb(unsigned int state)
+{
+    if (state < (unsigned int)getNbColors())
+        return paletteColors[state];
+    if (state >= paletteTableSize)
+        return generatedRgb(state);
+
+    static const QVector<QRgb> table = [] {
+        QVector<QRgb> colors(paletteTableSize);
+        for (unsigned int s = 0; s < paletteTableSize; s++)
+            colors[s] = generatedRgb(s);
+        return colors;
+    }();
+    return table.at(state);
+}
+
+/** \brief Generated color of a state: golden angle hue, saturation and value cycling every 360 states
+ */
+QRgb Palette::generatedRgb(unsigned int state)
+{
+    const double goldenAngle = 137.50776405003785;
+    double hue = std::fmod(state * goldenAngle, 360.0) / 360.0;
+    unsigned int cycle = state / 360;
+    double saturation = 0.9 - 0.15 * (cycle % 3);
+    double value = 0.95 - 0.2 * ((cycle / 3) % 3);
+    return QColor::fromHsvF(hue, saturation, value).rgb();
+}
+
+/** \brief Color of a state
+ */
+QColor Palette::color(unsigned int state)
+{
+    return QColor(rgb(state));
+}
@@ -0,0 +1,26 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <QColor>
+
+
+/** \class Palette
+ * \brief Colors of the states, shared by the board and the exported frames
+ *
+ * The first getNbColors() states have a named color. The other ones get a generated color: the hue turns by
+ * the golden angle from a state to the next one, so close states never look alike, and the saturation and the
+ * value cycle slowly to tell apart the states whose hues are close. The generated colors of the states which
+ * fit in 2 bytes are computed once in a table.
+ */
+class Palette
+{
+public:
+    static int getNbColors();
+    static QRgb rgb(unsigned int state);
+    static QColor color(unsigned int state);
+
+private:
+    static QRgb generatedRgb(unsigned int state);
+};
+
+#endif // PALETTE_H
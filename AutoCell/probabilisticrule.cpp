@@ -0,0 +1,48 @@
+#include "probabilisticrule.h"
+#include "compiledrules.h"
+
+/** \brief Constructs a probabilistic rule with the parameters
+ *
+ * \param outputState Next state if the rule is applied
+ * \param currentCellValues Possible states of the cell
+ * \param intervalNbrNeighbour Bounds (included) of the number of counted neighbours
+ * \param probability Probability to apply the rule on a matching cell, or per counted neighbour
+ * \param perNeighbour True if the probability is given per counted neighbour
+ * \param neighbourValues Counted states, nothing means all states except 0
+ * \throw QString Not valid interval
+ * \throw QString Not valid probability
+ */
+ProbabilisticRule::ProbabilisticRule(unsigned int outputState, QVector<unsigned int> currentCellValues, QPair<unsigned int, unsigned int> intervalNbrNeighbour,
+                                     double probability, bool perNeighbour, QSet<unsigned int> neighbourValues) :
+    NeighbourRule(outputState, currentCellValues, intervalNbrNeighbour, neighbourValues), m_probability(probability), m_perNeighbour(perNeighbour)
+{
+    if (!(probability >= 0 && probability <= 1))
+        throw QString(QObject::tr("The probability must be between 0 and 1"));
+}
+
+/** \brief Compile the rule as an interval on a neighbour counter with a probability for each count
+ */
+void ProbabilisticRule::compile(CompiledRules &program) const
+{
+    program.addProbabilisticRule(m_cellOutputState, m_currentCellPossibleValues, m_neighbourInterval, m_neighbourPossibleValues, m_probability, m_perNeighbour);
+}
+
+/** \brief Copy of the rule, to be deleted by the caller
+ */
+ProbabilisticRule *ProbabilisticRule::clone() const
+{
+    return new ProbabilisticRule(*this);
+}
+
+/** \brief Return a QJsonObject to save the rule
+ */
+QJsonObject ProbabilisticRule::toJson() const
+{
+    QJsonObject object(NeighbourRule::toJson());
+
+    object.insert("type", QJsonValue("probabilistic"));
+    object.insert("probability", QJsonValue(m_probability));
+    object.insert("perNeighbour", QJsonValue(m_perNeighbour));
+
+    return object;
+}
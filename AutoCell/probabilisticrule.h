@@ -0,0 +1,36 @@
+#ifndef PROBABILISTICRULE_H
+#define PROBABILISTICRULE_H
+
+#include "neighbourrule.h"
+
+/** \class ProbabilisticRule
+ * \brief NeighbourRule which is only applied with a probability
+ *
+ * The cell must match the condition of a NeighbourRule, then a random draw decides if the rule is applied.
+ * The probability is either the same for every matching cell, or given per counted neighbour: with
+ * perNeighbour and k counted neighbours, the rule is applied with the probability 1 - (1 - p)^k, as if each
+ * neighbour tried independently. For example a tree (1) which ignites (2) with p = 0.3 per burning neighbour:
+ * \code
+ * {"type": "probabilistic", "currentStates": [1], "finalState": 2, "neighbourStates": [2],
+ *  "neighbourNumberMin": 1, "neighbourNumberMax": 8, "probability": 0.3, "perNeighbour": true}
+ * \endcode
+ *
+ * The draws come from a CounterRandom keyed on the seed of the automate, the generation and the index of the
+ * cell, see StepEngine::setRandomStream(), so a run is reproducible whatever the number of threads or workers.
+ * matchCell() only tests the condition, the draw needs the engine.
+ */
+class ProbabilisticRule : public NeighbourRule
+{
+protected:
+    double m_probability; ///< Probability to apply the rule on a matching cell, or per counted neighbour
+    bool m_perNeighbour; ///< True if m_probability is given per counted neighbour
+public:
+    ProbabilisticRule(unsigned int outputState, QVector<unsigned int> currentCellValues, QPair<unsigned int, unsigned int> intervalNbrNeighbour,
+                      double probability, bool perNeighbour = false, QSet<unsigned int> neighbourValues = QSet<unsigned int>());
+    void compile(CompiledRules &program) const;
+    ProbabilisticRule* clone() const;
+
+    QJsonObject toJson() const;
+};
+
+#endif // PROBABILISTICRULE_H
@@ -6,6 +6,7 @@
 #include <QJsonArray>
 #include "cell.h"
 
+class CompiledRules;
 
 /** \class Rule
  * \brief
@@ -30,6 +31,15 @@ public:
      * \param c Cell to test
      */
     virtual bool matchCell(const Cell * c)const = 0;
+    /** \brief Add the flat version of the rule to the compiled rules
+     *
+     * Used by the Automate to evaluate the rules on a stencil, without Cell objects.
+     * \param program Compiled rules to complete
+     */
+    virtual void compile(CompiledRules &program) const = 0;
+    /** \brief Copy of the rule, to be deleted by the caller
+     */
+    virtual Rule* clone() const = 0;
     unsigned int getCellOutputState() const;
 
 };
@@ -0,0 +1,412 @@
+#include <cstring>
+#include <algorithm>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QFile>
+
+#include "slabcluster.h"
+#include "automate.h"
+
+/** \brief Maximum size of the states requested at once to the workers by writeStates()
+ */
+static const quint64 slabChunkBytes = 64 << 20;
+
+/** \brief Start the workers and wait for their connection
+ *
+ * \param dimensions Dimensions of the grid
+ * \param nbWorkers Number of worker processes, at most one by layer of the last dimension
+ * \param boundary Behaviour of the neighbours out of the grid
+ * \param program Program of the workers, this program by default
+ * \throw QString Not valid dimensions
+ * \throw QString A worker couldn't be started
+ */
+SlabCluster::SlabCluster(const QVector<unsigned int> &dimensions, unsigned int nbWorkers, CellHandler::boundaryTypes boundary, QString program) :
+    m_dimensions(dimensions), m_boundary(boundary)
+{
+    if (dimensions.isEmpty() || dimensions.contains(0))
+        throw QString(QObject::tr("Not valid dimensions"));
+
+    m_layerSize = 1;
+    for (int i = 0; i < dimensions.size() - 1; i++)
+        m_layerSize *= dimensions.at(i);
+    m_nbLayers = dimensions.last();
+    nbWorkers = qBound(1u, nbWorkers, m_nbLayers);
+    for (unsigned int i = 0; i <= nbWorkers; i++)
+        m_firstLayers.push_back((quint64)i * m_nbLayers / nbWorkers);
+
+    QString serverName = QString("autocell-slabs-%1-%2").arg(QCoreApplication::applicationPid()).arg((quintptr)this);
+    QLocalServer::removeServer(serverName);
+    if (!m_server.listen(serverName))
+        throw QString(QObject::tr("Couldn't start the coordinator: %1").arg(m_server.errorString()));
+    if (program.isEmpty())
+        program = QCoreApplication::applicationFilePath();
+
+    try
+    {
+        m_sockets.fill(nullptr, nbWorkers);
+        for (unsigned int i = 0; i < nbWorkers; i++)
+        {
+            QProcess* process = new QProcess;
+            process->setProcessChannelMode(QProcess::ForwardedChannels);
+            m_processes.push_back(process);
+            process->start(program, QStringList() << "--slab-worker" << m_server.fullServerName() << QString::number(i));
+        }
+        for (unsigned int i = 0; i < nbWorkers; i++)
+        {
+            if (!m_server.waitForNewConnection(30000))
+                throw QString(QObject::tr("A worker couldn't be started"));
+            QLocalSocket* socket = m_server.nextPendingConnection();
+            SlabWorker::messageTypes type;
+            QDataStream message(SlabWorker::receive(*socket, type));
+            unsigned int index = nbWorkers;
+            message >> index;
+            if (type != SlabWorker::hello || index >= nbWorkers || m_sockets.at(index) != nullptr)
+            {
+                delete socket;
+                throw QString(QObject::tr("A worker couldn't be started"));
+            }
+            m_sockets[index] = socket;
+        }
+    }
+    catch (QString &)
+    {
+        shutdown();
+        throw;
+    }
+}
+
+SlabCluster::~SlabCluster()
+{
+    shutdown();
+}
+
+/** \brief Ask the workers to quit, kill the ones which don't
+ */
+void SlabCluster::shutdown()
+{
+    for (int i = 0; i < m_sockets.size(); i++)
+    {
+        if (m_sockets.at(i) == nullptr)
+            continue;
+        try
+        {
+            SlabWorker::send(*m_sockets.at(i), SlabWorker::quit);
+        }
+        catch (QString &)
+        {
+            // The worker is already gone
+        }
+    }
+    for (int i = 0; i < m_processes.size(); i++)
+    {
+        if (!m_processes.at(i)->waitForFinished(5000))
+        {
+            m_processes.at(i)->kill();
+            m_processes.at(i)->waitForFinished();
+        }
+        delete m_processes.at(i);
+    }
+    for (int i = 0; i < m_sockets.size(); i++)
+        delete m_sockets.at(i);
+    m_processes.clear();
+    m_sockets.clear();
+    m_server.close();
+}
+
+/** \brief Index of the worker owning a layer
+ */
+unsigned int SlabCluster::getOwner(unsigned int layer) const
+{
+    return std::upper_bound(m_firstLayers.cbegin(), m_firstLayers.cend(), layer) - m_firstLayers.cbegin() - 1;
+}
+
+/** \brief Send the same message to every worker
+ *
+ * \throw QString Lost connection
+ */
+void SlabCluster::sendAll(SlabWorker::messageTypes type, const QByteArray &payload)
+{
+    for (int i = 0; i < m_sockets.size(); i++)
+        SlabWorker::send(*m_sockets.at(i), type, payload);
+}
+
+/** \brief Wait for the answer of a worker
+ *
+ * \param worker Index of the worker
+ * \param type Type of the expected answer
+ * \throw QString Lost connection
+ * \throw QString Not valid answer
+ */
+QByteArray SlabCluster::receiveFrom(int worker, SlabWorker::messageTypes type)
+{
+    SlabWorker::messageTypes answerType;
+    QByteArray payload = SlabWorker::receive(*m_sockets.at(worker), answerType);
+    if (answerType != type)
+        throw QString(QObject::tr("Not valid answer of a worker"));
+    return payload;
+}
+
+/** \brief Wait for the results of every worker, see SlabWorker::writeResult()
+ *
+ * The population and the hash are the sums of the ones of the slabs, the exported layers are kept for
+ * the next step.
+ *
+ * \throw QString Lost connection
+ * \throw QString Not valid answer
+ */
+void SlabCluster::collectResults(SlabWorker::messageTypes type)
+{
+    m_population.clear();
+    m_hash = 0;
+    for (int i = 0; i < m_sockets.size(); i++)
+    {
+        QDataStream answer(receiveFrom(i, type));
+        QVector<quint64> population;
+        quint64 hash = 0;
+        quint32 nbLayers = 0;
+        answer >> population >> hash >> nbLayers;
+        if (population.size() > m_population.size())
+            m_population.resize(population.size());
+        for (int state = 0; state < population.size(); state++)
+            m_population[state] += population.at(state);
+        m_hash += hash;
+
+        for (quint32 j = 0; j < nbLayers; j++)
+        {
+            unsigned int layer = 0;
+            QByteArray states(m_layerSize * sizeof(unsigned int), 0);
+            answer >> layer;
+            answer.readRawData(states.data(), states.size());
+            m_borders.insert(layer, states);
+        }
+        if (answer.status() != QDataStream::Ok)
+            throw QString(QObject::tr("Not valid answer of a worker"));
+    }
+}
+
+/** \brief Accessor of m_dimensions
+ */
+QVector<unsigned int> SlabCluster::getDimensions() const
+{
+    return m_dimensions;
+}
+
+/** \brief Accessor of m_boundary
+ */
+CellHandler::boundaryTypes SlabCluster::getBoundary() const
+{
+    return m_boundary;
+}
+
+/** \brief Number of worker processes
+ */
+int SlabCluster::getNbWorkers() const
+{
+    return m_sockets.size();
+}
+
+/** \brief Number of the current generation, 0 when the grid is generated
+ */
+unsigned int SlabCluster::getGeneration() const
+{
+    return m_generation;
+}
+
+/** \brief Number of cells of each state of the whole grid
+ */
+const QVector<quint64> &SlabCluster::getPopulation() const
+{
+    return m_population;
+}
+
+/** \brief Hash of the whole grid, the same as CellHandler::hash() for the same states
+ */
+quint64 SlabCluster::hash() const
+{
+    return m_hash;
+}
+
+/** \brief Send the rules and the neighbourhood of an automate to the workers
+ *
+ * Each worker answers the layers it needs for its halo, which depends on the rules, and is told the layers
+ * it has to export for the others. The states of the workers are kept.
+ *
+ * \param automate Automate of the same number of dimensions, its cells are not used
+ * \throw QString Block rules are not supported
+ * \throw QString Only the synchronous schedule is supported
+ * \throw QString The automate doesn't have the dimension of the grid
+ * \throw QString Lost connection
+ */
+void SlabCluster::setRules(const Automate &automate)
+{
+    if (automate.hasBlockRule())
+        throw QString(QObject::tr("Block rules are not supported"));
+    if (automate.getUpdateSchedule() != StepEngine::synchronous)
+        throw QString(QObject::tr("Only the synchronous schedule is supported"));
+    if (automate.getCellHandler().getDimensions().size() != m_dimensions.size())
+        throw QString(QObject::tr("The rules don't have the dimension of the grid"));
+
+    QByteArray ruleDocument = automate.ruleDocument().toJson(QJsonDocument::Compact);
+    for (int i = 0; i < m_sockets.size(); i++)
+    {
+        QByteArray payload;
+        QDataStream(&payload, QIODevice::WriteOnly) << m_dimensions << (quint32)m_boundary << ruleDocument
+            << automate.getLookupTableBudget() << m_firstLayers.at(i) << m_firstLayers.at(i + 1);
+        SlabWorker::send(*m_sockets.at(i), SlabWorker::setup, payload);
+    }
+
+    QVector<QVector<unsigned int> > exports(m_sockets.size());
+    m_haloSources.clear();
+    for (int i = 0; i < m_sockets.size(); i++)
+    {
+        QVector<unsigned int> sources;
+        QDataStream(receiveFrom(i, SlabWorker::setup)) >> sources;
+        m_haloSources.push_back(sources);
+        for (QVector<unsigned int>::const_iterator it = sources.cbegin(); it != sources.cend(); ++it)
+            if (!exports[getOwner(*it)].contains(*it))
+                exports[getOwner(*it)].push_back(*it);
+    }
+
+    m_borders.clear();
+    for (int i = 0; i < m_sockets.size(); i++)
+    {
+        QByteArray payload;
+        QDataStream(&payload, QIODevice::WriteOnly) << exports.at(i);
+        SlabWorker::send(*m_sockets.at(i), SlabWorker::exports, payload);
+    }
+    collectResults(SlabWorker::exports);
+    m_hasRules = true;
+}
+
+/** \brief Replace the states by random values (symetric or not), or by 0
+ *
+ * The states are the ones of CellHandler::generate() for the same dimensions and seed.
+ *
+ * \param type Type of generation
+ * \param stateMax Generate states between 0 and stateMax
+ * \param density Average (%) of non-zeros
+ * \param seed Seed of the random generator
+ * \throw QString No rules given
+ * \throw QString Lost connection
+ */
+void SlabCluster::generate(CellHandler::generationTypes type, unsigned int stateMax, unsigned short density, quint32 seed)
+{
+    if (!m_hasRules)
+        throw QString(QObject::tr("No rules given"));
+    QByteArray payload;
+    QDataStream(&payload, QIODevice::WriteOnly) << (quint32)type << stateMax << (quint16)density << seed;
+    sendAll(SlabWorker::generate, payload);
+    collectResults(SlabWorker::generate);
+    m_generation = 0;
+}
+
+/** \brief Compute the next generation
+ *
+ * Every worker receives its halo before any answer is read, so the slabs are computed in parallel.
+ *
+ * \throw QString No rules given
+ * \throw QString Lost connection
+ */
+void SlabCluster::step()
+{
+    if (!m_hasRules)
+        throw QString(QObject::tr("No rules given"));
+    for (int i = 0; i < m_sockets.size(); i++)
+    {
+        QByteArray payload;
+        QDataStream message(&payload, QIODevice::WriteOnly);
+        const QVector<unsigned int> &sources = m_haloSources.at(i);
+        message << m_generation << (quint32)sources.size();
+        for (QVector<unsigned int>::const_iterator it = sources.cbegin(); it != sources.cend(); ++it)
+        {
+            const QByteArray &states = m_borders[*it];
+            message << *it;
+            message.writeRawData(states.constData(), states.size());
+        }
+        SlabWorker::send(*m_sockets.at(i), SlabWorker::step, payload);
+    }
+    collectResults(SlabWorker::step);
+    m_generation++;
+}
+
+/** \brief Compute nbSteps generations
+ *
+ * \throw QString No rules given
+ * \throw QString Lost connection
+ */
+void SlabCluster::run(unsigned int nbSteps)
+{
+    for (unsigned int i = 0; i < nbSteps; i++)
+        step();
+}
+
+/** \brief Current states of a range of layers, gathered from their workers
+ *
+ * \param first First layer
+ * \param count Number of layers, clipped to the grid
+ * \return States by linear index, starting at the first cell of the first layer
+ * \throw QString Lost connection
+ */
+QVector<unsigned int> SlabCluster::getLayers(unsigned int first, unsigned int count)
+{
+    if (first >= m_nbLayers)
+        return QVector<unsigned int>();
+    count = qMin(count, m_nbLayers - first);
+    unsigned int firstWorker = getOwner(first), lastWorker = getOwner(first + count - 1);
+
+    QByteArray payload;
+    QDataStream(&payload, QIODevice::WriteOnly) << first << count;
+    for (unsigned int i = firstWorker; i <= lastWorker; i++)
+        SlabWorker::send(*m_sockets.at(i), SlabWorker::layers, payload);
+
+    QVector<unsigned int> states(count * m_layerSize);
+    for (unsigned int i = firstWorker; i <= lastWorker; i++)
+    {
+        QDataStream answer(receiveFrom(i, SlabWorker::layers));
+        unsigned int begin = 0, nbLayers = 0;
+        answer >> begin >> nbLayers;
+        if (begin < first || begin + nbLayers > first + count)
+            throw QString(QObject::tr("Not valid answer of a worker"));
+        answer.readRawData((char*)(states.data() + (begin - first) * m_layerSize), nbLayers * m_layerSize * sizeof(unsigned int));
+        if (answer.status() != QDataStream::Ok)
+            throw QString(QObject::tr("Not valid answer of a worker"));
+    }
+    return states;
+}
+
+/** \brief Current states of the whole grid, which must fit in the memory of the coordinator
+ *
+ * \throw QString Lost connection
+ */
+QVector<unsigned int> SlabCluster::getSnapshot()
+{
+    return getLayers(0, m_nbLayers);
+}
+
+/** \brief Write the current states in a file, by linear index, a few layers at a time
+ *
+ * The file can be opened by a MappedGrid of the same dimensions.
+ *
+ * \param filename File to write
+ * \return False if the file couldn't be written
+ * \throw QString Lost connection
+ */
+bool SlabCluster::writeStates(QString filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning("Couldn't open given file.");
+        return false;
+    }
+
+    const unsigned int chunkLayers = qMax<quint64>(1, slabChunkBytes / (m_layerSize * sizeof(unsigned int)));
+    for (unsigned int first = 0; first < m_nbLayers; first += chunkLayers)
+    {
+        QVector<unsigned int> states = getLayers(first, chunkLayers);
+        const qint64 bytes = states.size() * sizeof(unsigned int);
+        if (file.write((const char*)states.constData(), bytes) != bytes)
+            return false;
+    }
+    return true;
+}
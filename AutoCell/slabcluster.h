@@ -0,0 +1,83 @@
+#ifndef SLABCLUSTER_H
+#define SLABCLUSTER_H
+
+#include <QVector>
+#include <QHash>
+#include <QByteArray>
+#include <QProcess>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include "cellhandler.h"
+#include "slabworker.h"
+
+class Automate;
+
+
+/** \class SlabCluster
+ * \brief Coordinator of a grid split across several local worker processes
+ *
+ * The grid is cut along its last dimension in one slab per worker (see SlabWorker). The coordinator never
+ * holds the grid: at each step it routes the layers each worker needs for its halo, then it aggregates
+ * the population and the hash of the slabs. Every worker computes its slab with the same engine as an
+ * Automate and the random cells only depend on the seed and the index of the cell, so the result is the
+ * same as in a single process, whatever the number of workers.
+ *
+ * \code
+ * SlabCluster cluster({20000, 20000}, 8, CellHandler::toroidal);
+ * cluster.setRules(automate);
+ * cluster.generate(CellHandler::random, 1, 20, seed);
+ * cluster.run(1000);
+ * cluster.writeStates("world.states");
+ * \endcode
+ * The workers are started from the same program (see SlabWorker::isRequested()), they are stopped when
+ * the cluster is destroyed.
+ */
+class SlabCluster
+{
+private:
+    QVector<unsigned int> m_dimensions; ///< Dimensions of the grid
+    CellHandler::boundaryTypes m_boundary; ///< Behaviour of the neighbours out of the grid
+    quint64 m_layerSize; ///< Number of cells of a layer, all the dimensions but the last one
+    unsigned int m_nbLayers; ///< Length of the last dimension
+    QLocalServer m_server; ///< Server the workers connect to
+    QVector<QProcess*> m_processes; ///< Worker processes
+    QVector<QLocalSocket*> m_sockets; ///< Connection to each worker
+    QVector<unsigned int> m_firstLayers; ///< First layer of each worker, followed by m_nbLayers
+    QVector<QVector<unsigned int> > m_haloSources; ///< Layers of the other workers needed by each worker
+    QHash<unsigned int, QByteArray> m_borders; ///< Last states of the layers in m_haloSources
+    bool m_hasRules = false; ///< If setRules() was called
+    unsigned int m_generation = 0; ///< Number of the current generation
+    QVector<quint64> m_population; ///< Number of cells of each state
+    quint64 m_hash = 0; ///< Hash of the grid
+
+    void shutdown();
+    unsigned int getOwner(unsigned int layer) const;
+    void sendAll(SlabWorker::messageTypes type, const QByteArray &payload = QByteArray());
+    QByteArray receiveFrom(int worker, SlabWorker::messageTypes type);
+    void collectResults(SlabWorker::messageTypes type);
+
+public:
+    SlabCluster(const QVector<unsigned int> &dimensions, unsigned int nbWorkers,
+                CellHandler::boundaryTypes boundary = CellHandler::fixedZero, QString program = QString());
+    SlabCluster(const SlabCluster &c) = delete;
+    SlabCluster & operator=(const SlabCluster &c) = delete;
+    ~SlabCluster();
+
+    QVector<unsigned int> getDimensions() const;
+    CellHandler::boundaryTypes getBoundary() const;
+    int getNbWorkers() const;
+    unsigned int getGeneration() const;
+    const QVector<quint64> &getPopulation() const;
+    quint64 hash() const;
+
+    void setRules(const Automate &automate);
+    void generate(CellHandler::generationTypes type, unsigned int stateMax, unsigned short density, quint32 seed);
+    void step();
+    void run(unsigned int nbSteps);
+    QVector<unsigned int> getLayers(unsigned int first, unsigned int count);
+    QVector<unsigned int> getSnapshot();
+    bool writeStates(QString filename);
+};
+
+#endif // SLABCLUSTER_H
@@ -0,0 +1,354 @@
+#include <cstring>
+#include <algorithm>
+#include <QHash>
+#include <QDataStream>
+#include <QJsonDocument>
+#include <QtConcurrent>
+
+#include "slabworker.h"
+#include "automate.h"
+
+/** \brief Number of cells generated by a task
+ */
+static const quint64 slabGenerationTile = 1 << 20;
+
+/** \brief Read exactly size bytes, waiting for them as long as the connection is open
+ *
+ * \throw QString Lost connection
+ */
+static QByteArray readExactly(QLocalSocket &socket, qint64 size)
+{
+    QByteArray data;
+    while (data.size() < size)
+    {
+        if (socket.bytesAvailable() == 0 && !socket.waitForReadyRead(-1))
+            throw QString(QObject::tr("Lost connection: %1").arg(socket.errorString()));
+        data.append(socket.read(size - data.size()));
+    }
+    return data;
+}
+
+/** \brief Construct a worker, not connected yet (see run())
+ */
+SlabWorker::SlabWorker()
+{
+
+}
+
+SlabWorker::~SlabWorker()
+{
+    delete m_engine;
+}
+
+/** \brief Check if the program is started as a worker of a SlabCluster
+ *
+ * It is checked before the creation of the application, which needs a display in GUI mode.
+ */
+bool SlabWorker::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+        if (QString(argv[i]) == "--slab-worker")
+            return true;
+    return false;
+}
+
+/** \brief Layers out of a slab read by its stencil
+ *
+ * The halo positions [first - halo, first) and [last, last + halo) are mapped by the boundary, the
+ * positions out of a fixedZero grid are not needed.
+ *
+ * \param first First layer of the slab
+ * \param last Layer after the last one of the slab
+ * \param halo Halo of the stencil (see StepEngine::getHalo())
+ * \param nbLayers Length of the last dimension of the grid
+ * \param boundary Behaviour of the neighbours out of the grid
+ * \return Sorted layers, without the layers of the slab
+ */
+QVector<unsigned int> SlabWorker::haloSources(unsigned int first, unsigned int last, unsigned int halo, unsigned int nbLayers, CellHandler::boundaryTypes boundary)
+{
+    QVector<unsigned int> sources;
+    for (int position = (int)first - (int)halo; position < (int)(last + halo); position++)
+    {
+        if (position == (int)first)
+            position = last;
+        if (position >= (int)(last + halo))
+            break;
+        if (boundary == CellHandler::fixedZero && (position < 0 || position >= (int)nbLayers))
+            continue;
+        unsigned int source = CellHandler::mapCoordinate(position, nbLayers, boundary);
+        if ((source < first || source >= last) && !sources.contains(source))
+            sources.push_back(source);
+    }
+    std::sort(sources.begin(), sources.end());
+    return sources;
+}
+
+/** \brief Send a message: its type, the size of the payload and the payload
+ *
+ * \throw QString Lost connection
+ */
+void SlabWorker::send(QLocalSocket &socket, SlabWorker::messageTypes type, const QByteArray &payload)
+{
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << (quint32)type << (quint32)payload.size();
+    socket.write(header);
+    socket.write(payload);
+    while (socket.bytesToWrite() > 0)
+        if (!socket.waitForBytesWritten(-1))
+            throw QString(QObject::tr("Lost connection: %1").arg(socket.errorString()));
+}
+
+/** \brief Wait for the next message
+ *
+ * \param type Output, type of the message
+ * \return Payload of the message
+ * \throw QString Lost connection
+ */
+QByteArray SlabWorker::receive(QLocalSocket &socket, SlabWorker::messageTypes &type)
+{
+    QDataStream header(readExactly(socket, 2 * sizeof(quint32)));
+    quint32 messageType = 0, size = 0;
+    header >> messageType >> size;
+    type = (messageTypes)messageType;
+    return readExactly(socket, size);
+}
+
+/** \brief States of a layer of the buffer
+ *
+ * \param layer Layer of the grid, between m_haloFirst and m_haloLast
+ */
+unsigned int *SlabWorker::layer(int layer)
+{
+    return m_states.data() + (layer - m_haloFirst) * m_layerSize;
+}
+
+/** \brief Read a setup message: build the rules and the engine, and allocate the buffers
+ *
+ * The owned states are kept if the slab doesn't change, so the rules can be changed during a run.
+ *
+ * \throw QString Not valid rules
+ * \throw QString Only the synchronous schedule is supported
+ */
+void SlabWorker::configure(QDataStream &message)
+{
+    QVector<unsigned int> dimensions;
+    quint32 boundary = 0;
+    QByteArray ruleDocument;
+    unsigned int lookupTableBudget = 0, first = 0, last = 0;
+    message >> dimensions >> boundary >> ruleDocument >> lookupTableBudget >> first >> last;
+    if (message.status() != QDataStream::Ok || dimensions.isEmpty() || dimensions.contains(0) || first >= last || last > dimensions.last())
+        throw QString(QObject::tr("Not valid setup"));
+
+    // The rules only need an automate of the right number of dimensions
+    QVector<unsigned int> ruleDimensions = dimensions;
+    ruleDimensions.last() = 1;
+    Automate automate(ruleDimensions);
+    if (!automate.loadRuleDocument(QJsonDocument::fromJson(ruleDocument)))
+        throw QString(QObject::tr("Not valid rules"));
+    if (automate.getUpdateSchedule() != StepEngine::synchronous)
+        throw QString(QObject::tr("Only the synchronous schedule is supported"));
+    m_rules = QSharedPointer<const CompiledRules>(new CompiledRules(automate.getRules(), automate.getNeighbourhood(), lookupTableBudget));
+    m_randomSeed = automate.getRandomSeed();
+
+    QVector<unsigned int> owned;
+    quint64 layerSize = 1;
+    for (int i = 0; i < dimensions.size() - 1; i++)
+        layerSize *= dimensions.at(i);
+    if (dimensions == m_dimensions && first == m_first && last == m_last)
+        owned = m_states.mid((m_first - m_haloFirst) * m_layerSize, (m_last - m_first) * m_layerSize);
+
+    m_dimensions = dimensions;
+    m_boundary = (CellHandler::boundaryTypes)boundary;
+    m_layerSize = layerSize;
+    m_first = first;
+    m_last = last;
+
+    // The halo only depends on the rules (see CompiledRules::getReach()), the engine is rebuilt for the slab with its halo
+    QVector<unsigned int> slabDimensions = m_dimensions;
+    delete m_engine;
+    m_engine = nullptr;
+    int halo = m_rules->getReach();
+    m_haloFirst = (int)m_first - halo;
+    m_haloLast = (int)m_last + halo;
+    if (m_boundary == CellHandler::fixedZero)
+    {
+        m_haloFirst = qMax(m_haloFirst, 0);
+        m_haloLast = qMin(m_haloLast, (int)m_dimensions.last());
+    }
+    slabDimensions.last() = m_haloLast - m_haloFirst;
+    m_engine = new StepEngine(m_rules, slabDimensions, m_boundary);
+    m_engine->setSummaryRange((m_first - m_haloFirst) * m_layerSize, (m_last - m_haloFirst) * m_layerSize);
+
+    m_states = QVector<unsigned int>((m_haloLast - m_haloFirst) * m_layerSize, 0);
+    m_nextStates = m_states;
+    if (!owned.isEmpty())
+        memcpy(layer(m_first), owned.constData(), owned.size() * sizeof(unsigned int));
+    m_exports.clear();
+    summarize();
+}
+
+/** \brief Compute the population and the hash of the owned layers from their states
+ *
+ * It is only needed when the states are replaced, the steps update them with the engine.
+ */
+void SlabWorker::summarize()
+{
+    const unsigned int *owned = m_states.constData() + (m_first - m_haloFirst) * m_layerSize;
+    const quint64 count = (m_last - m_first) * m_layerSize;
+    const quint64 offset = m_first * m_layerSize;
+    m_population.clear();
+    m_hash = 0;
+    for (quint64 i = 0; i < count; i++)
+    {
+        if (owned[i] >= (unsigned int)m_population.size())
+            m_population.resize(owned[i] + 1);
+        m_population[owned[i]]++;
+        m_hash += CellHandler::hashCell(offset + i, owned[i]);
+    }
+}
+
+/** \brief Write the statistics of the owned layers and the exported layers
+ *
+ * Format: population by state (QVector<quint64>), hash (quint64, see CellHandler::hash()), number of
+ * layers, then the index and the raw states of each layer.
+ */
+void SlabWorker::writeResult(QDataStream &answer) const
+{
+    const unsigned int *owned = m_states.constData() + (m_first - m_haloFirst) * m_layerSize;
+    answer << m_population << m_hash << (quint32)m_exports.size();
+    for (QVector<unsigned int>::const_iterator it = m_exports.cbegin(); it != m_exports.cend(); ++it)
+    {
+        answer << *it;
+        answer.writeRawData((const char*)(owned + (*it - m_first) * m_layerSize), m_layerSize * sizeof(unsigned int));
+    }
+}
+
+/** \brief Connect to the coordinator and answer its messages until it asks to quit
+ *
+ * \param arguments Arguments of the program, with "--slab-worker <server name> <index>"
+ * \return True if the coordinator asked to quit
+ * \throw QString Not valid arguments
+ * \throw QString Lost connection
+ * \throw QString Not valid message
+ */
+bool SlabWorker::run(const QStringList &arguments)
+{
+    int position = arguments.indexOf("--slab-worker");
+    bool ok = false;
+    unsigned int index = position >= 0 && position + 2 < arguments.size() ? arguments.at(position + 2).toUInt(&ok) : 0;
+    if (!ok)
+        throw QString(QObject::tr("Not valid worker arguments"));
+
+    m_socket.connectToServer(arguments.at(position + 1));
+    if (!m_socket.waitForConnected())
+        throw QString(QObject::tr("Couldn't connect to the coordinator: %1").arg(m_socket.errorString()));
+    QByteArray helloPayload;
+    QDataStream(&helloPayload, QIODevice::WriteOnly) << index;
+    send(m_socket, hello, helloPayload);
+
+    for (;;)
+    {
+        messageTypes type;
+        QByteArray payload = receive(m_socket, type);
+        QDataStream message(payload);
+        QByteArray answerPayload;
+        QDataStream answer(&answerPayload, QIODevice::WriteOnly);
+
+        if (type == quit)
+            return true;
+        if (type != setup && m_engine == nullptr)
+            throw QString(QObject::tr("Not valid message"));
+
+        switch (type)
+        {
+        case setup:
+            configure(message);
+            answer << haloSources(m_first, m_last, m_engine->getHalo(), m_dimensions.last(), m_boundary);
+            break;
+        case exports:
+            message >> m_exports;
+            writeResult(answer);
+            break;
+        case generate:
+        {
+            quint32 generationType = 0;
+            unsigned int stateMax = 0;
+            quint16 density = 0;
+            quint32 seed = 0;
+            message >> generationType >> stateMax >> density >> seed;
+            unsigned int *owned = layer(m_first);
+            const quint64 offset = m_first * m_layerSize;
+            const quint64 count = (m_last - m_first) * m_layerSize;
+            const unsigned int length = m_dimensions.at(0);
+            QVector<quint64> tiles;
+            for (quint64 start = 0; start < count; start += slabGenerationTile)
+                tiles.push_back(start);
+            QtConcurrent::blockingMap(tiles, [=](const quint64 &start) {
+                unsigned int tileCount = qMin(slabGenerationTile, count - start);
+                if (generationType == CellHandler::empty)
+                    memset(owned + start, 0, tileCount * sizeof(unsigned int));
+                else
+                    CellHandler::generateStates(owned + start, offset + start, tileCount, length, (CellHandler::generationTypes)generationType, stateMax, density, seed);
+            });
+            summarize();
+            writeResult(answer);
+            break;
+        }
+        case step:
+        {
+            // Generation, halo layers of the other workers, then the halo positions are filled by the boundary
+            unsigned int generation = 0;
+            quint32 nbLayers = 0;
+            message >> generation >> nbLayers;
+            QHash<unsigned int, QByteArray> received;
+            for (quint32 i = 0; i < nbLayers; i++)
+            {
+                unsigned int source = 0;
+                QByteArray states(m_layerSize * sizeof(unsigned int), 0);
+                message >> source;
+                message.readRawData(states.data(), states.size());
+                received.insert(source, states);
+            }
+            for (int position = m_haloFirst; position < m_haloLast; position++)
+            {
+                if (position == (int)m_first)
+                    position = m_last;
+                if (position >= m_haloLast)
+                    break;
+                unsigned int source = CellHandler::mapCoordinate(position, m_dimensions.last(), m_boundary);
+                if (source >= m_first && source < m_last)
+                    memcpy(layer(position), layer(source), m_layerSize * sizeof(unsigned int));
+                else if (received.contains(source))
+                    memcpy(layer(position), received.value(source).constData(), m_layerSize * sizeof(unsigned int));
+                else
+                    throw QString(QObject::tr("Not valid message"));
+            }
+            m_engine->setRandomStream(m_randomSeed, generation, (quint64)((qint64)m_haloFirst * (qint64)m_layerSize));
+            // The engine only counts the owned layers, see configure()
+            quint64 hashDelta = 0;
+            m_engine->step(m_states.constData(), m_nextStates.data(), &hashDelta, &m_population);
+            m_hash += hashDelta;
+            m_states.swap(m_nextStates);
+            writeResult(answer);
+            break;
+        }
+        case layers:
+        {
+            unsigned int first = 0, count = 0;
+            message >> first >> count;
+            unsigned int begin = qMax(first, m_first), end = qMin(first + count, m_last);
+            answer << begin << (end > begin ? end - begin : 0);
+            if (end > begin)
+                answer.writeRawData((const char*)layer(begin), (end - begin) * m_layerSize * sizeof(unsigned int));
+            break;
+        }
+        default:
+            throw QString(QObject::tr("Not valid message"));
+        }
+
+        if (message.status() != QDataStream::Ok)
+            throw QString(QObject::tr("Not valid message"));
+        send(m_socket, type, answerPayload);
+    }
+}
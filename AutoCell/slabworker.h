@@ -0,0 +1,81 @@
+#ifndef SLABWORKER_H
+#define SLABWORKER_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QLocalSocket>
+
+#include "cellhandler.h"
+#include "compiledrules.h"
+#include "stepengine.h"
+
+
+/** \class SlabWorker
+ * \brief Process computing one slab of a grid distributed by a SlabCluster
+ *
+ * The grid is cut along its last dimension: the worker owns the layers [first, last) and keeps a copy of
+ * the halo, the layers of the other workers read by its stencil. At each step the coordinator sends the
+ * halo, the worker computes its layers with a StepEngine and sends back the layers the other workers need,
+ * with the population and the hash of its layers.
+ *
+ * The worker is the same program started with:
+ * \code
+ * AutoCell --slab-worker <server name> <index>
+ * \endcode
+ * Messages are exchanged on a local socket (see send() and receive()), the payload is written with
+ * QDataStream.
+ */
+class SlabWorker
+{
+public:
+    /** \brief Types of messages between the coordinator and the workers
+     */
+    enum messageTypes {
+        hello, ///< Worker to coordinator: index of the worker
+        setup, ///< Dimensions, boundary, rules and owned layers. Answer: layers needed for the halo
+        exports, ///< Layers the other workers need, sent after each step. Answer: exported layers and statistics
+        generate, ///< Generation of the owned layers. Answer: exported layers and statistics
+        step, ///< Generation and halo layers. Answer: exported layers and statistics
+        layers, ///< Range of layers to send back. Answer: the owned part of the range
+        quit ///< End of the worker. No answer
+    };
+
+private:
+    QLocalSocket m_socket; ///< Connection to the coordinator
+    QVector<unsigned int> m_dimensions; ///< Dimensions of the whole grid
+    CellHandler::boundaryTypes m_boundary = CellHandler::fixedZero; ///< Behaviour of the neighbours out of the grid
+    quint64 m_layerSize = 0; ///< Number of cells of a layer, all the dimensions but the last one
+    unsigned int m_first = 0; ///< First owned layer
+    unsigned int m_last = 0; ///< Layer after the last owned one
+    int m_haloFirst = 0; ///< First layer of the buffers, can be out of the grid
+    int m_haloLast = 0; ///< Layer after the last one of the buffers
+    QSharedPointer<const CompiledRules> m_rules; ///< Rules to apply
+    quint32 m_randomSeed = 0; ///< Seed of the probabilistic rules
+    StepEngine *m_engine = nullptr; ///< Engine of the layers of the buffers
+    QVector<unsigned int> m_states; ///< Owned layers with their halo
+    QVector<unsigned int> m_nextStates; ///< Next states of m_states
+    QVector<unsigned int> m_exports; ///< Owned layers needed by the other workers
+    QVector<quint64> m_population; ///< Number of owned cells of each state
+    quint64 m_hash = 0; ///< Hash of the owned cells, see CellHandler::hash()
+
+    void configure(QDataStream &message);
+    void summarize();
+    void writeResult(QDataStream &answer) const;
+    unsigned int *layer(int layer);
+
+public:
+    SlabWorker();
+    SlabWorker(const SlabWorker &w) = delete;
+    SlabWorker & operator=(const SlabWorker &w) = delete;
+    ~SlabWorker();
+
+    static bool isRequested(int argc, char * argv[]);
+    static QVector<unsigned int> haloSources(unsigned int first, unsigned int last, unsigned int halo, unsigned int nbLayers, CellHandler::boundaryTypes boundary);
+    static void send(QLocalSocket &socket, messageTypes type, const QByteArray &payload = QByteArray());
+    static QByteArray receive(QLocalSocket &socket, messageTypes &type);
+
+    bool run(const QStringList &arguments);
+};
+
+#endif // SLABWORKER_H
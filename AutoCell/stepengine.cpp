@@ -0,0 +1,903 @@
+#include <QtConcurrent>
+
+#include "stepengine.h"
+
+/** \brief Number of cells updated by a thread at once, when a phase is updated in parallel
+ */
+static const unsigned int scheduleTileCells = 1 << 14;
+
+/** \brief Number of rounds of the Feistel permutation of the randomSequential schedule
+ */
+static const quint64 scheduleFeistelRounds = 4;
+
+/** \brief Padded grid of 1 byte by state
+ */
+template <>
+quint8 *StepEngine::paddedStates<quint8>()
+{
+    return m_padded8.data();
+}
+
+/** \brief Padded grid of 2 bytes by state
+ */
+template <>
+quint16 *StepEngine::paddedStates<quint16>()
+{
+    return m_padded16.data();
+}
+
+/** \brief Padded grid of 4 bytes by state, allocated if needed
+ */
+template <>
+unsigned int *StepEngine::paddedStates<unsigned int>()
+{
+    if (m_padded.size() != (int)m_paddedSize)
+        m_padded.fill(0, m_paddedSize);
+    return m_padded.data();
+}
+
+/** \brief Prepare the padded grid and the working buffers of the engine
+ *
+ * \param rules Compiled rules
+ * \param dimensions Dimensions of the grid
+ * \param boundary Behaviour of the neighbours out of the grid
+ */
+StepEngine::StepEngine(QSharedPointer<const CompiledRules> rules, const QVector<unsigned int> &dimensions, CellHandler::boundaryTypes boundary):
+    m_rules(rules), m_dimensions(dimensions), m_size(1), m_boundary(boundary), m_halo(rules->getReach())
+{
+    const QVector<QVector<short> > &stencil = m_rules->getStencil();
+    int d = m_dimensions.size();
+    QVector<int> paddedStrides;
+    unsigned int paddedSize = 1;
+    for (int i = 0; i < d; i++)
+    {
+        m_size *= m_dimensions.at(i);
+        m_paddedDimensions.push_back(m_dimensions.at(i) + 2 * m_halo);
+        paddedStrides.push_back(paddedSize);
+        paddedSize *= m_paddedDimensions.at(i);
+    }
+    if (d == 0)
+    {
+        m_size = 0;
+        paddedSize = 0;
+    }
+
+    for (int n = 0; n < stencil.size(); n++)
+    {
+        int offset = 0;
+        for (int i = 0; i < stencil.at(n).size() && i < d; i++)
+            offset += stencil.at(n).at(i) * paddedStrides.at(i);
+        m_stencilOffsets.push_back(offset);
+    }
+
+    // Rows of the grid, and ghost cells: their coordinates are brought back into the grid by the boundary mode
+    QVector<unsigned int> position(d, 0);
+    for (unsigned int p = 0; p < paddedSize; p++)
+    {
+        bool ghost = false;
+        unsigned int source = 0;
+        for (int i = 0; i < d; i++)
+        {
+            int coordinate = (int)position.at(i) - (int)m_halo;
+            if (coordinate < 0 || coordinate >= (int)m_dimensions.at(i))
+                ghost = true;
+            coordinate = CellHandler::mapCoordinate(coordinate, m_dimensions.at(i), m_boundary);
+            source += (coordinate + m_halo) * paddedStrides.at(i);
+        }
+        if (ghost && m_boundary != CellHandler::fixedZero)
+        {
+            m_ghosts.push_back(p);
+            m_ghostSources.push_back(source);
+        }
+        else if (!ghost && position.at(0) == m_halo)
+            m_rowStarts.push_back(p);
+
+        for (int i = 0; i < d; i++)
+        {
+            if (++position[i] < m_paddedDimensions.at(i))
+                break;
+            position[i] = 0;
+        }
+    }
+
+    // Lookup tables of the counted states, the states greater than the ones of the rules behave the same way
+    unsigned int maxState = m_rules->getMaxState();
+    for (int c = 0; c < m_rules->getNbCounters(); c++)
+    {
+        QVector<unsigned char> counted;
+        for (unsigned int state = 0; state <= maxState + 1; state++)
+            counted.push_back(m_rules->isCounted(c, state) ? 1 : 0);
+        m_countedStates.push_back(counted);
+        m_countedOutOfTable.push_back(m_rules->isCounted(c, maxState + 1) ? 1 : 0);
+    }
+    // Narrowest padded grid which holds every state of the rules
+    m_paddedSize = paddedSize;
+    if (maxState <= 0xFF)
+    {
+        m_stateWidth = 1;
+        m_stateLimit = 0xFF;
+        m_padded8.resize(paddedSize);
+    }
+    else if (maxState <= 0xFFFF)
+    {
+        m_stateWidth = 2;
+        m_stateLimit = 0xFFFF;
+        m_padded16.resize(paddedSize);
+    }
+    else
+        m_padded.resize(paddedSize);
+    m_indicator.resize(paddedSize);
+    if (d > 0)
+    {
+        m_order.resize(m_dimensions.at(0));
+        m_groupStart.resize(m_dimensions.at(0) + 1);
+        m_presentClasses.resize(m_dimensions.at(0));
+        m_configuration.resize(m_dimensions.at(0));
+    }
+    m_classCursor.fill(0, maxState + 2);
+    for (int c = 0; c < m_rules->getNbConditions(); c++)
+        m_conditionOffsets.push_back(m_stencilOffsets.at(m_rules->getConditionIndex(c)));
+
+    // With fixedZero boundaries, the ghost cells are in state 0 but must not be counted as neighbours,
+    // which the lookup table can't know if a counter counts the state 0
+    m_useLookupTable = m_rules->hasLookupTable();
+    for (int c = 0; c < m_rules->getNbCounters(); c++)
+        if (m_boundary == CellHandler::fixedZero && m_rules->isCounted(c, 0))
+            m_useLookupTable = false;
+
+    m_passes = m_stateWidth == 1 ? selectPasses<quint8>() : m_stateWidth == 2 ? selectPasses<quint16>() : selectPasses<unsigned int>();
+    m_widePasses = selectPasses<unsigned int>();
+    m_counts.resize(m_rules->getNbCounters());
+    for (int c = 0; c < m_counts.size(); c++)
+        m_counts[c].resize(paddedSize);
+    if (!m_counts.isEmpty() && m_rules->getNeighbourhood().getType() == Neighbourhood::moore)
+        m_countBuffer.resize(paddedSize);
+}
+
+/** \brief Compute the next generation
+ *
+ * Cells which match no rule keep their state.
+ *
+ * \param states Current states, by linear index
+ * \param nextStates Output, next states by linear index
+ * \param hashDelta If not nullptr, the change of the hash of the grid (see CellHandler::hashCell) is added to it
+ * \param population If not nullptr, replaced by the number of cells of each state in the next generation.
+ * Its size is one more than the greatest state of the grid and of the rules, so some states may have no cell.
+ * It never goes beyond CellHandler::getMaxState(): the greater states are counted with this one
+ * \param nbChanged If not nullptr, set to the number of cells whose state changes
+ */
+void StepEngine::step(const unsigned int *states, unsigned int *nextStates, quint64 *hashDelta, QVector<quint64> *population, quint64 *nbChanged)
+{
+    if (m_size == 0)
+        return;
+    m_hashDelta = hashDelta;
+    m_summarize = hashDelta != nullptr || population != nullptr || nbChanged != nullptr;
+    m_nbChanged = 0;
+    unsigned int maxState = (this->*m_passes.fill)(states);
+    const Passes &passes = maxState <= m_stateLimit ? m_passes : m_widePasses;
+    if (maxState > m_stateLimit)
+        (this->*passes.fill)(states);
+
+    // The rules never give a state greater than their own ones, the other cells keep their state
+    m_population = nullptr;
+    if (population != nullptr)
+    {
+        m_populationLast = qMin(qMax(maxState, m_rules->getMaxState()), CellHandler::getMaxState());
+        population->fill(0, m_populationLast + 1);
+        m_population = population->data();
+    }
+
+    if (m_schedule != synchronous)
+    {
+        unsigned int width = m_dimensions.at(0);
+        memcpy(nextStates, states, m_size * sizeof(unsigned int));
+        (this->*passes.sweep)(nextStates);
+        if (m_summarize)
+            for (int row = 0; row < m_rowStarts.size(); row++)
+                summarizeRow(row, states + row * width, nextStates + row * width);
+    }
+    else if (m_rules->hasCountTable() && maxState <= m_rules->getMaxState())
+        (this->*passes.count)(nextStates);
+    else if (m_useLookupTable && maxState <= m_rules->getMaxState())
+        (this->*passes.lookup)(nextStates);
+    else
+        (this->*passes.rules)(nextStates);
+
+    if (nbChanged != nullptr)
+        *nbChanged = m_nbChanged;
+}
+
+/** \brief Width of the halo: a cell only depends on the cells at most this far on each dimension
+ */
+unsigned int StepEngine::getHalo() const
+{
+    return m_halo;
+}
+
+/** \brief Key of the draws of the probabilistic rules for the next steps
+ *
+ * Each rule draws, for each cell, the number of the cell index in the stream (step, rule) of the seed, so
+ * the result doesn't depend on how the grid is split. The automate gives the generation as the step.
+ *
+ * \param seed Seed of the run
+ * \param step Number of the step, usually the current generation
+ * \param firstIndex Linear index in the whole grid of the first cell of this grid, if it is a part of it. The
+ * hash delta of step() uses it too
+ */
+void StepEngine::setRandomStream(quint64 seed, quint64 step, quint64 firstIndex)
+{
+    m_randomSeed = seed;
+    m_randomStep = step;
+    m_randomFirst = firstIndex;
+}
+
+/** \brief Only count the cells [first, last) in the hash delta, the population and the change count of step()
+ *
+ * It leaves out the halo of a grid which is a part of another one, see SlabWorker.
+ *
+ * \param first First counted cell, by linear index
+ * \param last Cell after the last counted one
+ */
+void StepEngine::setSummaryRange(unsigned int first, unsigned int last)
+{
+    m_summaryFirst = first;
+    m_summaryLast = last;
+}
+
+/** \brief Choose the order of the updates of the cells
+ *
+ * The checkerboard and blockSequential schedules update the cells phase by phase. When no cell reads
+ * a cell of its own phase, even through the boundary, the cells of a phase are updated in parallel:
+ * with blockSize greater than the halo this is always true for fixedZero boundaries, and for the other
+ * boundaries if the dimensions are multiples of blockSize. Otherwise the cells of a phase are updated one
+ * after the other, in the order of their index.
+ *
+ * \param schedule Order of the updates
+ * \param blockSize Period of the phases of blockSequential, 0 for the smallest independent one (halo + 1)
+ */
+void StepEngine::setSchedule(updateSchedules schedule, unsigned int blockSize)
+{
+    m_schedule = schedule;
+    m_blockSize = blockSize != 0 ? qMax(blockSize, 2u) : qMax(m_halo + 1, 2u);
+    m_independentPhases = false;
+    m_inside.clear();
+    m_ghostsFirst.clear();
+    m_ghostsOf.clear();
+    if (schedule == synchronous || m_size == 0)
+        return;
+
+    // Linear index of the cell copied by each padded cell, -1 for the ghost cells of fixedZero boundaries
+    unsigned int width = m_dimensions.at(0);
+    QVector<int> sources(m_paddedSize, -1);
+    for (int r = 0; r < m_rowStarts.size(); r++)
+        for (unsigned int x = 0; x < width; x++)
+            sources[m_rowStarts.at(r) + x] = r * width + x;
+    for (int g = 0; g < m_ghosts.size(); g++)
+        sources[m_ghosts.at(g)] = sources.at(m_ghostSources.at(g));
+
+    // Ghost cells of each cell, refreshed as soon as the cell changes
+    if (!m_ghosts.isEmpty())
+    {
+        m_ghostsFirst.fill(0, m_size + 1);
+        for (int g = 0; g < m_ghosts.size(); g++)
+            m_ghostsFirst[sources.at(m_ghosts.at(g)) + 1]++;
+        for (unsigned int i = 0; i < m_size; i++)
+            m_ghostsFirst[i + 1] += m_ghostsFirst.at(i);
+        QVector<unsigned int> cursor = m_ghostsFirst;
+        m_ghostsOf.resize(m_ghosts.size());
+        for (int g = 0; g < m_ghosts.size(); g++)
+            m_ghostsOf[cursor[sources.at(m_ghosts.at(g))]++] = m_ghosts.at(g);
+    }
+    if (m_boundary == CellHandler::fixedZero)
+    {
+        m_inside.fill(0, m_paddedSize);
+        for (int p = 0; p < sources.size(); p++)
+            m_inside[p] = sources.at(p) >= 0 ? 1 : 0;
+    }
+
+    if (schedule == randomSequential)
+        return;
+    m_independentPhases = true;
+    for (unsigned int i = 0; i < m_size && m_independentPhases; i++)
+    {
+        unsigned int p = m_rowStarts.at(i / width) + i % width;
+        unsigned int phase = getPhase(i);
+        for (int n = 0; n < m_stencilOffsets.size() && m_independentPhases; n++)
+        {
+            int source = sources.at(p + m_stencilOffsets.at(n));
+            if (source >= 0 && source != (int)i && getPhase(source) == phase)
+                m_independentPhases = false;
+        }
+    }
+}
+
+/** \brief Accessor of m_schedule
+ */
+StepEngine::updateSchedules StepEngine::getSchedule() const
+{
+    return m_schedule;
+}
+
+/** \brief True if the cells of a phase are updated in parallel, see setSchedule()
+ */
+bool StepEngine::hasIndependentPhases() const
+{
+    return m_independentPhases;
+}
+
+/** \brief Number of bytes by state of the padded grid, for the grids whose states are not greater than the ones of the rules
+ */
+unsigned int StepEngine::getStateWidth() const
+{
+    return m_stateWidth;
+}
+
+/** \brief Number of phases of the checkerboard and blockSequential schedules
+ */
+unsigned int StepEngine::getNbPhases() const
+{
+    if (m_schedule == checkerboard)
+        return 2;
+    unsigned int nbPhases = 1;
+    if (m_schedule == blockSequential)
+        for (int i = 0; i < m_dimensions.size(); i++)
+            nbPhases *= m_blockSize;
+    return nbPhases;
+}
+
+/** \brief Phase of a cell: parity of the sum of its coordinates for checkerboard, its coordinates modulo
+ * m_blockSize as digits in base m_blockSize for blockSequential
+ *
+ * \param index Linear index of the cell
+ */
+unsigned int StepEngine::getPhase(unsigned int index) const
+{
+    unsigned int phase = 0;
+    unsigned int weight = 1;
+    for (int i = 0; i < m_dimensions.size(); i++)
+    {
+        unsigned int coordinate = index % m_dimensions.at(i);
+        index /= m_dimensions.at(i);
+        if (m_schedule == checkerboard)
+            phase += coordinate;
+        else
+        {
+            phase += (coordinate % m_blockSize) * weight;
+            weight *= m_blockSize;
+        }
+    }
+    return m_schedule == checkerboard ? phase % 2 : phase;
+}
+
+/** \brief Update the cells one by one in the padded grid, in the order of the schedule
+ *
+ * The random order of a randomSequential step is a permutation of the cells keyed on the random stream:
+ * a Feistel network on the smallest even number of bits, walked again until it falls in the grid. It needs
+ * no memory and gives the same order for the same seed and step.
+ *
+ * \tparam T Type of the states of the padded grid
+ * \param nextStates States of the grid, updated with the cells
+ */
+template <typename T>
+void StepEngine::sweep(unsigned int *nextStates)
+{
+    T *cells = paddedStates<T>();
+    if (m_schedule == randomSequential)
+    {
+        const CounterRandom order(m_randomSeed, ~m_randomStep);
+        unsigned int halfBits = 1;
+        while (((quint64)1 << (2 * halfBits)) < m_size)
+            halfBits++;
+        const quint64 mask = ((quint64)1 << halfBits) - 1;
+        for (quint64 k = 0; k < m_size; k++)
+        {
+            quint64 index = k;
+            do
+            {
+                quint64 left = index >> halfBits;
+                quint64 right = index & mask;
+                for (quint64 round = 0; round < scheduleFeistelRounds; round++)
+                {
+                    quint64 mixed = left ^ (order.at((round << 32) | right) & mask);
+                    left = right;
+                    right = mixed;
+                }
+                index = (left << halfBits) | right;
+            } while (index >= m_size);
+            updateCell(cells, index, nextStates);
+        }
+        return;
+    }
+
+    const unsigned int nbRows = m_rowStarts.size();
+    const unsigned int rowsPerTile = qMax(scheduleTileCells / m_dimensions.at(0), 1u);
+    for (unsigned int phase = 0; phase < getNbPhases(); phase++)
+    {
+        if (!m_independentPhases)
+        {
+            sweepPhase(cells, phase, 0, nbRows, nextStates);
+            continue;
+        }
+        QVector<unsigned int> tiles;
+        for (unsigned int row = 0; row < nbRows; row += rowsPerTile)
+            tiles.push_back(row);
+        QtConcurrent::blockingMap(tiles, [=](const unsigned int &firstRow) {
+            sweepPhase(cells, phase, firstRow, qMin(firstRow + rowsPerTile, nbRows), nextStates);
+        });
+    }
+}
+
+/** \brief Update the cells of a phase in some rows
+ *
+ * \param cells Padded grid
+ * \param phase Phase to update, see getPhase()
+ * \param firstRow First row
+ * \param lastRow Row after the last one
+ * \param nextStates States of the grid, updated with the cells
+ */
+template <typename T>
+void StepEngine::sweepPhase(T *cells, unsigned int phase, unsigned int firstRow, unsigned int lastRow, unsigned int *nextStates)
+{
+    const unsigned int width = m_dimensions.at(0);
+    const unsigned int period = m_schedule == checkerboard ? 2 : m_blockSize;
+    for (unsigned int row = firstRow; row < lastRow; row++)
+    {
+        // Along a row the phase only changes with the first coordinate, with the period of the schedule
+        unsigned int first = row * width;
+        unsigned int rowPhase = getPhase(first);
+        unsigned int start;
+        if (m_schedule == checkerboard)
+            start = (phase + rowPhase) % 2;
+        else if (phase >= rowPhase && phase - rowPhase < m_blockSize)
+            start = phase - rowPhase;
+        else
+            continue;
+        for (unsigned int x = start; x < width; x += period)
+            updateCell(cells, first + x, nextStates);
+    }
+}
+
+/** \brief Next state of a cell of the padded grid, from the current states of its stencil
+ *
+ * \param cells Padded grid
+ * \param padded Padded index of the cell
+ * \param index Linear index of the cell
+ */
+template <typename T>
+unsigned int StepEngine::evaluateCell(const T *cells, unsigned int padded, unsigned int index) const
+{
+    const T *cell = cells + padded;
+    const CompiledRules &program = *m_rules;
+    const QVector<CompiledRules::CompiledRule> &rules = program.getRules();
+    const QVector<int> &candidates = program.getCandidateRules(cell[0]);
+    const int nbNeighbours = program.getNeighbourhood().size();
+    for (int k = 0; k < candidates.size(); k++)
+    {
+        const CompiledRules::CompiledRule &rule = rules.at(candidates.at(k));
+        bool matched = true;
+        if (rule.kind == CompiledRules::neighbourCount)
+        {
+            const unsigned char *counted = m_countedStates.at(rule.counter).constData();
+            unsigned int tableSize = m_countedStates.at(rule.counter).size();
+            unsigned char outOfTable = m_countedOutOfTable.at(rule.counter);
+            unsigned int count = 0;
+            for (int n = 0; n < nbNeighbours; n++)
+            {
+                int offset = m_stencilOffsets.at(n);
+                if (m_inside.isEmpty() || m_inside.at(padded + offset))
+                    count += cell[offset] < tableSize ? counted[cell[offset]] : outOfTable;
+            }
+            matched = count >= rule.min && count <= rule.max;
+            if (matched && rule.firstThreshold >= 0)
+            {
+                const CounterRandom random(m_randomSeed, m_randomStep * rules.size() + candidates.at(k));
+                matched = (random.at(m_randomFirst + index) >> 11) < program.getThresholds(rule)[count];
+            }
+        }
+        else
+        {
+            for (int c = rule.firstCondition; c < rule.firstCondition + rule.nbConditions && matched; c++)
+                matched = program.allows(program.getConditionMask(c), cell[m_conditionOffsets.at(c)]);
+        }
+        if (matched)
+            return rule.outputState;
+    }
+    return cell[0];
+}
+
+/** \brief Update a cell in place: in the padded grid with its ghost cells, and in the states
+ *
+ * \param cells Padded grid
+ * \param index Linear index of the cell
+ * \param nextStates States of the grid
+ */
+template <typename T>
+void StepEngine::updateCell(T *cells, unsigned int index, unsigned int *nextStates)
+{
+    const unsigned int width = m_dimensions.at(0);
+    const unsigned int padded = m_rowStarts.at(index / width) + index % width;
+    const unsigned int state = evaluateCell(cells, padded, index);
+    if (state == cells[padded])
+        return;
+    cells[padded] = state;
+    nextStates[index] = state;
+    if (!m_ghostsFirst.isEmpty())
+        for (unsigned int g = m_ghostsFirst.at(index); g < m_ghostsFirst.at(index + 1); g++)
+            cells[m_ghostsOf.at(g)] = state;
+}
+
+/** \brief Choose the passes specialized for the number of dimensions, the size of the stencil and the width of the states
+ *
+ * Grids of 1, 2 or 3 dimensions walk their rows with fixed nested loops, the others use m_rowStarts.
+ * The lookup pass is also unrolled on the stencils of the usual neighbourhoods without extra positions.
+ *
+ * \tparam T Type of the states of the padded grid
+ */
+template <typename T>
+StepEngine::Passes StepEngine::selectPasses() const
+{
+    Passes passes;
+    passes.sweep = &StepEngine::sweep<T>;
+    int nbPositions = m_stencilOffsets.size();
+    switch (m_dimensions.size())
+    {
+    case 1:
+        passes.fill = &StepEngine::fillPadded<1, T>;
+        passes.rules = &StepEngine::applyRules<1, T>;
+        passes.count = &StepEngine::applyCountTable<1, T>;
+        passes.lookup = nbPositions == 2 ? &StepEngine::applyLookupTable<1, 2, T> :
+                        nbPositions == 4 ? &StepEngine::applyLookupTable<1, 4, T> : &StepEngine::applyLookupTable<1, 0, T>;
+        break;
+    case 2:
+        passes.fill = &StepEngine::fillPadded<2, T>;
+        passes.rules = &StepEngine::applyRules<2, T>;
+        passes.count = &StepEngine::applyCountTable<2, T>;
+        passes.lookup = nbPositions == 4 ? &StepEngine::applyLookupTable<2, 4, T> :
+                        nbPositions == 6 ? &StepEngine::applyLookupTable<2, 6, T> :
+                        nbPositions == 8 ? &StepEngine::applyLookupTable<2, 8, T> : &StepEngine::applyLookupTable<2, 0, T>;
+        break;
+    case 3:
+        passes.fill = &StepEngine::fillPadded<3, T>;
+        passes.rules = &StepEngine::applyRules<3, T>;
+        passes.count = &StepEngine::applyCountTable<3, T>;
+        passes.lookup = nbPositions == 6 ? &StepEngine::applyLookupTable<3, 6, T> :
+                        nbPositions == 26 ? &StepEngine::applyLookupTable<3, 26, T> : &StepEngine::applyLookupTable<3, 0, T>;
+        break;
+    default:
+        passes.fill = &StepEngine::fillPadded<0, T>;
+        passes.rules = &StepEngine::applyRules<0, T>;
+        passes.count = &StepEngine::applyCountTable<0, T>;
+        passes.lookup = &StepEngine::applyLookupTable<0, 0, T>;
+        break;
+    }
+    return passes;
+}
+
+/** \brief Call function(row, start) for each row of the grid, start is the padded index of its first cell
+ *
+ * \tparam D Number of dimensions, 0 for any number
+ */
+template <int D, typename Function>
+inline void StepEngine::forEachRow(Function function) const
+{
+    if (D == 1)
+        function(0, m_halo);
+    else if (D == 2)
+    {
+        unsigned int height = m_dimensions.at(1);
+        unsigned int paddedWidth = m_paddedDimensions.at(0);
+        unsigned int start = m_halo * paddedWidth + m_halo;
+        for (unsigned int y = 0; y < height; y++, start += paddedWidth)
+            function(y, start);
+    }
+    else if (D == 3)
+    {
+        unsigned int height = m_dimensions.at(1);
+        unsigned int depth = m_dimensions.at(2);
+        unsigned int paddedWidth = m_paddedDimensions.at(0);
+        unsigned int paddedLayer = paddedWidth * m_paddedDimensions.at(1);
+        unsigned int row = 0;
+        for (unsigned int z = 0; z < depth; z++)
+        {
+            unsigned int start = (z + m_halo) * paddedLayer + m_halo * paddedWidth + m_halo;
+            for (unsigned int y = 0; y < height; y++, start += paddedWidth)
+                function(row++, start);
+        }
+    }
+    else
+    {
+        for (int r = 0; r < m_rowStarts.size(); r++)
+            function(r, m_rowStarts.at(r));
+    }
+}
+
+/** \brief Compute the next generation with the lookup table of the rules
+ *
+ * The configuration number of each cell is accumulated on the stencil positions.
+ *
+ * \tparam D Number of dimensions, 0 for any number
+ * \tparam N Number of stencil positions, 0 for any number
+ * \tparam T Type of the states of the padded grid
+ */
+template <int D, int N, typename T>
+void StepEngine::applyLookupTable(unsigned int *nextStates)
+{
+    unsigned int width = m_dimensions.at(0);
+    const unsigned int *table = m_rules->getLookupTable().constData();
+    const QVector<unsigned int> &weights = m_rules->getLookupWeights();
+    const T *padded = paddedStates<T>();
+
+    if (N > 0)
+    {
+        // Fixed stencil: the loop on the positions is unrolled for each cell
+        int offsets[N > 0 ? N : 1];
+        unsigned int positionWeights[N > 0 ? N : 1];
+        for (int n = 0; n < N; n++)
+        {
+            offsets[n] = m_stencilOffsets.at(n);
+            positionWeights[n] = weights.at(n + 1);
+        }
+        forEachRow<D>([&](unsigned int row, unsigned int start) {
+            const T *cell = padded + start;
+            unsigned int *out = nextStates + row * width;
+            for (unsigned int x = 0; x < width; x++)
+            {
+                unsigned int configuration = cell[x];
+                for (int n = 0; n < N; n++)
+                    configuration += cell[(int)x + offsets[n]] * positionWeights[n];
+                out[x] = table[configuration];
+            }
+            if (m_summarize)
+                summarizeRow(row, cell, out);
+        });
+        return;
+    }
+
+    unsigned int *configuration = m_configuration.data();
+    forEachRow<D>([&](unsigned int row, unsigned int start) {
+        const T *cell = padded + start;
+        unsigned int *out = nextStates + row * width;
+        for (unsigned int x = 0; x < width; x++)
+            configuration[x] = cell[x];
+        for (int n = 0; n < m_stencilOffsets.size(); n++)
+        {
+            const T *neighbour = cell + m_stencilOffsets.at(n);
+            unsigned int weight = weights.at(n + 1);
+            for (unsigned int x = 0; x < width; x++)
+                configuration[x] += neighbour[x] * weight;
+        }
+        for (unsigned int x = 0; x < width; x++)
+            out[x] = table[configuration[x]];
+        if (m_summarize)
+            summarizeRow(row, cell, out);
+    });
+}
+
+/** \brief Compute the next generation with the neighbour counters and the rule bitmasks
+ *
+ * \tparam D Number of dimensions, 0 for any number
+ * \tparam T Type of the states of the padded grid
+ */
+template <int D, typename T>
+void StepEngine::applyRules(unsigned int *nextStates)
+{
+    unsigned int width = m_dimensions.at(0);
+    const T *padded = paddedStates<T>();
+
+    // Neighbour counters
+    for (int c = 0; c < m_counts.size(); c++)
+        computeCounter<D, T>(c);
+
+    // Rules: the cells of a row are grouped by state, then each group only tests the candidate rules of its state.
+    // The cells which matched are removed from the group, so the loops only go through pending cells.
+    const QVector<CompiledRules::CompiledRule> &rules = m_rules->getRules();
+    const CompiledRules &program = *m_rules;
+    unsigned int lastClass = program.getMaxState() + 1;
+    unsigned int *classCursor = m_classCursor.data();
+    unsigned int *presentClasses = m_presentClasses.data();
+    unsigned int *groupStart = m_groupStart.data();
+    unsigned int *order = m_order.data();
+    forEachRow<D>([&](unsigned int row, unsigned int start) {
+        const T *cell = padded + start;
+        unsigned int *out = nextStates + row * width;
+
+        // Counting sort of the cells by state
+        unsigned int nbPresent = 0;
+        for (unsigned int x = 0; x < width; x++)
+        {
+            out[x] = cell[x];
+            unsigned int stateClass = qMin((unsigned int)cell[x], lastClass);
+            if (classCursor[stateClass]++ == 0)
+                presentClasses[nbPresent++] = stateClass;
+        }
+        unsigned int position = 0;
+        for (unsigned int i = 0; i < nbPresent; i++)
+        {
+            unsigned int groupSize = classCursor[presentClasses[i]];
+            groupStart[i] = position;
+            classCursor[presentClasses[i]] = position;
+            position += groupSize;
+        }
+        groupStart[nbPresent] = position;
+        for (unsigned int x = 0; x < width; x++)
+            order[classCursor[qMin((unsigned int)cell[x], lastClass)]++] = x;
+
+        for (unsigned int i = 0; i < nbPresent; i++)
+        {
+            classCursor[presentClasses[i]] = 0;
+            const QVector<int> &candidates = program.getCandidateRules(presentClasses[i]);
+            unsigned int *group = order + groupStart[i];
+            unsigned int nbPending = groupStart[i + 1] - groupStart[i];
+            for (int k = 0; k < candidates.size() && nbPending > 0; k++)
+            {
+                const CompiledRules::CompiledRule &rule = rules.at(candidates.at(k));
+                unsigned int nbLeft = 0;
+                if (rule.kind == CompiledRules::neighbourCount)
+                {
+                    // count in [min, max] <=> count - min <= max - min, in unsigned arithmetic
+                    const unsigned int *counts = m_counts.at(rule.counter).constData() + start;
+                    unsigned int range = rule.max - rule.min;
+                    bool valid = rule.max >= rule.min;
+                    if (rule.firstThreshold < 0)
+                    {
+                        for (unsigned int j = 0; j < nbPending; j++)
+                        {
+                            unsigned int x = group[j];
+                            if (valid && counts[x] - rule.min <= range)
+                                out[x] = rule.outputState;
+                            else
+                                group[nbLeft++] = x;
+                        }
+                    }
+                    else
+                    {
+                        const quint64 *thresholds = program.getThresholds(rule);
+                        const CounterRandom random(m_randomSeed, m_randomStep * rules.size() + candidates.at(k));
+                        const quint64 first = m_randomFirst + (quint64)row * width;
+                        for (unsigned int j = 0; j < nbPending; j++)
+                        {
+                            unsigned int x = group[j];
+                            if (valid && counts[x] - rule.min <= range && (random.at(first + x) >> 11) < thresholds[counts[x]])
+                                out[x] = rule.outputState;
+                            else
+                                group[nbLeft++] = x;
+                        }
+                    }
+                }
+                else
+                {
+                    int lastCondition = rule.firstCondition + rule.nbConditions;
+                    for (unsigned int j = 0; j < nbPending; j++)
+                    {
+                        unsigned int x = group[j];
+                        bool matched = true;
+                        for (int c = rule.firstCondition; c < lastCondition && matched; c++)
+                            matched = program.allows(program.getConditionMask(c), cell[(int)x + m_conditionOffsets.at(c)]);
+                        if (matched)
+                            out[x] = rule.outputState;
+                        else
+                            group[nbLeft++] = x;
+                    }
+                }
+                nbPending = nbLeft;
+            }
+        }
+        if (m_summarize)
+            summarizeRow(row, cell, out);
+    });
+}
+
+/** \brief Compute the next generation with the count table of the rules
+ *
+ * Only the counter of the rules is computed, then the next state of a cell is one table access.
+ *
+ * \tparam D Number of dimensions, 0 for any number
+ * \tparam T Type of the states of the padded grid
+ */
+template <int D, typename T>
+void StepEngine::applyCountTable(unsigned int *nextStates)
+{
+    computeCounter<D, T>(0);
+    unsigned int width = m_dimensions.at(0);
+    const T *padded = paddedStates<T>();
+    const unsigned int *counts = m_counts.at(0).constData();
+    const unsigned int *table = m_rules->getCountTable().constData();
+    const unsigned int nbCounts = m_rules->getNeighbourhood().size() + 1;
+    forEachRow<D>([&](unsigned int row, unsigned int start) {
+        const T *cell = padded + start;
+        const unsigned int *count = counts + start;
+        unsigned int *out = nextStates + row * width;
+        for (unsigned int x = 0; x < width; x++)
+            out[x] = table[cell[x] * nbCounts + count[x]];
+        if (m_summarize)
+            summarizeRow(row, cell, out);
+    });
+}
+
+/** \brief Compute a neighbour counter for the whole grid, the indicators of the ghost cells follow the boundary mode
+ *
+ * \tparam D Number of dimensions, 0 for any number
+ * \tparam T Type of the states of the padded grid
+ * \param counter Index of the counter
+ */
+template <int D, typename T>
+void StepEngine::computeCounter(int counter)
+{
+    unsigned int width = m_dimensions.at(0);
+    const T *padded = paddedStates<T>();
+    const unsigned char *counted = m_countedStates.at(counter).constData();
+    unsigned int tableSize = m_countedStates.at(counter).size();
+    unsigned char outOfTable = m_countedOutOfTable.at(counter);
+    unsigned char *indicator = m_indicator.data();
+    forEachRow<D>([&](unsigned int, unsigned int start) {
+        for (unsigned int p = start; p < start + width; p++)
+            indicator[p] = padded[p] < tableSize ? counted[padded[p]] : outOfTable;
+    });
+    for (int g = 0; g < m_ghosts.size(); g++)
+        indicator[m_ghosts.at(g)] = indicator[m_ghostSources.at(g)];
+    m_rules->getNeighbourhood().countNeighbours(m_paddedDimensions, m_halo, indicator, m_counts[counter].data(), m_countBuffer.data());
+}
+
+/** \brief Add the changes and the next states of a row to the hash delta, the population and the change count
+ *
+ * Only the cells of the range given by setSummaryRange() are counted. The sums of the row are kept in locals and added to the totals once per row, in the order of the rows.
+ * They are integer sums, so the totals are exact whatever the order.
+ *
+ * \param row Index of the row
+ * \param cell Current states of the row
+ * \param out Next states of the row
+ */
+template <typename T>
+void StepEngine::summarizeRow(unsigned int row, const T *cell, const unsigned int *out)
+{
+    unsigned int width = m_dimensions.at(0);
+    unsigned int first = row * width;
+    unsigned int begin = first < m_summaryFirst ? qMin(m_summaryFirst - first, width) : 0;
+    unsigned int end = first < m_summaryLast ? qMin(m_summaryLast - first, width) : 0;
+    const quint64 index = m_randomFirst + first;
+    quint64 delta = 0;
+    unsigned int changed = 0;
+    for (unsigned int x = begin; x < end; x++)
+    {
+        if (out[x] != cell[x])
+        {
+            changed++;
+            if (m_hashDelta != nullptr)
+                delta += CellHandler::hashCell(index + x, out[x]) - CellHandler::hashCell(index + x, cell[x]);
+        }
+    }
+    if (m_population != nullptr)
+        for (unsigned int x = begin; x < end; x++)
+            m_population[qMin(out[x], m_populationLast)]++;
+    if (m_hashDelta != nullptr)
+        *m_hashDelta += delta;
+    m_nbChanged += changed;
+}
+
+/** \brief Copy the grid in the padded buffer and refresh the ghost cells
+ *
+ * The states greater than the ones of T are truncated, the caller fills a padded grid of 4 bytes instead.
+ *
+ * \tparam D Number of dimensions, 0 for any number
+ * \tparam T Type of the states of the padded grid
+ * \return Greatest state of the grid
+ */
+template <int D, typename T>
+unsigned int StepEngine::fillPadded(const unsigned int *states)
+{
+    unsigned int width = m_dimensions.at(0);
+    T *padded = paddedStates<T>();
+    unsigned int maxState = 0;
+    forEachRow<D>([&](unsigned int row, unsigned int start) {
+        const unsigned int *in = states + row * width;
+        T *out = padded + start;
+        for (unsigned int x = 0; x < width; x++)
+        {
+            out[x] = (T)in[x];
+            maxState = qMax(maxState, in[x]);
+        }
+    });
+    for (int g = 0; g < m_ghosts.size(); g++)
+        padded[m_ghosts.at(g)] = padded[m_ghostSources.at(g)];
+    return maxState;
+}
@@ -0,0 +1,145 @@
+#ifndef STEPENGINE_H
+#define STEPENGINE_H
+
+#include <QVector>
+#include <QSharedPointer>
+
+#include "compiledrules.h"
+#include "cellhandler.h"
+#include "counterrandom.h"
+
+/** \class StepEngine
+ * \brief Compute the next generation of a grid from compiled rules
+ *
+ * The grid is copied in a padded buffer, surrounded by a halo of ghost cells as wide as the
+ * stencil. The ghost cells are refreshed once per step according to the boundary mode, so
+ * nothing has to check the borders afterwards. One step is then done in two passes:
+ * - each neighbour counter of the rules is computed for the whole grid by the kernel of the neighbourhood,
+ * - the cells of each row are grouped by state, and each group tests in priority order the candidate rules
+ *   of its state, using the counters or the stencil offsets. Matched cells leave the group.
+ *
+ * The probabilistic rules draw one number per cell and rule from a CounterRandom, keyed on the seed and the step
+ * given by setRandomStream() and on the linear index of the cell.
+ *
+ * If the rules have a lookup table, the two passes are replaced by one table access per cell, as long
+ * as the grid has no state greater than the ones of the rules. If they have a count table (rules which
+ * only depend on one counter, such as Generations rules), only this counter is computed, then each cell
+ * reads its next state in the row of its state at its count.
+ *
+ * The passes are specialized for grids of 1, 2 and 3 dimensions when the engine is built (see selectPasses),
+ * other grids use a generic version.
+ *
+ * The hash delta and the population of each state are optionally computed by the same passes, on each row
+ * while it is still in the cache (see summarizeRow), so they don't need another pass on the grid.
+ *
+ * Other update schedules than the synchronous one (see setSchedule) update the cells one by one in the padded
+ * grid, each cell seeing the new states of the cells updated before it: no buffer of next states is needed.
+ *
+ * The padded grid stores the states on 1, 2 or 4 bytes, the smallest width which holds every state of the rules
+ * (see getStateWidth()), so the passes which read the stencil of each cell move less memory. A step whose grid
+ * has a greater state uses a padded grid of 4 bytes instead.
+ *
+ * The engine owns its working buffers, so it must not be shared between automata.
+ */
+class StepEngine
+{
+public:
+    /** \brief Order in which the cells are updated during a step
+     */
+    enum updateSchedules {
+        synchronous, ///< All the cells at once, from the states of the previous generation
+        randomSequential, ///< One cell at a time, each cell once per step in a random order
+        checkerboard, ///< The cells whose sum of coordinates is even, then the odd ones
+        blockSequential ///< The cells are split in blockSize^d phases by their coordinates modulo blockSize, updated one phase after the other
+    };
+
+    StepEngine(QSharedPointer<const CompiledRules> rules, const QVector<unsigned int> &dimensions, CellHandler::boundaryTypes boundary = CellHandler::fixedZero);
+
+    void step(const unsigned int *states, unsigned int *nextStates, quint64 *hashDelta = nullptr,
+              QVector<quint64> *population = nullptr, quint64 *nbChanged = nullptr);
+    unsigned int getHalo() const;
+    void setRandomStream(quint64 seed, quint64 step, quint64 firstIndex = 0);
+    void setSummaryRange(unsigned int first, unsigned int last);
+    void setSchedule(updateSchedules schedule, unsigned int blockSize = 0);
+    updateSchedules getSchedule() const;
+    bool hasIndependentPhases() const;
+    unsigned int getStateWidth() const;
+
+private:
+    /** \brief Passes specialized for the dimension and the width of the states of the padded grid
+     */
+    struct Passes
+    {
+        unsigned int (StepEngine::*fill)(const unsigned int *states); ///< fillPadded
+        void (StepEngine::*lookup)(unsigned int *nextStates); ///< applyLookupTable, also specialized for the stencil
+        void (StepEngine::*rules)(unsigned int *nextStates); ///< applyRules
+        void (StepEngine::*count)(unsigned int *nextStates); ///< applyCountTable
+        void (StepEngine::*sweep)(unsigned int *nextStates); ///< sweep
+    };
+
+    template <typename T> Passes selectPasses() const;
+    template <typename T> T *paddedStates();
+    template <int D, typename Function> void forEachRow(Function function) const;
+    template <int D, typename T> unsigned int fillPadded(const unsigned int *states);
+    template <int D, int N, typename T> void applyLookupTable(unsigned int *nextStates);
+    template <int D, typename T> void applyRules(unsigned int *nextStates);
+    template <int D, typename T> void applyCountTable(unsigned int *nextStates);
+    template <int D, typename T> void computeCounter(int counter);
+    template <typename T> void summarizeRow(unsigned int row, const T *cell, const unsigned int *out);
+    unsigned int getNbPhases() const;
+    unsigned int getPhase(unsigned int index) const;
+    template <typename T> void sweep(unsigned int *nextStates);
+    template <typename T> void sweepPhase(T *cells, unsigned int phase, unsigned int firstRow, unsigned int lastRow, unsigned int *nextStates);
+    template <typename T> unsigned int evaluateCell(const T *cells, unsigned int padded, unsigned int index) const;
+    template <typename T> void updateCell(T *cells, unsigned int index, unsigned int *nextStates);
+
+    Passes m_passes; ///< Passes on the padded grid of m_stateWidth bytes by state
+    Passes m_widePasses; ///< Passes on the padded grid of 4 bytes by state, for the grids with greater states
+
+    QSharedPointer<const CompiledRules> m_rules; ///< Rules to apply
+    QVector<unsigned int> m_dimensions; ///< Dimensions of the grid
+    unsigned int m_size; ///< Number of cells
+    CellHandler::boundaryTypes m_boundary; ///< Behaviour of the neighbours out of the grid
+    unsigned int m_halo; ///< Width of the halo, greatest component of the stencil
+    QVector<unsigned int> m_paddedDimensions; ///< Dimensions of the padded grid
+    QVector<unsigned int> m_rowStarts; ///< Padded index of the first cell of each row of the grid
+    QVector<unsigned int> m_ghosts; ///< Padded index of the ghost cells which copy a cell of the grid
+    QVector<unsigned int> m_ghostSources; ///< Padded index of the cell copied by each ghost cell
+    unsigned int m_paddedSize = 0; ///< Number of cells of the padded grid
+    unsigned int m_stateWidth = 4; ///< Number of bytes by state of the padded grid, 1, 2 or 4
+    unsigned int m_stateLimit = 0xFFFFFFFF; ///< Greatest state of the padded grid of m_stateWidth bytes
+    QVector<quint8> m_padded8; ///< States of the padded grid of 1 byte by state, ghost cells of fixedZero boundaries stay at 0
+    QVector<quint16> m_padded16; ///< States of the padded grid of 2 bytes by state
+    QVector<unsigned int> m_padded; ///< States of the padded grid of 4 bytes by state, allocated on the first step which needs it
+    QVector<int> m_stencilOffsets; ///< Linear offset of each stencil position in the padded grid
+    QVector<QVector<unsigned char> > m_countedStates; ///< For each counter, 1 if the state is counted (by state)
+    QVector<unsigned char> m_countedOutOfTable; ///< For each counter, 1 if the states greater than the ones of the rules are counted
+    QVector<unsigned char> m_indicator; ///< Working buffer, 1 if the padded cell is counted
+    QVector<int> m_conditionOffsets; ///< Linear offset in the padded grid of each matrix condition
+    QVector<unsigned int> m_classCursor; ///< Working buffer, number of cells then insertion cursor of each state of the row
+    QVector<unsigned int> m_presentClasses; ///< Working buffer, states which appear in the row
+    QVector<unsigned int> m_groupStart; ///< Working buffer, start of the group of each present state in m_order
+    QVector<unsigned int> m_order; ///< Working buffer, cells of the row sorted by state
+    QVector<unsigned int> m_configuration; ///< Working buffer, configuration number of each cell of the row
+    quint64 m_randomSeed = 0; ///< Seed of the draws of the probabilistic rules
+    quint64 m_randomStep = 0; ///< Step of the draws, each step has its own streams
+    quint64 m_randomFirst = 0; ///< Linear index of the first cell of the grid in the whole grid, for the draws and the hash
+    updateSchedules m_schedule = synchronous; ///< Order of the updates of the cells
+    unsigned int m_blockSize = 2; ///< Period of the phases of blockSequential schedules
+    bool m_independentPhases = false; ///< True if no cell reads a cell of its own phase, so a phase can be updated in parallel
+    QVector<unsigned char> m_inside; ///< 1 for the padded cells of the grid, only for fixedZero boundaries and sequential schedules
+    QVector<unsigned int> m_ghostsFirst; ///< Start in m_ghostsOf of the ghost cells of each cell, by linear index, for sequential schedules
+    QVector<unsigned int> m_ghostsOf; ///< Padded index of the ghost cells which copy each cell
+    bool m_useLookupTable; ///< True if the lookup table of the rules gives the right result with this boundary
+    quint64 *m_hashDelta = nullptr; ///< Change of the hash of the grid during the current step, nullptr if not needed
+    quint64 *m_population = nullptr; ///< Number of cells of each state in the next generation, nullptr if not needed
+    unsigned int m_populationLast = 0; ///< Last state of m_population, the greater states are counted with it
+    quint64 m_nbChanged = 0; ///< Number of cells which change during the current step
+    bool m_summarize = false; ///< True if summarizeRow() must be called on each row
+    unsigned int m_summaryFirst = 0; ///< First cell counted by summarizeRow(), by linear index
+    unsigned int m_summaryLast = 0xFFFFFFFF; ///< Cell after the last one counted by summarizeRow()
+    QVector<QVector<unsigned int> > m_counts; ///< Number of counted neighbours of each padded cell, for each counter
+    QVector<unsigned int> m_countBuffer; ///< Working buffer of the Moore kernel, see Neighbourhood::countNeighbours()
+};
+
+#endif // STEPENGINE_H
@@ -0,0 +1,266 @@
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QFileInfo>
+
+#include "sweepdriver.h"
+
+/** \brief Construct a sweep of all the elementary rules on 20 densities
+ */
+SweepDriver::SweepDriver() :
+    m_dimensions({400}), m_ruleNumbers(parseList("0:255", 0, 255)), m_densities(parseList("5:100:5", 0, 100)), m_stateMaxes({1})
+{
+
+}
+
+/** \brief Parse a list of numbers
+ *
+ * The list is made of numbers and ranges separated by commas, a range is "first:last" or "first:last:step".
+ * \code
+ * 0:255
+ * 5:100:5
+ * 30,90,110
+ * \endcode
+ * \param list List to parse
+ * \param min Minimum value
+ * \param max Maximum value
+ * \throw QString Not valid list
+ */
+QVector<unsigned int> SweepDriver::parseList(const QString &list, unsigned int min, unsigned int max)
+{
+    QVector<unsigned int> values;
+    QStringList items = list.split(',', QString::SkipEmptyParts);
+    for (QStringList::const_iterator it = items.cbegin(); it != items.cend(); ++it)
+    {
+        QStringList bounds = it->split(':');
+        if (bounds.size() > 3)
+            throw QString(QObject::tr("Not valid list: %1").arg(list));
+        unsigned int first = parseNumber(bounds.at(0), min);
+        unsigned int last = bounds.size() > 1 ? parseNumber(bounds.at(1), first) : first;
+        unsigned int step = bounds.size() > 2 ? parseNumber(bounds.at(2), 1) : 1;
+        if (last > max)
+            throw QString(QObject::tr("Not valid list: %1").arg(list));
+        for (unsigned int value = first; value <= last && value >= first; value += step)
+            values.push_back(value);
+    }
+    if (values.isEmpty())
+        throw QString(QObject::tr("Not valid list: %1").arg(list));
+    return values;
+}
+
+/** \brief Parse dimensions like "400" or "64x64"
+ *
+ * \throw QString Not valid dimensions
+ */
+QVector<unsigned int> SweepDriver::parseDimensions(const QString &dimensions)
+{
+    QVector<unsigned int> values;
+    QStringList lengths = dimensions.split('x');
+    for (QStringList::const_iterator it = lengths.cbegin(); it != lengths.cend(); ++it)
+        values.push_back(parseNumber(*it, 1));
+    return values;
+}
+
+/** \brief Parse a number
+ *
+ * \param number Number to parse
+ * \param min Minimum value
+ * \throw QString Not valid number
+ */
+unsigned int SweepDriver::parseNumber(const QString &number, unsigned int min)
+{
+    bool ok = false;
+    unsigned int value = number.toUInt(&ok);
+    if (!ok || value < min)
+        throw QString(QObject::tr("Not valid number: %1").arg(number));
+    return value;
+}
+
+/** \brief Check if the program is started as a sweep, without GUI
+ *
+ * It is checked before the creation of the application, which needs a display in GUI mode.
+ */
+bool SweepDriver::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+        if (QString(argv[i]) == "--sweep")
+            return true;
+    return false;
+}
+
+/** \brief Read the parameters of the sweep from the command line
+ *
+ * \param arguments Arguments of the program
+ * \return False if the help was asked, it is written on the standard output
+ * \throw QString Not valid arguments
+ */
+bool SweepDriver::parseArguments(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QObject::tr("Run the automaton on a grid of parameters and write the results in a CSV table."));
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("sweep", QObject::tr("Run a sweep without GUI.")));
+    parser.addOption(QCommandLineOption("size", QObject::tr("Dimensions of the grids, like 400 or 64x64."), "dimensions", "400"));
+    parser.addOption(QCommandLineOption("wolfram", QObject::tr("Wolfram numbers of the 1D rules, like 0:255 or 30,90,110."), "numbers", "0:255"));
+    parser.addOption(QCommandLineOption("rules", QObject::tr("Rule file used instead of the Wolfram numbers."), "file"));
+    parser.addOption(QCommandLineOption("densities", QObject::tr("Densities (%) of the random grids, like 5:100:5."), "densities", "5:100:5"));
+    parser.addOption(QCommandLineOption("states", QObject::tr("Maximum states of the random grids, like 1:3."), "states", "1"));
+    parser.addOption(QCommandLineOption("replicas", QObject::tr("Number of runs of each combination."), "number", "1"));
+    parser.addOption(QCommandLineOption("seed", QObject::tr("Seed of the first run of each combination."), "seed", "1"));
+    parser.addOption(QCommandLineOption("steps", QObject::tr("Maximum number of steps of a run."), "steps", "1000"));
+    parser.addOption(QCommandLineOption("boundary", QObject::tr("Neighbours out of the grid: fixedZero, toroidal or reflective."), "boundary", "fixedZero"));
+    parser.addOption(QCommandLineOption("depth", QObject::tr("Longest period detected."), "generations", "64"));
+    parser.addOption(QCommandLineOption("threads", QObject::tr("Number of threads, all the cores by default."), "number"));
+    parser.addOption(QCommandLineOption("output", QObject::tr("CSV file, - for the standard output."), "file", "-"));
+
+    if (!parser.parse(arguments))
+        throw QString(parser.errorText());
+    if (parser.isSet("help"))
+    {
+        QTextStream(stdout) << parser.helpText();
+        return false;
+    }
+
+    m_dimensions = parseDimensions(parser.value("size"));
+    m_ruleFile = parser.value("rules");
+    if (m_ruleFile.isEmpty())
+    {
+        m_ruleNumbers = parseList(parser.value("wolfram"), 0, 255);
+        if (m_dimensions.size() != 1)
+            throw QString(QObject::tr("The Wolfram rules need 1D grids"));
+    }
+    m_densities = parseList(parser.value("densities"), 0, 100);
+    m_stateMaxes = parseList(parser.value("states"), 1, 0xFFFF);
+    m_replicas = parseNumber(parser.value("replicas"), 1);
+    m_seed = parseNumber(parser.value("seed"), 0);
+    m_nbSteps = parseNumber(parser.value("steps"), 0);
+    m_cycleDetectionDepth = parseNumber(parser.value("depth"), 1);
+    m_output = parser.value("output");
+
+    QString boundary = parser.value("boundary");
+    if (!boundary.compare("fixedZero", Qt::CaseInsensitive))
+        m_boundary = CellHandler::fixedZero;
+    else if (!boundary.compare("toroidal", Qt::CaseInsensitive))
+        m_boundary = CellHandler::toroidal;
+    else if (!boundary.compare("reflective", Qt::CaseInsensitive))
+        m_boundary = CellHandler::reflective;
+    else
+        throw QString(QObject::tr("Not valid boundary: %1").arg(boundary));
+
+    if (parser.isSet("threads"))
+        QThreadPool::globalInstance()->setMaxThreadCount(parseNumber(parser.value("threads"), 1));
+
+    return true;
+}
+
+/** \brief Number of runs of the sweep
+ */
+unsigned int SweepDriver::getNbRuns() const
+{
+    unsigned int nbRules = m_ruleFile.isEmpty() ? m_ruleNumbers.size() : 1;
+    return nbRules * m_stateMaxes.size() * m_densities.size() * m_replicas;
+}
+
+/** \brief Run the sweep and write the table
+ *
+ * There is one row for each run, in the order of the parameters:
+ * \code
+ * rule,stateMax,density,seed,generations,settledAt,period,population,hash
+ * 30,1,50,1,1000,,0,203,8c3f...
+ * \endcode
+ * settledAt and period give the cycle reached by the run (period 1 is a fixed point), they are empty and 0
+ * if it didn't settle in the maximum number of steps or if the settlement can't be found (see Automate::run()).
+ * population is the number of non-zero cells at the end.
+ *
+ * \return False if the output can't be written
+ * \throw QString Not valid rule file
+ */
+bool SweepDriver::run() const
+{
+    QFile output(m_output);
+    bool opened = m_output == "-" ? output.open(stdout, QIODevice::WriteOnly | QIODevice::Text)
+                                  : output.open(QIODevice::WriteOnly | QIODevice::Text);
+    if (!opened)
+    {
+        qWarning("Couldn't open given file.");
+        return false;
+    }
+    QTextStream stream(&output);
+
+    // One model for each rule, compiled once and shared by all its runs
+    QList<Automate*> models;
+    QStringList ruleNames;
+    if (m_ruleFile.isEmpty())
+    {
+        for (int i = 0; i < m_ruleNumbers.size(); i++)
+        {
+            Automate* model = new Automate(m_dimensions);
+            QList<const Rule*> rules = generate1DRules(m_ruleNumbers.at(i));
+            for (QList<const Rule*>::const_iterator it = rules.cbegin(); it != rules.cend(); ++it)
+                model->addRule(*it);
+            models.push_back(model);
+            ruleNames.push_back(QString::number(m_ruleNumbers.at(i)));
+        }
+    }
+    else
+    {
+        Automate* model = new Automate(m_dimensions);
+        try
+        {
+            model->addRuleFile(m_ruleFile);
+        }
+        catch (QString &)
+        {
+            delete model;
+            throw;
+        }
+        models.push_back(model);
+        ruleNames.push_back(QFileInfo(m_ruleFile).baseName());
+    }
+
+    struct Run
+    {
+        int model;
+        unsigned int stateMax;
+        QFuture<AutomateHandler::EnsembleSummary> summary;
+    };
+    QVector<Run> runs;
+    runs.reserve(getNbRuns());
+    const AutomateHandler& handler = AutomateHandler::getAutomateHandler();
+    for (int i = 0; i < models.size(); i++)
+    {
+        models.at(i)->setBoundary(m_boundary);
+        models.at(i)->setCycleDetectionDepth(m_cycleDetectionDepth);
+        for (int s = 0; s < m_stateMaxes.size(); s++)
+            for (int d = 0; d < m_densities.size(); d++)
+                for (unsigned int r = 0; r < m_replicas; r++)
+                {
+                    AutomateHandler::EnsembleMember member;
+                    member.seed = m_seed + r;
+                    member.density = m_densities.at(d);
+                    Run run;
+                    run.model = i;
+                    run.stateMax = m_stateMaxes.at(s);
+                    run.summary = handler.startReplica(models.at(i), member, m_nbSteps, CellHandler::random, run.stateMax);
+                    runs.push_back(run);
+                }
+    }
+
+    stream << "rule,stateMax,density,seed,generations,settledAt,period,population,hash\n";
+    for (int i = 0; i < runs.size(); i++)
+    {
+        AutomateHandler::EnsembleSummary summary = runs[i].summary.result();
+        unsigned int population = 0;
+        for (int state = 1; state < summary.population.size(); state++)
+            population += summary.population.at(state);
+
+        stream << ruleNames.at(runs.at(i).model) << ',' << runs.at(i).stateMax << ',' << summary.member.density << ','
+               << summary.member.seed << ',' << summary.generations << ','
+               << (summary.attractor.period != 0 ? QString::number(summary.attractor.start) : QString()) << ','
+               << summary.attractor.period << ',' << population << ',' << QString::number(summary.hash, 16) << '\n';
+    }
+    stream.flush();
+
+    for (int i = 0; i < models.size(); i++)
+        delete models.at(i);
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef SWEEPDRIVER_H
+#define SWEEPDRIVER_H
+
+#include <QVector>
+#include <QStringList>
+
+#include "automatehandler.h"
+
+
+/** \class SweepDriver
+ * \brief Run an automaton without GUI over a grid of parameters and write the results in a CSV table
+ *
+ * Each combination of rule (Wolfram number or rule file), stateMax, density and replica is one run of a
+ * random grid, stopped as soon as it settles (see Automate::run()). All the runs are scheduled at once on
+ * the thread pool, the replicas of a rule share its compiled rules. Typical use, all the elementary rules
+ * on 20 densities:
+ * \code
+ * AutoCell --sweep --size 400 --wolfram 0:255 --densities 5:100:5 --steps 1000 --output sweep.csv
+ * \endcode
+ */
+class SweepDriver
+{
+private:
+    QVector<unsigned int> m_dimensions; ///< Dimensions of the grids
+    QVector<unsigned int> m_ruleNumbers; ///< Wolfram numbers of the rules, used if m_ruleFile is empty
+    QString m_ruleFile; ///< Rule document used instead of the Wolfram numbers
+    QVector<unsigned int> m_densities; ///< Densities (%) of the random grids
+    QVector<unsigned int> m_stateMaxes; ///< Maximum states of the random grids
+    unsigned int m_replicas = 1; ///< Number of runs for each combination, with consecutive seeds
+    quint32 m_seed = 1; ///< Seed of the first replica
+    unsigned int m_nbSteps = 1000; ///< Maximum number of steps of a run
+    CellHandler::boundaryTypes m_boundary = CellHandler::fixedZero; ///< Behaviour of the neighbours out of the grids
+    unsigned int m_cycleDetectionDepth = 64; ///< Longest period detected
+    QString m_output = "-"; ///< CSV file, "-" for the standard output
+
+    static QVector<unsigned int> parseList(const QString &list, unsigned int min, unsigned int max);
+    static QVector<unsigned int> parseDimensions(const QString &dimensions);
+    static unsigned int parseNumber(const QString &number, unsigned int min);
+
+public:
+    SweepDriver();
+
+    static bool isRequested(int argc, char * argv[]);
+    bool parseArguments(const QStringList &arguments);
+    unsigned int getNbRuns() const;
+    bool run() const;
+};
+
+#endif // SWEEPDRIVER_H
@@ -0,0 +1,35 @@
+# Compares the generations of a SlabCluster with the ones of an Automate, run with "make check"
+QT += core gui concurrent
+QT -= widgets
+CONFIG += console testcase
+CONFIG -= app_bundle
+QMAKE_CXXFLAGS = -std=c++11
+QMAKE_LFLAGS = -std=c++11
+TARGET = tst_slabcluster
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    tst_slabcluster.cpp \
+    ../../cell.cpp \
+    ../../cellhandler.cpp \
+    ../../matrixrule.cpp \
+    ../../automate.cpp \
+    ../../automatehandler.cpp \
+    ../../rule.cpp \
+    ../../neighbourrule.cpp \
+    ../../neighbourhood.cpp \
+    ../../compiledrules.cpp \
+    ../../stepengine.cpp \
+    ../../sweepdriver.cpp \
+    ../../checkpoint.cpp \
+    ../../mappedgrid.cpp \
+    ../../slabworker.cpp \
+    ../../slabcluster.cpp \
+    ../../framering.cpp \
+    ../../palette.cpp \
+    ../../frameexporter.cpp \
+    ../../probabilisticrule.cpp \
+    ../../blockrule.cpp \
+    ../../blockengine.cpp \
+    ../../generationsrule.cpp
@@ -0,0 +1,143 @@
+#include <QCoreApplication>
+#include <QDebug>
+
+#include "automate.h"
+#include "slabcluster.h"
+#include "neighbourrule.h"
+#include "matrixrule.h"
+#include "probabilisticrule.h"
+
+/** \brief Rules of the compared automata
+ */
+enum ruleSets {
+    life, ///< Game of life with NeighbourRule
+    matrix, ///< MatrixRule on the farthest positions of the neighbourhood
+    fire ///< Forest fire with ProbabilisticRule
+};
+
+/** \brief Add the rules of a set to an automate
+ *
+ * \param automate Automate whose neighbourhood is already set
+ * \param rules Set of rules
+ */
+static void addRules(Automate &automate, ruleSets rules)
+{
+    const QVector<QVector<short> > &offsets = automate.getNeighbourhood().getOffsets();
+    switch (rules)
+    {
+    case life:
+        automate.addRule(new NeighbourRule(1, QVector<unsigned int>() << 0, qMakePair(2u, 3u), QSet<unsigned int>() << 1));
+        automate.addRule(new NeighbourRule(0, QVector<unsigned int>() << 1, qMakePair(3u, 3u), QSet<unsigned int>() << 1));
+        break;
+    case matrix:
+    {
+        MatrixRule *birth = new MatrixRule(1, QVector<unsigned int>() << 0);
+        birth->addNeighbourState(offsets.first(), 1);
+        birth->addNeighbourState(offsets.last(), 0);
+        automate.addRule(birth);
+        MatrixRule *death = new MatrixRule(0, QVector<unsigned int>() << 1);
+        death->addNeighbourState(offsets.last(), 1);
+        automate.addRule(death);
+        break;
+    }
+    case fire:
+        automate.addRule(new ProbabilisticRule(2, QVector<unsigned int>() << 1, qMakePair(1u, 100u), 0.4, true, QSet<unsigned int>() << 2));
+        automate.addRule(new NeighbourRule(3, QVector<unsigned int>() << 2, qMakePair(0u, 100u)));
+        automate.addRule(new ProbabilisticRule(1, QVector<unsigned int>() << 0 << 3, qMakePair(0u, 100u), 0.05));
+        automate.setRandomSeed(11);
+        break;
+    }
+}
+
+/** \brief Step an Automate and a SlabCluster side by side and compare their states and hashes
+ *
+ * \param dimensions Dimensions of the grid
+ * \param neighbourhood Neighbourhood of the rules
+ * \param rules Set of rules
+ * \param boundary Behaviour of the neighbours out of the grid
+ * \param nbWorkers Number of workers of the cluster
+ * \param nbSteps Number of generations compared
+ * \return False if a generation is different
+ * \throw QString Workers not started, lost connection
+ */
+static bool compare(const QVector<unsigned int> &dimensions, const Neighbourhood &neighbourhood, ruleSets rules,
+                    CellHandler::boundaryTypes boundary, unsigned int nbWorkers, unsigned int nbSteps)
+{
+    Automate automate(dimensions);
+    automate.setNeighbourhood(neighbourhood);
+    automate.setBoundary(boundary);
+    addRules(automate, rules);
+    unsigned int stateMax = rules == fire ? 2 : 1;
+    automate.getCellHandler().generate(CellHandler::random, stateMax, 35, 7);
+
+    SlabCluster cluster(dimensions, nbWorkers, boundary);
+    cluster.setRules(automate);
+    cluster.generate(CellHandler::random, stateMax, 35, 7);
+    for (unsigned int step = 0; step <= nbSteps; step++)
+    {
+        if (cluster.getSnapshot() != automate.getCellHandler().getSnapshot() || cluster.hash() != automate.getCellHandler().hash())
+        {
+            qCritical() << "Different at generation" << step << ": dimensions" << dimensions << "neighbourhood"
+                        << neighbourhood.toJson() << "rules" << rules << "boundary" << boundary << "workers" << nbWorkers;
+            return false;
+        }
+        if (step < nbSteps)
+        {
+            automate.run(1, false, false);
+            cluster.step();
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    // The workers of the clusters are started from this program
+    if (SlabWorker::isRequested(argc, argv))
+    {
+        QCoreApplication app(argc, argv);
+        try
+        {
+            SlabWorker worker;
+            return worker.run(app.arguments()) ? 0 : 1;
+        }
+        catch (QString &error)
+        {
+            qCritical() << error;
+            return 1;
+        }
+    }
+
+    QCoreApplication app(argc, argv);
+    QVector<unsigned int> plane = QVector<unsigned int>() << 23 << 17;
+    QVector<unsigned int> volume = QVector<unsigned int>() << 7 << 5 << 11;
+    QList<QPair<QVector<unsigned int>, Neighbourhood> > grids;
+    grids << qMakePair(plane, Neighbourhood(2, Neighbourhood::moore, 1))
+          << qMakePair(plane, Neighbourhood(2, Neighbourhood::moore, 2))
+          << qMakePair(plane, Neighbourhood(2, Neighbourhood::vonNeumann, 1))
+          << qMakePair(plane, Neighbourhood(2, Neighbourhood::vonNeumann, 3))
+          << qMakePair(plane, Neighbourhood(2, Neighbourhood::hexagonal))
+          << qMakePair(volume, Neighbourhood(3, Neighbourhood::moore, 1))
+          << qMakePair(volume, Neighbourhood(3, Neighbourhood::vonNeumann, 2));
+    const CellHandler::boundaryTypes boundaries[] = {CellHandler::fixedZero, CellHandler::toroidal, CellHandler::reflective};
+    const ruleSets ruleSetList[] = {life, matrix, fire};
+
+    int nbFailures = 0;
+    try
+    {
+        for (int g = 0; g < grids.size(); g++)
+            for (int r = 0; r < 3; r++)
+                for (int b = 0; b < 3; b++)
+                    for (unsigned int nbWorkers = 1; nbWorkers <= 3; nbWorkers += 2)
+                        if (!compare(grids.at(g).first, grids.at(g).second, ruleSetList[r], boundaries[b], nbWorkers, 8))
+                            nbFailures++;
+    }
+    catch (QString &error)
+    {
+        qCritical() << error;
+        return 1;
+    }
+    if (nbFailures != 0)
+        qCritical() << nbFailures << "clusters differ from a single process";
+    return nbFailures == 0 ? 0 : 1;
+}